@@ -6,6 +6,7 @@
 #endif
 #include <cstddef>
 #include <map>
+#include <set>
 #include <unordered_set>
 
 namespace infini {
@@ -14,8 +15,10 @@ namespace infini {
   private:
     Runtime runtime;
 
+    // total size of the blocks currently allocated
     size_t used;
 
+    // end of the simulated arena, i.e. the size that getPtr() will allocate
     size_t peak;
 
     size_t alignment;
@@ -28,7 +31,10 @@ namespace infini {
     // HINT: 可以使用一个 map 来存储 free block，key 为 block 的起始/结尾地址，value 为 block 的大小
     // =================================== 作业 ===================================
 
-	std::map<size_t,size_t> free_block;
+    // free blocks inside [0, peak) indexed twice: by start offset, for
+    // coalescing with neighbours, and by (size, offset), for best fit
+    std::map<size_t, size_t> free_block;
+    std::set<std::pair<size_t, size_t>> free_block_by_size;
 
   public:
     Allocator(Runtime runtime);
@@ -53,9 +59,17 @@ namespace infini {
 
     void info();
 
+    size_t getUsed() const { return used; }
+
+    size_t getPeak() const { return peak; }
+
   private:
     // function: memory alignment, rouned up
     // return: size of the aligned memory block
     size_t getAlignedSize(size_t size);
+
+    // keep both free block indices in sync
+    void insertFreeBlock(size_t addr, size_t size);
+    void eraseFreeBlock(std::map<size_t, size_t>::iterator it);
   };
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "core/common.h"
+#include "utils/data_convert.h"
 #include <cstdint>
 
 namespace infini {
@@ -60,11 +61,16 @@ class DataType {
     DataType() = default;
     constexpr DataType(int index) : index(index) {}
     bool operator==(const DataType &rhs) const { return index == rhs.index; }
+    bool operator!=(const DataType &rhs) const { return index != rhs.index; }
     bool operator<(const DataType &rhs) const { return index < rhs.index; }
 
     template <typename T> static int get() {
         IT_TODO_HALT_MSG("Unsupported data type");
     }
+    // The data type of the elements of type T
+    template <typename T> static DataType of() {
+        IT_TODO_HALT_MSG("Unsupported data type");
+    }
     size_t getSize() const { return sizePerElement[index]; }
     string toString() const { return string(names[index]); }
     int cpuTypeInt() const { return cpuType[index]; }
@@ -83,6 +89,21 @@ template <> inline int DataType::get<int32_t>() { return 6; }
 template <> inline int DataType::get<int64_t>() { return 7; }
 template <> inline int DataType::get<uint64_t>() { return 8; }
 template <> inline int DataType::get<double>() { return 9; }
+template <> inline int DataType::get<float16_t>() { return 4; }
+template <> inline int DataType::get<bfloat16_t>() { return 4; }
+
+template <> inline DataType DataType::of<float>() { return Float32; }
+template <> inline DataType DataType::of<uint8_t>() { return UInt8; }
+template <> inline DataType DataType::of<int8_t>() { return Int8; }
+template <> inline DataType DataType::of<uint16_t>() { return UInt16; }
+template <> inline DataType DataType::of<int16_t>() { return Int16; }
+template <> inline DataType DataType::of<int32_t>() { return Int32; }
+template <> inline DataType DataType::of<int64_t>() { return Int64; }
+template <> inline DataType DataType::of<float16_t>() { return Float16; }
+template <> inline DataType DataType::of<double>() { return Double; }
+template <> inline DataType DataType::of<uint32_t>() { return UInt32; }
+template <> inline DataType DataType::of<uint64_t>() { return UInt64; }
+template <> inline DataType DataType::of<bfloat16_t>() { return BFloat16; }
 
 template <int index> struct DT {};
 template <> struct DT<0> { using t = bool; };
@@ -95,10 +116,10 @@ template <> struct DT<6> { using t = int32_t; };
 template <> struct DT<7> { using t = int64_t; };
 template <> struct DT<8> { using t = char; };
 template <> struct DT<9> { using t = int8_t; };
-template <> struct DT<10> { using t = uint16_t; };
+template <> struct DT<10> { using t = float16_t; };
 template <> struct DT<11> { using t = double; };
 template <> struct DT<12> { using t = uint32_t; };
 template <> struct DT<13> { using t = uint64_t; };
-template <> struct DT<16> { using t = uint16_t; };
+template <> struct DT<16> { using t = bfloat16_t; };
 
 } // namespace infini
@@ -0,0 +1,75 @@
+#pragma once
+#include "core/graph.h"
+#include <cstdint>
+
+namespace infini
+{
+    /**
+     * @brief A read-only snapshot of the structure of a graph, for passes and
+     * schedulers that traverse it a lot.
+     *
+     * Ops and tensors are numbered by their position in the graph, and every
+     * adjacency list is a CSR array of 32-bit ids, so that a traversal reads
+     * contiguous memory and neither allocates nor touches a reference count,
+     * unlike getTargets(), getPredecessors() and getSuccessors(). It is built
+     * from the inputs and outputs of the ops in O(V + E), and is invalidated
+     * by any change to the graph.
+     */
+    class FlatGraph
+    {
+    public:
+        using Id = uint32_t;
+        static constexpr Id none = ~Id(0);
+
+        // A non-owning range of ids
+        class IdRange
+        {
+            const Id *first, *last;
+
+        public:
+            IdRange(const Id *first, const Id *last) : first(first), last(last) {}
+            const Id *begin() const { return first; }
+            const Id *end() const { return last; }
+            size_t size() const { return last - first; }
+            bool empty() const { return first == last; }
+            Id operator[](size_t i) const { return first[i]; }
+        };
+
+        explicit FlatGraph(const GraphObj &graph);
+
+        size_t numOps() const { return ops.size(); }
+        size_t numTensors() const { return tensors.size(); }
+        OperatorObj *getOp(Id op) const { return ops[op]; }
+        TensorObj *getTensor(Id tensor) const { return tensors[tensor]; }
+        Id getId(const OperatorObj *op) const { return op->graphIndex; }
+        Id getId(const TensorObj *tensor) const { return tensor->graphIndex; }
+
+        // In the order of the op, once per occurrence
+        IdRange getInputs(Id op) const { return opInputs.at(op); }
+        IdRange getOutputs(Id op) const { return opOutputs.at(op); }
+        // Each distinct op once
+        IdRange getPredecessors(Id op) const { return opPredecessors.at(op); }
+        IdRange getSuccessors(Id op) const { return opSuccessors.at(op); }
+
+        // The op writing a tensor, or `none`
+        Id getSource(Id tensor) const { return tensorSource[tensor]; }
+        // The ops reading a tensor, once per occurrence
+        IdRange getTargets(Id tensor) const { return tensorTargets.at(tensor); }
+
+    private:
+        struct Csr
+        {
+            vector<Id> offsets, ids;
+            IdRange at(Id i) const
+            {
+                return {ids.data() + offsets[i], ids.data() + offsets[i + 1]};
+            }
+        };
+
+        vector<OperatorObj *> ops;
+        vector<TensorObj *> tensors;
+        Csr opInputs, opOutputs, opPredecessors, opSuccessors, tensorTargets;
+        vector<Id> tensorSource;
+    };
+
+} // namespace infini
@@ -2,46 +2,84 @@
 #include "core/allocator.h"
 #include "core/operator.h"
 #include "core/tensor.h"
+#include "core/weight_arena.h"
 #include <algorithm>
 #include <cstdint>
 
 namespace infini
 {
+    // What a rule or a pass of GraphObj::optimize did, see PassManager
+    struct PassStatistics
+    {
+        string name;
+        // ops matched by the pattern, and rewrites that changed the graph
+        size_t matches = 0, rewrites = 0;
+        double milliseconds = 0;
+        // the peak activation bytes before and after a pass scheduling for
+        // memory, 0 for the others
+        size_t peakBefore = 0, peakAfter = 0;
+    };
 
     class GraphObj : public Object
     {
+        friend class GraphRewriter;
+        friend class NativeCpuRuntimeObj;
+
     protected:
         Runtime runtime;
-        TensorVec tensors;
-        OpVec ops;
+        // a removed tensor or op leaves a null tombstone until compact()
+        mutable TensorVec tensors;
+        mutable OpVec ops;
         Allocator allocator;
+        WeightArena weights;
 
     public:
         explicit GraphObj(Runtime runtime)
-            : runtime(runtime), allocator(runtime), sorted(false){};
+            : runtime(runtime), allocator(runtime), weights(runtime),
+              sorted(false){};
         string toString() const override;
         Runtime getRuntime() const { return runtime; }
 
         Tensor addTensor(Shape dim, DataType dtype = DataType::Float32);
         Tensor addTensor(const Tensor &tensor);
         TensorVec addTensor(const TensorVec &tensors);
-        void removeOperator(Operator op)
+
+        /**
+         * @brief Add a constant tensor, e.g. a weight. Its data can be written
+         * as soon as it is created, and ops reading only constants are
+         * evaluated by optimize(). dataMalloc() moves the constants into a
+         * read-only weight arena, outside of the activation memory.
+         */
+        Tensor addConstant(Shape dim, DataType dtype = DataType::Float32);
+
+        /**
+         * @brief Remove an operator, or a tensor, from the lists of the graph
+         * in O(1), without touching its connections.
+         */
+        void removeOperator(const Operator &op);
+        void removeTensor(const Tensor &tensor);
+
+        const TensorVec &getTensors() const
         {
-            auto it = std::find(ops.begin(), ops.end(), op);
-            if (it != ops.end())
-                ops.erase(it);
+            compact();
+            return tensors;
         }
-
-        void removeTensor(Tensor tensor)
+        const OpVec &getOperators() const
         {
-            auto it = std::find(tensors.begin(), tensors.end(), tensor);
-            if (it != tensors.end())
-                tensors.erase(it);
+            compact();
+            return ops;
         }
-
-        const TensorVec &getTensors() const { return tensors; }
-        const OpVec &getOperators() const { return ops; }
         Tensor getTensor(int) const;
+        bool hasOperator(const Operator &op) const
+        {
+            return op && op->graphIndex < ops.size() &&
+                   ops[op->graphIndex] == op;
+        }
+        bool hasTensor(const Tensor &tensor) const
+        {
+            return tensor && tensor->graphIndex < tensors.size() &&
+                   tensors[tensor->graphIndex] == tensor;
+        }
 
         /**
          * @brief Sort the nodes in topological order.
@@ -51,7 +89,17 @@ namespace infini
          */
         bool topo_sort();
 
-        void optimize();
+        /**
+         * @brief Run the ops in another topological order, given as their
+         * positions in getOperators().
+         */
+        void reorder(const vector<size_t> &order);
+
+        /**
+         * @brief Rewrite the graph with the rules and passes of
+         * add_default_passes, see PassManager, returning their statistics.
+         */
+        vector<PassStatistics> optimize();
 
         void shape_infer();
 
@@ -81,13 +129,15 @@ namespace infini
         }
 
         /**
-         * @brief Gets input tensors of this graph.
+         * @brief Gets input tensors of this graph, which are fed before each
+         * run, i.e. not the constants.
          */
         inline TensorVec getInputs() const
         {
+            compact();
             TensorVec ret;
             for (const auto &t : tensors)
-                if (!t->getSource())
+                if (!t->getSource() && !t->isConstant())
                     ret.emplace_back(t);
             return ret;
         }
@@ -97,6 +147,7 @@ namespace infini
          */
         inline TensorVec getOutputs() const
         {
+            compact();
             TensorVec ret;
             for (const auto &t : tensors)
                 if (t->getTargets().empty())
@@ -112,6 +163,36 @@ namespace infini
          */
         void addOperatorAndConnect(const Operator &op);
 
+        /**
+         * @brief Mark a tensor without a source constant and give it a
+         * writable staging buffer.
+         */
+        void makeConstant(const Tensor &tensor);
+
+        /**
+         * @brief Make `tensor` a view over the data of `base` instead of a
+         * buffer of its own, see TensorObj::viewBase. A view of a view aliases
+         * the base of the latter.
+         */
+        void makeView(const Tensor &tensor, const Tensor &base,
+                      vector<size_t> strides, size_t offset);
+
+        /**
+         * @brief Drop the tombstones of removed ops and tensors, and update the
+         * positions the others hold. Linear, but only when something was
+         * removed since the last call.
+         */
+        void compact() const;
+
+        // the tensor of every fuid, built by the first getTensor()
+        mutable std::unordered_map<UidBaseType, TensorObj *> fuidIndex;
+        mutable bool fuidIndexed = false;
+        mutable size_t removedOps = 0, removedTensors = 0;
+
+        // the plan RuntimeObj::run() runs, dropped whenever the ops or the
+        // memory of the graph change
+        Plan plan;
+
         /**
          * @brief If the nodes is sorted in topological order.
          */
@@ -0,0 +1,206 @@
+#pragma once
+#include "core/graph.h"
+#include <deque>
+#include <functional>
+#include <memory>
+
+namespace infini
+{
+    /**
+     * @brief Graph mutations that keep `targets`, `source`, `predecessors` and
+     * `successors` consistent with each other.
+     *
+     * Erased ops and tensors are disconnected and removed from the graph in
+     * O(1), the graph compacting its lists lazily, so that a rewrite never
+     * scans the graph. The ops whose neighborhood changed are recorded for the
+     * worklist of the PassManager.
+     */
+    class GraphRewriter
+    {
+        GraphObj &graph;
+        OpVec touched;
+
+        // rebuilds the predecessors of `op` and its entries in their successors
+        void reconnect(const Operator &op);
+        void touchReaders(const Tensor &tensor);
+
+    public:
+        explicit GraphRewriter(GraphObj &graph) : graph(graph) {}
+
+        GraphObj &getGraph() const { return graph; }
+
+        /**
+         * @brief Add an operator reading existing tensors and writing the
+         * specified outputs, which must not have a source yet.
+         */
+        template <typename T, typename... Args>
+        Ref<T> addOp(Args &&...args)
+        {
+            auto op = graph.addOpWithOutputs<T>(std::forward<Args>(args)...);
+            auto succs = op->getSuccessors();
+            touched.emplace_back(op);
+            touched.insert(touched.end(), succs.begin(), succs.end());
+            return op;
+        }
+
+        /**
+         * @brief Add a copy of `op`, with its attributes, reading `inputs` and
+         * writing `outputs`.
+         */
+        Operator addClone(const Operator &op, const TensorVec &inputs,
+                          const TensorVec &outputs);
+
+        Tensor addTensor(Shape dims, DataType dtype)
+        {
+            return graph.addTensor(std::move(dims), dtype);
+        }
+
+        /**
+         * @brief Mark a tensor whose source was erased constant, giving it a
+         * buffer to compute its data into.
+         */
+        void makeConstant(const Tensor &tensor) { graph.makeConstant(tensor); }
+
+        /**
+         * @brief Make a tensor alias the data of `base` with the given
+         * layout, see GraphObj::makeView.
+         */
+        void makeView(const Tensor &tensor, const Tensor &base,
+                      vector<size_t> strides, size_t offset = 0)
+        {
+            graph.makeView(tensor, base, std::move(strides), offset);
+        }
+
+        /**
+         * @brief Disconnect `op` from its tensors and neighbors. Its outputs stay
+         * in the graph without a source.
+         */
+        void eraseOp(const Operator &op);
+
+        /**
+         * @brief Drop a tensor that no op reads or writes any more.
+         */
+        void eraseTensor(const Tensor &tensor);
+
+        /**
+         * @brief Make `op` read `to` wherever it reads `from`.
+         */
+        void replaceInput(const Operator &op, const Tensor &from,
+                          const Tensor &to);
+
+        /**
+         * @brief Make every reader of `from` read `to` instead.
+         */
+        void replaceAllUsesWith(const Tensor &from, const Tensor &to);
+
+        /**
+         * @brief Record that the attributes of `op` changed, so that the rules
+         * see it again.
+         */
+        void touch(const Operator &op) { touched.emplace_back(op); }
+
+        bool isErased(const Operator &op) const
+        {
+            return !graph.hasOperator(op);
+        }
+
+        // A dense id of an op of the graph, stable until the graph compacts
+        // its lists, i.e. while the rules run
+        size_t getId(const Operator &op) const { return op->graphIndex; }
+
+        // The ops touched since the last call
+        OpVec takeTouched() { return std::move(touched); }
+
+    };
+
+    /**
+     * @brief A declarative matcher of an op: its type, predicates on its
+     * attributes, and patterns the producers of its inputs must match.
+     *
+     * OpPattern(OpType::MatMul).input(0, OpPattern(OpType::Transpose).oneUse())
+     * matches a MatMul whose first input is written by a Transpose that no
+     * other op reads.
+     */
+    class OpPattern
+    {
+        OpType type;
+        vector<std::function<bool(const Operator &)>> predicates;
+        vector<int> inputIndices;
+        vector<OpPattern> inputPatterns;
+        bool singleUse = false;
+
+    public:
+        explicit OpPattern(OpType type) : type(type) {}
+
+        OpPattern &where(std::function<bool(const Operator &)> predicate);
+        OpPattern &input(int index, OpPattern producer);
+        // The output of the op is read by exactly one op
+        OpPattern &oneUse();
+
+        OpType getType() const { return type; }
+        bool match(const Operator &op) const;
+    };
+
+    /**
+     * @brief A rewrite of the ops matching a pattern. `rewrite` returns whether
+     * it changed the graph.
+     */
+    struct RewriteRule
+    {
+        string name;
+        OpPattern pattern;
+        std::function<bool(GraphRewriter &, const Operator &)> rewrite;
+    };
+
+    /**
+     * @brief Applies rewrite rules to a fixpoint, then whole-graph passes.
+     *
+     * The rules are driven by a worklist seeded with every op in topological
+     * order. Each op is tried against the rules of its type; after a rewrite,
+     * the ops it created or whose inputs changed go back on the worklist, so
+     * that e.g. cancelling two Transposes lets the MatMul reading them fold the
+     * next one. The passes run once each after the rules.
+     */
+    class PassManager
+    {
+        vector<RewriteRule> rules;
+        vector<std::pair<string,
+                         std::function<void(GraphRewriter &, PassStatistics &)>>>
+            passes;
+
+    public:
+        void addRule(RewriteRule rule) { rules.emplace_back(std::move(rule)); }
+        /**
+         * @brief Add a whole-graph pass returning the number of rewrites it
+         * made.
+         */
+        void addPass(string name, std::function<size_t(GraphRewriter &)> pass)
+        {
+            addPass(std::move(name),
+                    [pass = std::move(pass)](GraphRewriter &rw,
+                                             PassStatistics &stats)
+                    { stats.matches = stats.rewrites = pass(rw); });
+        }
+        /**
+         * @brief Add a whole-graph pass filling its own statistics, except for
+         * the name and the time.
+         */
+        void addPass(string name,
+                     std::function<void(GraphRewriter &, PassStatistics &)> pass)
+        {
+            passes.emplace_back(std::move(name), std::move(pass));
+        }
+
+        /**
+         * @brief Optimize `graph`, returning the statistics of every rule and
+         * then every pass.
+         */
+        vector<PassStatistics> run(GraphObj &graph) const;
+    };
+
+    /**
+     * @brief The rules and passes of GraphObj::optimize.
+     */
+    void add_default_passes(PassManager &pm);
+
+} // namespace infini
@@ -4,12 +4,37 @@
 #include "core/tensor.h"
 #include "utils/operator_utils.h"
 #include <functional>
+#include <mutex>
 
 namespace infini
 {
 
     class RuntimeObj;
 
+    /**
+     * @brief An op ready to run: a plain function and the parameters it was
+     * compiled with, raw data pointers included, so running it needs neither
+     * the op nor the kernel registry.
+     */
+    struct KernelStep
+    {
+        void (*fn)(const void *params) = nullptr;
+        std::shared_ptr<const void> params;
+
+        void operator()() const { fn(params.get()); }
+
+        /**
+         * @brief A step calling `Run(params)`.
+         */
+        template <typename Params, void (*Run)(const Params &)>
+        static KernelStep make(Params params)
+        {
+            return {[](const void *p)
+                    { Run(*static_cast<const Params *>(p)); },
+                    std::make_shared<const Params>(std::move(params))};
+        }
+    };
+
     class Kernel
     {
     public:
@@ -21,8 +46,46 @@ namespace infini
          */
         virtual void compute(const Operator &op,
                              const RuntimeObj *context) const = 0;
+
+        /**
+         * @brief Precomputes everything compute() derives from the op and
+         * its tensors. The data of the tensors must be allocated and stay in
+         * place as long as the step is used. By default the step just calls
+         * compute().
+         */
+        virtual KernelStep compile(const Operator &op,
+                                   const RuntimeObj *context) const
+        {
+            return KernelStep::make<ComputeParams, runCompute>(
+                {this, op, context});
+        }
+
+        /**
+         * @brief Whether the kernel reads inputs of any layout, see
+         * TensorObj::getStrides(), rather than only contiguous ones. Views are
+         * only fed to the ops whose kernels all accept them.
+         */
+        virtual bool acceptsStridedInputs() const { return false; }
+
+    private:
+        struct ComputeParams
+        {
+            const Kernel *kernel;
+            Operator op;
+            const RuntimeObj *context;
+        };
+        static void runCompute(const ComputeParams &p)
+        {
+            p.kernel->compute(p.op, p.context);
+        }
     };
 
+    /**
+     * @brief The kernels of every (device, op type) key. A key may have
+     * several candidates, e.g. a vectorized alternative to a naive kernel or
+     * variants with other tile sizes. The one with the highest priority is
+     * used unless tuning is enabled, see selectKernel().
+     */
     class KernelRegistry
     {
     public:
@@ -30,39 +93,105 @@ namespace infini
             tuple<Kernel *const, const string, const int>; // Kernel, name, ID
 
     private:
-        std::map<KernelAttrs, KernelRecord> kernels;
+        // Candidates of every key by descending priority, the first one is
+        // used to run the op. Equal priorities keep the registration order.
+        std::map<KernelAttrs, std::multimap<int, KernelRecord, std::greater<int>>>
+            kernels;
         int nKernels = 0;
 
+        bool tuning = false;
+        string tuningCache; // file the tuned kernels are appended to
+        // kernel name of every tuned workload, see workloadKey()
+        std::map<string, string> tunedKernels;
+        std::mutex tuningMutex;
+        // bumped whenever selectKernel() may pick other kernels
+        size_t version = 0;
+
+        KernelRegistry();
+        static string workloadKey(Device device, const Operator &op);
+        const KernelRecord &tune(const Operator &op, const RuntimeObj *context,
+                                 const vector<const KernelRecord *> &candidates);
+
     public:
         ~KernelRegistry()
         {
-            for (auto &[k, v] : kernels)
-                delete std::get<0>(v);
+            for (auto &[k, candidates] : kernels)
+                for (auto &[priority, v] : candidates)
+                    delete std::get<0>(v);
         }
         static KernelRegistry &getInstance()
         {
             static KernelRegistry instance;
             return instance;
         }
-        bool registerKernel(const KernelAttrs &key, Kernel *kernel, string name)
+        /**
+         * @brief Registers a kernel for a key. Several kernels may be
+         * registered for the same key, e.g. a vectorized alternative to a
+         * naive one; the one with the highest priority is preferred.
+         */
+        bool registerKernel(const KernelAttrs &key, Kernel *kernel, string name,
+                            int priority = 0)
         {
-            IT_ASSERT(kernels.find(key) == kernels.end(),
-                      "Kernel already registered");
-            kernels.emplace(key, KernelRecord{kernel, name, ++nKernels});
+            auto &candidates = kernels[key];
+            for (auto &[p, v] : candidates)
+                IT_ASSERT(std::get<1>(v) != name, "Kernel already registered");
+            candidates.emplace(priority,
+                               KernelRecord{kernel, name, ++nKernels});
+            ++version;
             return true;
         }
         Kernel *getKernel(const KernelAttrs &kernelAttrs) const
+        {
+            return std::get<0>(getKernelItem(kernelAttrs));
+        }
+        const KernelRecord &getKernelItem(const KernelAttrs &kernelAttrs) const
         {
             auto it = kernels.find(kernelAttrs);
             IT_ASSERT(it != kernels.end(), "Kernel not found for key {" +
                                                get_kernel_attrs_str(kernelAttrs) +
                                                "}");
-            return std::get<0>(it->second);
+            return it->second.begin()->second;
         }
-        const KernelRecord &getKernelItem(const KernelAttrs &kernelAttrs) const
+        /**
+         * @brief All the kernels registered for a key, preferred one first.
+         */
+        vector<const KernelRecord *>
+        getKernelCandidates(const KernelAttrs &kernelAttrs) const
         {
-            return kernels.at(kernelAttrs);
+            vector<const KernelRecord *> ret;
+            auto it = kernels.find(kernelAttrs);
+            if (it != kernels.end())
+                for (auto &[priority, v] : it->second)
+                    ret.emplace_back(&v);
+            return ret;
         }
+
+        /**
+         * @brief The kernel to run `op` with. Without tuning, it is the
+         * preferred kernel of its key. With tuning, the candidates of the key
+         * are benchmarked on `op` the first time its workload is seen, which
+         * overwrites its outputs, and the fastest one is kept for every op of
+         * the same workload.
+         */
+        const KernelRecord &selectKernel(const Operator &op,
+                                         const RuntimeObj *context);
+        void setTuning(bool enable)
+        {
+            tuning = enable;
+            ++version;
+        }
+        bool isTuning() const { return tuning; }
+        /**
+         * @brief Enables tuning and loads the kernels tuned by earlier
+         * processes from `path`, to which the new ones are appended. The
+         * INFINI_TUNING_CACHE environment variable sets it at startup.
+         */
+        void setTuningCache(const string &path);
+        // Forgets the tuned kernels, not the cache file
+        void clearTuning();
+        // Changes whenever the kernels selectKernel() picks may change, i.e.
+        // a kernel or a tuning setting was added or changed
+        size_t getVersion() const { return version; }
     };
 
     class CpuKernelWithoutConfig : public Kernel
@@ -72,16 +201,79 @@ namespace infini
                              const RuntimeObj *context) const = 0;
     };
 
+    template <typename... Ts>
+    struct TypeList
+    {
+    };
+
+    // The element types of the arithmetic CPU kernels
+    using CpuArithmeticTypes =
+        TypeList<float, double, float16_t, bfloat16_t, int8_t, int32_t,
+                 int64_t, uint32_t>;
+    // Float32 and the types computed in Float32
+    using CpuFloatTypes = TypeList<float, float16_t, bfloat16_t>;
+
+    /**
+     * @brief Registers `make<T>()` for the data type of every T of a
+     * TypeList, see REGISTER_KERNEL_FOR_TYPES.
+     */
+    template <typename Make, typename... Ts>
+    bool register_kernels(Device device, OpType::underlying_t opType,
+                          TypeList<Ts...>, const string &name, int priority,
+                          Make make)
+    {
+        auto &registry = KernelRegistry::getInstance();
+        (registry.registerKernel(
+             KernelAttrs{device, opType, DataType::of<Ts>()},
+             make(static_cast<Ts *>(nullptr)), name, priority),
+         ...);
+        return true;
+    }
+
 } // namespace infini
 
-#define _REGISTER_KERNEL_1(device, opType, kernel, name, cnt)                 \
-    namespace infini                                                          \
-    {                                                                         \
-        static const bool _CAT(_register_kernel_, cnt) =                      \
-            KernelRegistry::getInstance().registerKernel(KernelAttrs{device,  \
-                                                                     opType}, \
-                                                         new kernel(), name); \
+#define _REGISTER_KERNEL_1(device, opType, dtype, kernel, name, priority,   \
+                           cnt)                                                \
+    namespace infini                                                           \
+    {                                                                          \
+        static const bool _CAT(_register_kernel_, cnt) =                       \
+            KernelRegistry::getInstance().registerKernel(                      \
+                KernelAttrs{device, opType, dtype}, new kernel(), name,        \
+                priority);                                                     \
+    }
+
+#define REGISTER_KERNEL(device, opType, dtype, kernel, name) \
+    _REGISTER_KERNEL_1(device, opType, dtype, kernel, name, 0, __COUNTER__)
+
+/**
+ * @brief Registers an alternative kernel, preferred over the ones with a
+ * lower priority (REGISTER_KERNEL uses 0).
+ */
+#define REGISTER_KERNEL_WITH_PRIORITY(device, opType, dtype, kernel, name,    \
+                                      priority)                               \
+    _REGISTER_KERNEL_1(device, opType, dtype, kernel, name, priority,         \
+                       __COUNTER__)
+
+#define _REGISTER_KERNELS_1(device, opType, types, make, name, priority, cnt)  \
+    namespace infini                                                           \
+    {                                                                          \
+        static const bool _CAT(_register_kernel_, cnt) =                       \
+            register_kernels(device, opType, types{}, name, priority, make);   \
     }
 
-#define REGISTER_KERNEL(device, opType, kernel, name) \
-    _REGISTER_KERNEL_1(device, opType, kernel, name, __COUNTER__)
+/**
+ * @brief Registers `kernel<T>` for every type T of the TypeList `types`,
+ * under the data type of T.
+ */
+#define REGISTER_KERNEL_FOR_TYPES(device, opType, types, kernel, name)        \
+    REGISTER_KERNEL_FOR_TYPES_WITH_PRIORITY(device, opType, types, kernel,    \
+                                            name, 0)
+
+#define REGISTER_KERNEL_FOR_TYPES_WITH_PRIORITY(device, opType, types, kernel, \
+                                                name, priority)                \
+    _REGISTER_KERNELS_1(                                                       \
+        device, opType, types,                                                 \
+        [](auto *t) -> Kernel * {                                              \
+            return new kernel<std::remove_pointer_t<decltype(t)>>();           \
+        },                                                                     \
+        name, priority, __COUNTER__)
@@ -0,0 +1,32 @@
+#pragma once
+#include "core/graph.h"
+
+namespace infini
+{
+    struct MemorySchedule
+    {
+        // the peak live activation bytes of the order before and after
+        size_t peakBefore = 0, peakAfter = 0;
+        // whether the order is proven to have the lowest peak
+        bool exact = false;
+    };
+
+    /**
+     * @brief Reorders the ops of a graph to lower the peak of the activation
+     * memory planned by dataMalloc().
+     *
+     * The memory is modeled the way dataMalloc() plans it: the graph inputs
+     * are live from the start, an op allocates its outputs before releasing
+     * the inputs it was the last reader of, and the graph outputs are never
+     * released. Views take no memory but keep their base live, and the
+     * constants are outside of the activations.
+     *
+     * Graphs of up to `exactLimit` ops get an optimal order from a dynamic
+     * program over the sets of scheduled ops. Larger ones are scheduled
+     * greedily: the ready op growing the live memory the least goes first,
+     * counting the memory its successors would release right after it. The
+     * current order is kept unless the new one has a lower peak.
+     */
+    MemorySchedule schedule_for_memory(GraphObj &graph, size_t exactLimit = 16);
+
+} // namespace infini
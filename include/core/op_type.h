@@ -24,6 +24,7 @@ namespace infini
             Relu,
             Sub,
             Transpose,
+            FusedElementwise,
 
         } type;
 
@@ -5,12 +5,16 @@
 
 namespace infini
 {
-    using KernelAttrs = std::tuple<Device, OpType::underlying_t>;
+    // Kernels are registered for a device, an op type and the data type of
+    // the first input
+    using KernelAttrs = std::tuple<Device, OpType::underlying_t, DataType>;
 
     class GraphObj;
     class OperatorObj : public Object
     {
         friend class GraphObj;
+        friend class GraphRewriter;
+        friend class FlatGraph;
 
     protected:
         OpType type;
@@ -54,6 +58,18 @@ namespace infini
         DataType getOutDType() const { return getOutput()->getDType(); }
         virtual int numInputs() const = 0;
         virtual int numOutputs() const = 0;
+        /**
+         * @brief The attributes that change the computation beyond the
+         * shapes and data types of the tensors, e.g. the permutation of a
+         * Transpose.
+         */
+        virtual vector<int> getOpAttrVector() const { return {}; }
+        /**
+         * @brief The op type, attributes and the data types and shapes of the
+         * inputs: ops with equal workloads run the same computation on
+         * different data.
+         */
+        vector<int64_t> getWorkloadVector() const;
 
         /**
          * @brief Clone this operator and replace its inputs and outputs.
@@ -70,6 +86,9 @@ namespace infini
         vector<DataType> inferDataType() const;
 
     private:
+        // position in the ops of the graph holding it, see GraphObj
+        size_t graphIndex = 0;
+
         void addPredecessors(const Operator &op) { predecessors.emplace_back(op); }
         void addSuccessors(const Operator &op) { successors.emplace_back(op); }
         void removePredecessors(const Operator &op);
@@ -0,0 +1,88 @@
+#pragma once
+#include "core/kernel.h"
+#include "utils/cpu_features.h"
+
+namespace infini
+{
+    /**
+     * @brief A graph compiled for execution: the steps of its ops in
+     * topological order, each one a function pointer with its precomputed
+     * parameters. Running the plan only walks that array, the kernel lookup,
+     * the op casts and the shape computations all happened in compile().
+     *
+     * The steps point into the memory of the graph: the graph must outlive
+     * the plan, and a plan must be compiled again after dataMalloc().
+     *
+     * With more than one thread, the steps run on the ThreadPool as soon as
+     * the steps they depend on are done, so independent branches run
+     * concurrently and share the threads with the parallel loops of the
+     * kernels. A step depends on the producers of its inputs and, because
+     * dataMalloc reuses memory, on the earlier steps that accessed the memory
+     * its outputs overwrite.
+     */
+    class PlanObj
+    {
+        struct Step
+        {
+            void (*fn)(const void *params);
+            const void *params;
+        };
+
+        const RuntimeObj *runtime;
+        OpVec ops;
+        vector<string> kernelNames;
+        vector<Step> steps;
+        // keeps the parameters of the steps alive
+        vector<std::shared_ptr<const void>> params;
+        // dependencies of the steps: the number of steps each one waits for
+        // and the steps waiting for it
+        vector<int> nDependencies;
+        vector<vector<size_t>> dependents;
+        // whether some step does not depend on the previous one
+        bool hasConcurrency = false;
+        // what the kernels were selected and prepared with, see isStale()
+        CpuIsa isa;
+        size_t registryVersion;
+
+        void buildDependencies();
+        // Timed steps store their time into `times` if it is not null, and
+        // are recorded by the Tracer when it is enabled
+        template <bool Timed>
+        void runStep(size_t i, double *times) const;
+        template <bool Timed>
+        void runSequential(double *times) const;
+        template <bool Timed>
+        void runConcurrent(double *times) const;
+
+    public:
+        PlanObj(const RuntimeObj *runtime, OpVec ops,
+                const vector<KernelStep> &kernelSteps,
+                vector<string> kernelNames);
+        PlanObj(const PlanObj &) = delete;
+        PlanObj &operator=(const PlanObj &) = delete;
+
+        /**
+         * @brief Runs the steps. With `profiling`, their times are recorded
+         * into the profiler of the runtime, see RuntimeObj::run. The steps
+         * are traced while the Tracer is enabled.
+         */
+        void run(bool profiling = false) const;
+
+        /**
+         * @brief Whether compile() would now select or prepare other kernels:
+         * the instruction set or the kernel registry changed since.
+         */
+        bool isStale() const
+        {
+            return isa != get_cpu_isa() ||
+                   registryVersion != KernelRegistry::getInstance().getVersion();
+        }
+
+        size_t size() const { return steps.size(); }
+        // The op of each step
+        const OpVec &getOperators() const { return ops; }
+        // The name of the kernel of each step
+        const vector<string> &getKernelNames() const { return kernelNames; }
+    };
+
+} // namespace infini
@@ -0,0 +1,64 @@
+#pragma once
+#include "core/common.h"
+#include "core/op_type.h"
+#include "core/ref.h"
+#include <mutex>
+
+namespace infini
+{
+    class OperatorObj;
+
+    // Work of an op: its arithmetic operations and the bytes of its inputs
+    // and outputs
+    struct OpCost
+    {
+        double flops = 0, bytes = 0;
+    };
+    OpCost get_op_cost(const Ref<OperatorObj> &op);
+
+    /**
+     * @brief Timings of the ops run with profiling enabled, see
+     * RuntimeObj::run. The report aggregates them by op type and kernel and
+     * compares them with the roofline of the machine: the time an op would
+     * take at the peak compute or the peak bandwidth, whichever bounds it.
+     */
+    class Profiler
+    {
+    public:
+        struct Record
+        {
+            OpType opType;
+            string kernel;
+            double seconds;
+            OpCost cost;
+        };
+        // Peak GFLOP/s and GB/s
+        struct Roofline
+        {
+            double gflops, gbps;
+        };
+
+    private:
+        vector<Record> records;
+        optional<Roofline> roofline;
+        mutable std::mutex mutex;
+
+    public:
+        void add(const Ref<OperatorObj> &op, const string &kernel,
+                 double seconds);
+        void clear();
+        vector<Record> getRecords() const;
+
+        /**
+         * @brief The roofline given to setRoofline, or else measured once on
+         * all the threads: a large Float32 GEMM for the compute peak and a
+         * large copy for the bandwidth.
+         */
+        Roofline getRoofline();
+        void setRoofline(Roofline peak);
+
+        string report();
+        void printReport() { std::cout << report(); }
+    };
+
+} // namespace infini
@@ -35,6 +35,7 @@ std::vector<WRef<T>> refs_to_wrefs(const std::vector<Ref<T>> &refs) {
 template <typename T>
 std::vector<Ref<T>> wrefs_to_refs(const std::vector<WRef<T>> &wrefs) {
     std::vector<Ref<T>> refs;
+    refs.reserve(wrefs.size());
     for (const auto &wref : wrefs)
         refs.emplace_back(wref);
     return refs;
@@ -1,6 +1,7 @@
 #pragma once
 #include "core/common.h"
 #include "core/op_type.h"
+#include "core/profiler.h"
 #include "core/ref.h"
 
 namespace infini
@@ -10,12 +11,14 @@ namespace infini
   class GraphObj;
   class RuntimeObj;
   class BlobObj;
+  class PlanObj;
 
   using Tensor = Ref<TensorObj>;
   using Operator = Ref<OperatorObj>;
   using Graph = Ref<GraphObj>;
   using Runtime = Ref<RuntimeObj>;
   using Blob = Ref<BlobObj>;
+  using Plan = Ref<PlanObj>;
 
   using TensorVec = vector<Tensor>;
   using OpVec = vector<Operator>;
@@ -29,6 +32,8 @@ namespace infini
   {
   protected:
     Device device;
+    // the ops run with profiling enabled
+    mutable Profiler profiler;
 
   public:
     explicit RuntimeObj(Device device)
@@ -37,10 +42,26 @@ namespace infini
     RuntimeObj &operator=(RuntimeObj const &) = delete;
     virtual ~RuntimeObj() {}
 
-    virtual void run(const Graph &graph) const = 0;
+    /**
+     * @brief Runs the ops of a graph through its plan, see compile(). The plan
+     * is kept by the graph until its ops, its memory, the instruction set or
+     * the kernel registry change, so that a run only walks the compiled steps
+     * and independent branches run concurrently. With `profiling`, the time
+     * of every op is recorded into getProfiler(), and the ops are traced
+     * while the Tracer is enabled; otherwise nothing is measured.
+     */
+    virtual void run(const Graph &graph, bool profiling = false) const = 0;
+    /**
+     * @brief Resolves the kernel and the parameters of every op of a graph
+     * whose data is allocated, see PlanObj.
+     */
+    virtual Plan compile(const Graph &graph) const = 0;
     virtual void *alloc(size_t size) = 0;
     virtual void dealloc(void *ptr) = 0;
 
+    Profiler &getProfiler() const { return profiler; }
+    Device getDevice() const { return device; }
+
     bool isCpu() const
     {
       return true;
@@ -61,7 +82,8 @@ namespace infini
       return instance;
     }
     void dealloc(void *ptr) override;
-    void run(const Graph &graph) const override;
+    void run(const Graph &graph, bool profiling = false) const override;
+    Plan compile(const Graph &graph) const override;
     void *alloc(size_t size) override;
     string toString() const override;
   };
@@ -3,6 +3,7 @@
 #include "core/data_type.h"
 #include "core/object.h"
 #include "core/runtime.h"
+#include "utils/small_vector.h"
 #include <cmath>
 #include <cstring>
 #include <fstream>
@@ -10,11 +11,15 @@
 namespace infini
 {
     class GraphObj;
-    using ShapeElem = int;
-    using Shape = vector<ShapeElem>;
+    // 64-bit extents, as a tensor may hold more than 2^31 elements
+    using ShapeElem = int64_t;
+    // Up to 8 dims are held inline, without a heap allocation
+    using Shape = SmallVector<ShapeElem, 8>;
     class TensorObj : public Object
     {
         friend class GraphObj;
+        friend class GraphRewriter;
+        friend class FlatGraph;
 
     protected:
         int dim;
@@ -24,6 +29,17 @@ namespace infini
         WRef<OperatorObj> source;
         Blob data;
         Runtime runtime;
+        // the data is known before the graph runs, see GraphObj::addConstant
+        bool constant = false;
+        // position in the tensors of the graph holding it, see GraphObj
+        size_t graphIndex = 0;
+        // A view aliases the data of `viewBase` instead of owning a buffer:
+        // its element at index i is at `offset` bytes from the data of the
+        // base plus Σ i[d] * strides[d] elements. Empty strides are the dense
+        // row-major ones.
+        Tensor viewBase;
+        vector<size_t> strides;
+        size_t offset = 0;
 
     private:
         Shape shape;
@@ -39,10 +55,20 @@ namespace infini
         size_t size() const { return _size; }
         size_t getBytes() const { return _size * dtype.getSize(); }
 
-        Shape getDims() const { return shape; }
+        const Shape &getDims() const { return shape; }
         void setShape(Shape shape_);
         size_t getRank() const { return shape.size(); }
         UidBaseType getFuid() const { return fuid; }
+        bool isConstant() const { return constant; }
+
+        // Elements between consecutive indices along every dim
+        vector<size_t> getStrides() const;
+        // Whether the elements are laid out densely in row-major order
+        bool isContiguous() const;
+        bool isView() const { return viewBase != nullptr; }
+        // The tensor owning the data of a view, or null
+        Tensor getViewBase() const { return viewBase; }
+        size_t getOffset() const { return offset; }
 
         void setData(
             std::function<void(void *, size_t, DataType)> const &generator) const;
@@ -83,7 +109,7 @@ namespace infini
             builder << "Tensor: " << guid << std::endl;
 
             auto numDims = shape.size();
-            auto dimSzVec = vector<int>(numDims, 1);
+            auto dimSzVec = vector<size_t>(numDims, 1);
             auto ptr = data->getPtr<T *>();
             dimSzVec[numDims - 1] = shape[numDims - 1];
 
@@ -98,7 +124,7 @@ namespace infini
 
                 builder << ptr[i];
                 for (size_t j = 0; j < numDims; ++j)
-                    if ((int)i % dimSzVec[j] == dimSzVec[j] - 1)
+                    if (i % dimSzVec[j] == dimSzVec[j] - 1)
                         builder << "]";
 
                 if (i != size() - 1)
@@ -122,20 +148,21 @@ namespace infini
                     if (a[i] != b[i])
                         return false;
                 }
-                else if constexpr (std::is_floating_point_v<T>)
+                else if constexpr (std::is_floating_point_v<T> ||
+                                   is_half_v<T>)
                 {
-                    if (std::min(fabs(a[i]), fabs(b[i])) == 0. &&
-                        fabs(a[i] - b[i]) > relativeError)
+                    double x = a[i], y = b[i];
+                    if (std::min(fabs(x), fabs(y)) == 0. &&
+                        fabs(x - y) > relativeError)
                     {
-                        printf("Error on %lu: %f %f\n", i, a[i], b[i]);
+                        printf("Error on %lu: %f %f\n", i, x, y);
                         return false;
                     }
-                    else if (std::min(fabs(a[i]), fabs(b[i])) != 0. &&
-                             fabs(a[i] - b[i]) /
-                                     std::max(fabs(a[i]), fabs(b[i])) >
+                    else if (std::min(fabs(x), fabs(y)) != 0. &&
+                             fabs(x - y) / std::max(fabs(x), fabs(y)) >
                                  relativeError)
                     {
-                        printf("Error on %lu: %f %f\n", i, a[i], b[i]);
+                        printf("Error on %lu: %f %f\n", i, x, y);
                         return false;
                     }
                 }
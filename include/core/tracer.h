@@ -0,0 +1,83 @@
+#pragma once
+#include "core/common.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+namespace infini
+{
+    class OperatorObj;
+
+    /**
+     * @brief Records the execution timeline in the Chrome trace event format,
+     * readable by chrome://tracing and Perfetto. While enabled, every op run
+     * by RuntimeObj::run or PlanObj::run becomes a slice on the thread that
+     * ran it, and GraphObj::dataMalloc emits the allocator usage as counters.
+     *
+     * Events go to per-thread buffers without any locking and only hold raw
+     * pointers and timestamps. The buffers are flushed, and the events
+     * formatted, once the run is over.
+     */
+    class Tracer
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        struct RawEvent
+        {
+            // a slice of `op` run by `kernel`, or else an allocator counter
+            const OperatorObj *op;
+            const string *kernel;
+            Clock::time_point begin, end;
+            size_t used, peak;
+        };
+        struct ThreadBuffer
+        {
+            int tid;
+            vector<RawEvent> events;
+        };
+
+        std::atomic<bool> enabled{false};
+        Clock::time_point origin;
+        std::mutex mutex; // guards the buffer list and the flushed events
+        vector<std::unique_ptr<ThreadBuffer>> buffers;
+        vector<string> events; // flushed, as JSON objects
+
+        ThreadBuffer &localBuffer();
+
+    public:
+        static Tracer &getInstance();
+
+        // Clears the trace and starts recording
+        void start();
+        void stop() { enabled.store(false, std::memory_order_relaxed); }
+        bool isEnabled() const
+        {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        void recordOp(const OperatorObj *op, const string *kernel,
+                      Clock::time_point begin, Clock::time_point end)
+        {
+            localBuffer().events.push_back({op, kernel, begin, end, 0, 0});
+        }
+        void recordAllocator(size_t used, size_t peak)
+        {
+            auto now = Clock::now();
+            localBuffer().events.push_back(
+                {nullptr, nullptr, now, now, used, peak});
+        }
+
+        /**
+         * @brief Formats the events recorded so far. The recording threads
+         * must be done and the ops of the events alive.
+         */
+        void flush();
+        // The flushed events as a trace event JSON document
+        string toJson();
+        void save(const string &path);
+    };
+
+} // namespace infini
@@ -0,0 +1,56 @@
+#pragma once
+#include "core/runtime.h"
+#include "core/tensor.h"
+#include <cstddef>
+#include <unordered_map>
+
+namespace infini {
+  /**
+   * @brief The memory of the constant tensors of a graph, apart from the
+   * activations planned by Allocator.
+   *
+   * A constant gets a writable staging buffer of its own as soon as it is
+   * created, so that it can be filled, and constant ops evaluated on it, before
+   * the graph is planned. seal() then packs every constant still in the graph
+   * into one page-aligned mapping and makes it read-only.
+   */
+  class WeightArena
+  {
+  private:
+    Runtime runtime;
+
+    // the staging buffer of every constant until seal(), which also keeps the
+    // tensor alive so that its address is not reused meanwhile
+    std::unordered_map<TensorObj *, std::pair<Tensor, void *>> staged;
+
+    // the read-only mapping and its size, after seal()
+    void *ptr;
+    size_t size;
+    bool sealed;
+
+    // alignment of every constant inside the mapping, a cache line
+    static constexpr size_t alignment = 64;
+
+  public:
+    explicit WeightArena(Runtime runtime);
+
+    WeightArena(const WeightArena &) = delete;
+    WeightArena &operator=(const WeightArena &) = delete;
+
+    ~WeightArena();
+
+    // function: give a constant a zeroed, writable staging buffer
+    void stage(const Tensor &tensor);
+
+    // function: free the staging buffer of a constant dropped from the graph
+    void release(const Tensor &tensor);
+
+    // function: move the constants among `tensors` into the read-only
+    //     mapping, and free the staging buffers of all of them
+    void seal(const TensorVec &tensors);
+
+    bool isSealed() const { return sealed; }
+
+    size_t getSize() const { return size; }
+  };
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "core/tensor.h"
+#include "utils/small_vector.h"
+
+namespace infini {
+
+/**
+ * @brief Walks the output of a broadcasting op row by row.
+ *
+ * Inputs are right-aligned to the output shape (numpy/ONNX broadcasting).
+ * Output dims of extent 1 are dropped, and adjacent dims are merged whenever
+ * every input is contiguous across them, so that a same-shape op becomes a
+ * single row and e.g. [2,3,4,5] + [4,5] becomes [6] x [20]. Every input gets
+ * a stride per remaining dim, 0 along the dims it is broadcast on.
+ *
+ * The last remaining dim is the inner loop: the kernel is called once per
+ * row with the offset of the row in the output and in every input, and walks
+ * `innerSize()` elements with the per-input `innerStride()`, which is 1 or 0
+ * for contiguous inputs. A strided input, e.g. a transposed view, walks its
+ * own strides, which may be anything along the rows too.
+ * Only the outer dims are tracked with an odometer, so no division happens
+ * inside the loops.
+ */
+class BroadcastIterator {
+  public:
+    enum class Kind {
+        SameShape,       // a single row, every input is contiguous
+        ScalarBroadcast, // a single row, some inputs are a single element
+        RowBroadcast,    // rows of a matrix, inputs are full or a single row
+        General,
+    };
+
+  private:
+    size_t nInputs;
+    size_t outSize;
+    vector<size_t> dims;    // coalesced output dims, outermost first
+    vector<size_t> strides; // strides[i * dims.size() + d] for input i
+    Kind _kind;
+
+  public:
+    /**
+     * @brief `inputStrides` holds the strides of every input, see
+     * TensorObj::getStrides(), or is empty for contiguous inputs.
+     */
+    BroadcastIterator(const Shape &output, const vector<Shape> &inputs,
+                      const vector<vector<size_t>> &inputStrides = {});
+    // The layout of the inputs is that of the tensors
+    BroadcastIterator(const Tensor &output, const TensorVec &inputs);
+
+    Kind kind() const { return _kind; }
+    size_t size() const { return outSize; }
+    size_t innerSize() const { return dims.back(); }
+    size_t rows() const { return outSize == 0 ? 0 : outSize / dims.back(); }
+    size_t stride(size_t input, size_t dim) const {
+        return strides[input * dims.size() + dim];
+    }
+    size_t innerStride(size_t input) const {
+        return stride(input, dims.size() - 1);
+    }
+    const vector<size_t> &getDims() const { return dims; }
+
+    /**
+     * @brief Calls `f(outOffset, inOffsets)` for the rows in [begin, end),
+     * where `inOffsets[i]` is the offset of the row in input i.
+     */
+    template <typename F>
+    void forEachRow(size_t begin, size_t end, F &&f) const {
+        if (begin >= end)
+            return;
+        const size_t rank = dims.size(), outer = rank - 1;
+        SmallVector<size_t, 8> index(outer), offsets(nInputs, 0);
+        // position the odometer on the first row
+        for (size_t d = outer, rest = begin; d-- > 0;) {
+            index[d] = rest % dims[d];
+            rest /= dims[d];
+            for (size_t i = 0; i < nInputs; ++i)
+                offsets[i] += index[d] * strides[i * rank + d];
+        }
+        const size_t inner = innerSize();
+        for (size_t row = begin; row < end; ++row) {
+            f(row * inner, offsets.data());
+            for (size_t d = outer; d-- > 0;) {
+                for (size_t i = 0; i < nInputs; ++i)
+                    offsets[i] += strides[i * rank + d];
+                if (++index[d] < dims[d])
+                    break;
+                for (size_t i = 0; i < nInputs; ++i)
+                    offsets[i] -= dims[d] * strides[i * rank + d];
+                index[d] = 0;
+            }
+        }
+    }
+
+    template <typename F> void forEachRow(F &&f) const {
+        forEachRow(0, rows(), std::forward<F>(f));
+    }
+};
+
+} // namespace infini
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+
+namespace infini {
+
+/**
+ * @brief Strided view of a row-major matrix operand. Element (i, j) lives at
+ * `ptr[i * rowStride + j * colStride]`, so a transposed operand is described
+ * by swapping the strides instead of materializing the transpose.
+ */
+template <typename T> struct MatrixRef {
+    const T *ptr;
+    ptrdiff_t rowStride, colStride;
+};
+
+/**
+ * @brief C = A * B, where A is m x k, B is k x n and C is a dense m x n
+ * matrix with leading dimension ldc.
+ *
+ * The product is cache-blocked (MC x KC blocks of A, KC x NC blocks of B),
+ * both operands are packed into contiguous MR/NR panels and every MR x NR
+ * tile of C is computed by a register-blocked micro-kernel. Float32 uses an
+ * AVX-512 or AVX2/FMA micro-kernel selected by get_cpu_isa(), other types
+ * and older CPUs use a portable scalar one.
+ */
+template <typename T>
+void gemm(size_t m, size_t n, size_t k, MatrixRef<T> A, MatrixRef<T> B, T *C,
+          size_t ldc);
+
+/**
+ * @brief Number of threads along the batch, M and N dims of a batched GEMM.
+ */
+struct GemmPartition {
+    int batch, m, n;
+    int threads() const { return batch * m * n; }
+};
+
+/**
+ * @brief Chooses how to split a batched GEMM among at most nThreads threads.
+ * M and N are split on micro-tile boundaries, and the split minimizes the
+ * estimated per-thread cost, i.e. the multiply-adds plus the packing of the
+ * rows of A and columns of B that the thread touches. Small problems use
+ * fewer threads.
+ */
+template <typename T>
+GemmPartition partitionGemm(size_t batch, size_t m, size_t n, size_t k,
+                            int nThreads);
+
+/**
+ * @brief Cache blocks overriding the default ones of the micro-kernel, 0
+ * keeps the default. mc and nc are rounded up to the register block.
+ */
+struct GemmBlocking {
+    size_t mc = 0, nc = 0, kc = 0;
+};
+
+/**
+ * @brief Applied to every element of C as its tile is stored, while the tile
+ * is still in registers: c = min(max(c + bias[j], lo), hi), where j is the
+ * column of c. A null bias adds nothing.
+ */
+template <typename T> struct GemmEpilogue {
+    const T *bias;
+    T lo, hi;
+};
+
+/**
+ * @brief C[b] = A[b] * B[b] for b in [0, batch), where the matrices of A and
+ * B start at `offsetsA[b]` and `offsetsB[b]` elements from their views and C
+ * is dense with `m * n` elements per matrix. Runs on get_num_threads()
+ * threads, partitioned by partitionGemm. An `epilogue`, if any, is applied to
+ * the whole of C.
+ */
+template <typename T>
+void batchedGemm(size_t batch, size_t m, size_t n, size_t k, MatrixRef<T> A,
+                 const size_t *offsetsA, MatrixRef<T> B,
+                 const size_t *offsetsB, T *C, GemmBlocking blocking = {},
+                 const GemmEpilogue<T> *epilogue = nullptr);
+
+} // namespace infini
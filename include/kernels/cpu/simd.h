@@ -0,0 +1,66 @@
+#pragma once
+#include "utils/cpu_features.h"
+#include "utils/data_convert.h"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace infini {
+
+/**
+ * @brief Float32 loops over one contiguous row, vectorized for a single
+ * instruction set. The binary loops take the stride of each operand, 1 for
+ * a contiguous operand or 0 to broadcast its first element. The conversions
+ * to and from Float16/BFloat16 work on the raw 16 bit patterns and round to
+ * nearest even.
+ */
+struct SimdKernels {
+    using BinaryRow = void (*)(size_t n, const float *a, size_t strideA,
+                               const float *b, size_t strideB, float *c);
+    BinaryRow add, sub, mul, div;
+    void (*relu)(size_t n, const float *x, float *y);
+    void (*clip)(size_t n, const float *x, float *y, float lo, float hi);
+    void (*toFloat16)(size_t n, const float *x, uint16_t *y);
+    void (*fromFloat16)(size_t n, const uint16_t *x, float *y);
+    void (*toBFloat16)(size_t n, const float *x, uint16_t *y);
+    void (*fromBFloat16)(size_t n, const uint16_t *x, float *y);
+};
+
+// The loops vectorized for `isa`
+const SimdKernels &get_simd_kernels(CpuIsa isa);
+
+using WidenRow = void (*)(size_t n, const uint16_t *x, float *y);
+using NarrowRow = void (*)(size_t n, const float *x, uint16_t *y);
+
+/**
+ * @brief The rows converting T, float16_t or bfloat16_t, to and from
+ * Float32, or null ones for float.
+ */
+template <typename T>
+std::pair<WidenRow, NarrowRow> half_conversions(const SimdKernels &kernels) {
+    if constexpr (std::is_same_v<T, float16_t>)
+        return {kernels.fromFloat16, kernels.toFloat16};
+    else if constexpr (std::is_same_v<T, bfloat16_t>)
+        return {kernels.fromBFloat16, kernels.toBFloat16};
+    else
+        return {nullptr, nullptr};
+}
+
+// Float16/BFloat16 rows are computed in Float32 by chunks of this many
+// elements, small enough to stay in L1
+constexpr size_t halfChunk = 256;
+
+template <typename T> const uint16_t *bits(const T *x) {
+    static_assert(is_half_v<T>);
+    return reinterpret_cast<const uint16_t *>(x);
+}
+template <typename T> uint16_t *bits(T *x) {
+    static_assert(is_half_v<T>);
+    return reinterpret_cast<uint16_t *>(x);
+}
+
+// memcpy with non-temporal stores, for outputs that would only evict the
+// cache. Falls back to memcpy without SSE.
+void stream_copy(void *dst, const void *src, size_t bytes);
+
+} // namespace infini
@@ -0,0 +1,64 @@
+#pragma once
+#include "core/operator.h"
+
+namespace infini
+{
+  /**
+   * @brief One step of the expression program of a FusedElementwiseObj.
+   *
+   * Registers [0, #inputs) hold the inputs of the fused op, register
+   * #inputs + i holds the result of step i, and the result of the last step is
+   * the output.
+   */
+  struct ElementwiseStep
+  {
+    // Add, Sub, Mul, Div, Relu, Clip or Cast
+    OpType type;
+    // the operand registers, `b` only for the binary ops
+    int a, b;
+    // the bounds of a Clip, a missing bound does not clamp
+    std::optional<float> min, max;
+    // the type of the result, the target type of a Cast
+    DataType dtype;
+  };
+
+  /**
+   * @brief A connected subgraph of element-wise ops, evaluated in a single
+   * pass over its inputs without materializing the intermediate tensors.
+   * Inputs broadcast to the shape of the output like the inputs of
+   * ElementWiseObj.
+   */
+  class FusedElementwiseObj : public OperatorObj
+  {
+  public:
+    /**
+     * @brief Construct a new FusedElementwise object
+     *
+     * @param graph The computation graph that this operator belongs to.
+     * @param inputs The tensors read by the program.
+     * @param output The output tensor.
+     * @param program The steps, in evaluation order.
+     */
+    FusedElementwiseObj(GraphObj *graph, TensorVec inputs, Tensor output,
+                        vector<ElementwiseStep> program);
+    OP_CLONE(FusedElementwiseObj);
+    optional<vector<Shape>> inferShape(const TensorVec &inputs) override;
+    vector<DataType> inferDataType(const TensorVec &inputs) const override;
+
+    std::string toString() const override;
+    int numInputs() const override { return inputs.size(); }
+    int numOutputs() const override { return 1; }
+    const vector<ElementwiseStep> &getProgram() const { return program; }
+    vector<int> getOpAttrVector() const override;
+
+    /**
+     * @brief If `op` is an element-wise op a FusedElementwiseObj can evaluate.
+     * The CPU kernel computes in Float32, so every tensor must be of
+     * Float32, Float16 or BFloat16.
+     */
+    static bool canFuse(const Operator &op);
+
+  private:
+    vector<ElementwiseStep> program;
+  };
+}; // namespace infini
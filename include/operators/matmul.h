@@ -3,6 +3,16 @@
 
 namespace infini
 {
+    /**
+     * @brief Activation applied by a MatMul to its output as it is stored.
+     */
+    enum class ActType
+    {
+        None,
+        Relu,
+        Clip,
+    };
+
     /**
      * @brief Matrix multiplication.
      *
@@ -14,9 +24,13 @@ namespace infini
         // default dims, true means A should be transposed before matmul. This is in
         // oppsite to the column-major BLAS.
         bool transA, transB;
+        // The epilogue: C = act(A * B + bias), where the optional third input
+        // `bias` is a row of n elements added to every row of C.
+        ActType act;
+        std::optional<float> actMin, actMax;
 
         // Auxiliary attributes which are not a part of operator attributes.
-        int m, n, k;
+        ShapeElem m, n, k;
 
     public:
         /**
@@ -37,9 +51,16 @@ namespace infini
          * the constructor, C should be an empty Ref.
          * @param transA If matrix A should be transposed when computing.
          * @param transB If matrix B should be transposed when computing.
+         * @param bias Optional row of n elements, of shape [n] or [1, ..., 1, n],
+         * added to every row of the product.
+         * @param act Activation of the sum. Relu clamps it to [0, +inf), Clip to
+         * [actMin, actMax], where a missing bound does not clamp.
          */
         MatmulObj(GraphObj *graph, Tensor A, Tensor B, Tensor C,
-                  bool transA = false, bool transB = false);
+                  bool transA = false, bool transB = false,
+                  Tensor bias = nullptr, ActType act = ActType::None,
+                  std::optional<float> actMin = std::nullopt,
+                  std::optional<float> actMax = std::nullopt);
         OP_CLONE(MatmulObj);
 
         std::string toString() const override;
@@ -52,9 +73,21 @@ namespace infini
         bool getTransB() const { return transB; }
         void setTransA(bool transA) { this->transA = transA; }
         void setTransB(bool transB) { this->transB = transB; }
-        int getM() const { return m; }
-        int getN() const { return n; }
-        int getK() const { return k; }
+        Tensor getBias() const
+        {
+            return inputs.size() > 2 ? inputs[2] : nullptr;
+        }
+        ActType getAct() const { return act; }
+        // The bounds the output is clamped to, Relu has a lower bound of 0
+        std::optional<float> getActMin() const { return actMin; }
+        std::optional<float> getActMax() const { return actMax; }
+        vector<int> getOpAttrVector() const override
+        {
+            return {transA, transB, int(act)};
+        }
+        ShapeElem getM() const { return m; }
+        ShapeElem getN() const { return n; }
+        ShapeElem getK() const { return k; }
     };
 
 } // namespace infini
\ No newline at end of file
@@ -83,6 +83,7 @@ namespace infini
 
     std::string toString() const override;
     CastType getType() const { return castType; }
+    vector<int> getOpAttrVector() const override { return {int(castType)}; }
     DataType getOutputDataType() const;
     int numInputs() const override { return 1; }
     int numOutputs() const override { return 1; }
@@ -2,3 +2,16 @@
 #include "core/common.h"
 #include "utils/data_generator.h"
 #include "gtest/gtest.h"
+#include <unistd.h>
+
+namespace infini
+{
+    // A path for a file of the running test in the temporary directory,
+    // unique across concurrent test processes
+    inline string tempTestPath(const string &extension)
+    {
+        auto info = ::testing::UnitTest::GetInstance()->current_test_info();
+        return ::testing::TempDir() + info->test_suite_name() + "_" +
+               info->name() + "_" + std::to_string(getpid()) + extension;
+    }
+} // namespace infini
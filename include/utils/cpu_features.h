@@ -0,0 +1,22 @@
+#pragma once
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <string>
+
+namespace infini {
+
+// Instruction set levels the CPU kernels have specialised code paths for,
+// ordered from the least to the most capable.
+enum class CpuIsa { Scalar = 0, SSE = 1, AVX2 = 2, AVX512 = 3 };
+
+// The best instruction set of this machine, detected once through CPUID and
+// capped by set_max_cpu_isa.
+CpuIsa get_cpu_isa();
+// Limit the instruction set used by the kernels, e.g. to test fallbacks
+void set_max_cpu_isa(CpuIsa isa);
+std::string cpu_isa_to_str(CpuIsa isa);
+
+} // namespace infini
+
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+#ifndef DATA_CONVERT_H
+#define DATA_CONVERT_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace infini {
+
+// IEEE half precision bits of `x`, rounded to nearest even. NaNs stay quiet
+// NaNs with the top bits of their payload.
+inline uint16_t float_to_fp16(float x) {
+    uint32_t u;
+    std::memcpy(&u, &x, sizeof(u));
+    uint16_t sign = (u >> 16) & 0x8000;
+    u &= 0x7fffffff;
+    if (u >= 0x47800000) // >= 65536, Inf or NaN
+        return sign | (u > 0x7f800000 ? 0x7e00 | ((u >> 13) & 0x3ff) : 0x7c00);
+    if (u < 0x38800000) { // < 2^-14, subnormal or zero
+        // adding 0.5 lets the FPU round the mantissa into the low bits
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        f += 0.5f;
+        std::memcpy(&u, &f, sizeof(u));
+        return sign | uint16_t(u - 0x3f000000);
+    }
+    // rebias the exponent and round the 13 dropped mantissa bits
+    u += 0xc8000fff + ((u >> 13) & 1);
+    return sign | uint16_t(u >> 13);
+}
+
+inline float fp16_to_float(uint16_t h) {
+    uint32_t sign = uint32_t(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f, mant = h & 0x3ff, u;
+    if (exp == 0) {
+        float f = float(mant) * 5.9604644775390625e-8f; // 2^-24
+        std::memcpy(&u, &f, sizeof(u));
+    } else if (exp == 0x1f)
+        u = 0x7f800000 | (mant << 13);
+    else
+        u = ((exp + 112) << 23) | (mant << 13);
+    u |= sign;
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// bfloat16 bits of `x`, rounded to nearest even. NaNs stay quiet NaNs.
+inline uint16_t float_to_bf16(float x) {
+    uint32_t u;
+    std::memcpy(&u, &x, sizeof(u));
+    if ((u & 0x7fffffff) > 0x7f800000)
+        return (u >> 16) | 0x40;
+    return (u + 0x7fff + ((u >> 16) & 1)) >> 16;
+}
+
+inline float bf16_to_float(uint16_t h) {
+    uint32_t u = uint32_t(h) << 16;
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+/**
+ * @brief Elements of Float16 and BFloat16 tensors. They only store the bits
+ * and convert to and from float, so arithmetic and comparisons happen in
+ * float and round once when stored back.
+ */
+struct float16_t {
+    uint16_t bits;
+    float16_t() = default;
+    float16_t(float x) : bits(float_to_fp16(x)) {}
+    operator float() const { return fp16_to_float(bits); }
+};
+
+struct bfloat16_t {
+    uint16_t bits;
+    bfloat16_t() = default;
+    bfloat16_t(float x) : bits(float_to_bf16(x)) {}
+    operator float() const { return bf16_to_float(bits); }
+};
+
+template <typename T>
+constexpr bool is_half_v =
+    std::is_same_v<T, float16_t> || std::is_same_v<T, bfloat16_t>;
+
+} // namespace infini
+
+#endif
@@ -9,19 +9,58 @@ class DataGenerator {
   private:
     virtual void fill(uint32_t *data, size_t size) { IT_TODO_HALT(); }
     virtual void fill(float *data, size_t size) { IT_TODO_HALT(); }
+    virtual void fill(double *data, size_t size) { IT_TODO_HALT(); }
+    virtual void fill(int8_t *data, size_t size) { IT_TODO_HALT(); }
+    virtual void fill(int32_t *data, size_t size) { IT_TODO_HALT(); }
+    virtual void fill(int64_t *data, size_t size) { IT_TODO_HALT(); }
+    virtual void fill(float16_t *data, size_t size) { IT_TODO_HALT(); }
+    virtual void fill(bfloat16_t *data, size_t size) { IT_TODO_HALT(); }
 
-public:
+  public:
     virtual ~DataGenerator() {}
     void operator()(void *data, size_t size, DataType dataType) {
-        if (dataType == DataType::UInt32)
-            fill(reinterpret_cast<uint32_t *>(data), size);
-        else if (dataType == DataType::Float32)
-            fill(reinterpret_cast<float *>(data), size);
-        else
-            IT_TODO_HALT();
+#define CASE(TYPE, T)                                                          \
+    if (dataType == DataType::TYPE)                                            \
+        return fill(reinterpret_cast<T *>(data), size);
+
+        CASE(UInt32, uint32_t)
+        CASE(Float32, float)
+        CASE(Double, double)
+        CASE(Int8, int8_t)
+        CASE(Int32, int32_t)
+        CASE(Int64, int64_t)
+        CASE(Float16, float16_t)
+        CASE(BFloat16, bfloat16_t)
+        IT_TODO_HALT();
+#undef CASE
     }
 };
 
+// Overrides every fill of DataGenerator with the template `fill<T>`
+#define OVERRIDE_FILLS                                                         \
+    void fill(uint32_t *data, size_t size) override {                         \
+        fill<uint32_t>(data, size);                                            \
+    }                                                                          \
+    void fill(float *data, size_t size) override { fill<float>(data, size); }  \
+    void fill(double *data, size_t size) override {                           \
+        fill<double>(data, size);                                              \
+    }                                                                          \
+    void fill(int8_t *data, size_t size) override {                           \
+        fill<int8_t>(data, size);                                              \
+    }                                                                          \
+    void fill(int32_t *data, size_t size) override {                          \
+        fill<int32_t>(data, size);                                             \
+    }                                                                          \
+    void fill(int64_t *data, size_t size) override {                          \
+        fill<int64_t>(data, size);                                             \
+    }                                                                          \
+    void fill(float16_t *data, size_t size) override {                        \
+        fill<float16_t>(data, size);                                           \
+    }                                                                          \
+    void fill(bfloat16_t *data, size_t size) override {                       \
+        fill<bfloat16_t>(data, size);                                          \
+    }
+
 class IncrementalGenerator : public DataGenerator {
   public:
     virtual ~IncrementalGenerator() {}
@@ -33,10 +72,7 @@ class IncrementalGenerator : public DataGenerator {
         }
     }
 
-    void fill(uint32_t *data, size_t size) override {
-        fill<uint32_t>(data, size);
-    }
-    void fill(float *data, size_t size) override { fill<float>(data, size); }
+    OVERRIDE_FILLS
 };
 
 template <int val> class ValGenerator : public DataGenerator {
@@ -50,11 +86,10 @@ template <int val> class ValGenerator : public DataGenerator {
         }
     }
 
-    void fill(uint32_t *data, size_t size) override {
-        fill<uint32_t>(data, size);
-    }
-    void fill(float *data, size_t size) override { fill<float>(data, size); }
+    OVERRIDE_FILLS
 };
 typedef ValGenerator<1> OneGenerator;
 typedef ValGenerator<0> ZeroGenerator;
+
+#undef OVERRIDE_FILLS
 } // namespace infini
@@ -0,0 +1,45 @@
+#pragma once
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "utils/thread_pool.h"
+#include <algorithm>
+#include <cstddef>
+
+namespace infini {
+
+// Number of threads the CPU kernels may use. Defaults to the OpenMP thread
+// count (OMP_NUM_THREADS or the number of cores).
+int get_num_threads();
+// Change the number of threads used by the CPU kernels, a non-positive value
+// restores the default.
+void set_num_threads(int nThreads);
+
+/**
+ * @brief Calls `f(begin, end)` on consecutive chunks covering [0, n), in
+ * parallel on up to get_num_threads() threads of the ThreadPool. Every chunk
+ * but the last holds at least `grain` items, so small ranges run on the
+ * calling thread, which always takes the first chunk.
+ */
+template <typename F> void parallel_for(size_t n, size_t grain, F &&f) {
+    int nThreads = get_num_threads();
+    size_t nChunks =
+        std::min<size_t>(nThreads, n / std::max<size_t>(grain, 1));
+    if (nChunks <= 1) {
+        if (n > 0)
+            f(size_t(0), n);
+        return;
+    }
+    ThreadPool::getInstance().reserve(nThreads);
+    TaskGroup group;
+    for (size_t i = 1; i < nChunks; ++i)
+        group.run([&f, n, i, nChunks] {
+            f(n * i / nChunks, n * (i + 1) / nChunks);
+        });
+    f(size_t(0), n / nChunks);
+    group.wait();
+}
+
+} // namespace infini
+
+#endif
@@ -0,0 +1,231 @@
+#pragma once
+#ifndef SMALL_VECTOR_H
+#define SMALL_VECTOR_H
+
+#include "core/common.h"
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+
+namespace infini {
+
+/**
+ * @brief A vector of trivially copyable elements keeping the first `N` of
+ * them inline, so that a small one, e.g. a Shape, is built, copied and
+ * destroyed without touching the heap. It moves to the heap when it grows
+ * larger, like a std::vector.
+ */
+template <typename T, size_t N> class SmallVector {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "SmallVector only holds trivially copyable elements");
+    static_assert(N > 0);
+
+    T *ptr;
+    size_t count = 0, cap = N;
+    T buffer[N];
+
+    bool isInline() const { return ptr == buffer; }
+
+    void grow(size_t minCap) {
+        size_t newCap = std::max(minCap, cap * 2);
+        T *p = static_cast<T *>(::operator new(newCap * sizeof(T)));
+        std::memcpy(p, ptr, count * sizeof(T));
+        if (!isInline())
+            ::operator delete(ptr);
+        ptr = p;
+        cap = newCap;
+    }
+
+  public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T &;
+    using const_reference = const T &;
+    using pointer = T *;
+    using const_pointer = const T *;
+    using iterator = T *;
+    using const_iterator = const T *;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    SmallVector() : ptr(buffer) {}
+    explicit SmallVector(size_t n, const T &value = T()) : SmallVector() {
+        assign(n, value);
+    }
+    SmallVector(std::initializer_list<T> init) : SmallVector() {
+        assign(init.begin(), init.end());
+    }
+    template <typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+    SmallVector(It first, It last) : SmallVector() {
+        assign(first, last);
+    }
+    template <typename U>
+    explicit SmallVector(const std::vector<U> &vec)
+        : SmallVector(vec.begin(), vec.end()) {}
+
+    SmallVector(const SmallVector &other) : SmallVector() {
+        assign(other.begin(), other.end());
+    }
+    SmallVector(SmallVector &&other) noexcept : SmallVector() {
+        *this = std::move(other);
+    }
+    ~SmallVector() {
+        if (!isInline())
+            ::operator delete(ptr);
+    }
+
+    SmallVector &operator=(const SmallVector &other) {
+        if (this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+    SmallVector &operator=(SmallVector &&other) noexcept {
+        if (this == &other)
+            return *this;
+        if (other.isInline()) {
+            // inline elements are copied, the buffer is not ours to take
+            count = 0;
+            if (other.count > cap)
+                grow(other.count);
+            std::memcpy(ptr, other.ptr, other.count * sizeof(T));
+            count = other.count;
+        } else {
+            if (!isInline())
+                ::operator delete(ptr);
+            ptr = other.ptr;
+            cap = other.cap;
+            count = other.count;
+            other.ptr = other.buffer;
+            other.cap = N;
+        }
+        other.count = 0;
+        return *this;
+    }
+    SmallVector &operator=(std::initializer_list<T> init) {
+        assign(init.begin(), init.end());
+        return *this;
+    }
+
+    void assign(size_t n, const T &value) {
+        count = 0;
+        resize(n, value);
+    }
+    template <typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+    void assign(It first, It last) {
+        count = 0;
+        reserve(std::distance(first, last));
+        for (; first != last; ++first)
+            ptr[count++] = static_cast<T>(*first);
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t capacity() const { return cap; }
+    T *data() { return ptr; }
+    const T *data() const { return ptr; }
+
+    T &operator[](size_t i) { return ptr[i]; }
+    const T &operator[](size_t i) const { return ptr[i]; }
+    T &at(size_t i) {
+        IT_ASSERT(i < count);
+        return ptr[i];
+    }
+    const T &at(size_t i) const {
+        IT_ASSERT(i < count);
+        return ptr[i];
+    }
+    T &front() { return ptr[0]; }
+    const T &front() const { return ptr[0]; }
+    T &back() { return ptr[count - 1]; }
+    const T &back() const { return ptr[count - 1]; }
+
+    iterator begin() { return ptr; }
+    iterator end() { return ptr + count; }
+    const_iterator begin() const { return ptr; }
+    const_iterator end() const { return ptr + count; }
+    const_iterator cbegin() const { return ptr; }
+    const_iterator cend() const { return ptr + count; }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    void reserve(size_t n) {
+        if (n > cap)
+            grow(n);
+    }
+    void clear() { count = 0; }
+    void resize(size_t n, const T &value = T()) {
+        reserve(n);
+        std::fill(ptr + std::min(count, n), ptr + n, value);
+        count = n;
+    }
+    void push_back(const T &value) {
+        if (count == cap)
+            grow(count + 1);
+        ptr[count++] = value;
+    }
+    template <typename... Args> T &emplace_back(Args &&...args) {
+        T value(std::forward<Args>(args)...);
+        push_back(value);
+        return back();
+    }
+    void pop_back() { --count; }
+
+    iterator insert(const_iterator pos, const T &value) {
+        return insert(pos, size_t(1), value);
+    }
+    iterator insert(const_iterator pos, size_t n, const T &value) {
+        size_t at = pos - ptr;
+        T copy = value;
+        reserve(count + n);
+        std::memmove(ptr + at + n, ptr + at, (count - at) * sizeof(T));
+        std::fill(ptr + at, ptr + at + n, copy);
+        count += n;
+        return ptr + at;
+    }
+    template <typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+    iterator insert(const_iterator pos, It first, It last) {
+        size_t at = pos - ptr, n = std::distance(first, last);
+        // copied first, the range may be inside the vector
+        SmallVector values(first, last);
+        reserve(count + n);
+        std::memmove(ptr + at + n, ptr + at, (count - at) * sizeof(T));
+        std::memcpy(ptr + at, values.ptr, n * sizeof(T));
+        count += n;
+        return ptr + at;
+    }
+    iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+    iterator erase(const_iterator first, const_iterator last) {
+        size_t at = first - ptr, n = last - first;
+        std::memmove(ptr + at, ptr + at + n, (count - at - n) * sizeof(T));
+        count -= n;
+        return ptr + at;
+    }
+
+    bool operator==(const SmallVector &rhs) const {
+        return std::equal(begin(), end(), rhs.begin(), rhs.end());
+    }
+    bool operator!=(const SmallVector &rhs) const { return !(*this == rhs); }
+    bool operator<(const SmallVector &rhs) const {
+        return std::lexicographical_compare(begin(), end(), rhs.begin(),
+                                            rhs.end());
+    }
+};
+
+template <typename T, size_t N>
+std::string vecToString(const SmallVector<T, N> &vec) {
+    return vecToString(vec.data(), vec.size());
+}
+
+} // namespace infini
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace infini {
+
+/**
+ * @brief Work-stealing thread pool shared by the intra-op parallelism of the
+ * kernels (parallel_for) and the inter-op parallelism of compiled plans.
+ * Every worker owns a deque: it pushes and pops its own tasks at the back,
+ * and idle workers steal from the front of the others. A thread waiting for
+ * a TaskGroup runs pending tasks instead of blocking, so nested parallel
+ * regions reuse the same threads instead of oversubscribing the cores.
+ */
+class ThreadPool {
+  public:
+    using Task = std::function<void()>;
+
+    static ThreadPool &getInstance();
+    ~ThreadPool();
+
+    // Starts workers until `nThreads` threads, the caller included, can run
+    // tasks. The pool only grows.
+    void reserve(int nThreads);
+    void submit(Task task);
+    // Runs one pending task, if any, on the calling thread
+    bool runPendingTask();
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    ThreadPool() = default;
+    bool pop(Queue &queue, bool back, Task &task);
+    bool take(int self, Task &task);
+    void work(int self);
+
+    static constexpr int maxWorkers = 256;
+    // queues[0] takes the tasks submitted from outside the pool
+    Queue queues[maxWorkers + 1];
+    std::vector<std::thread> workers;
+    std::atomic<int> nWorkers{0};
+    std::atomic<size_t> nPending{0};
+    std::mutex mutex; // guards workers and the sleeping
+    std::condition_variable wake;
+    bool stop = false;
+};
+
+/**
+ * @brief Tasks run on the ThreadPool that can be waited for together. The
+ * first exception thrown by a task is rethrown by wait().
+ */
+class TaskGroup {
+    std::atomic<size_t> nRunning{0};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    // Runs pending tasks until the ones of the group are done
+    void join();
+
+  public:
+    ~TaskGroup() { join(); }
+    void run(ThreadPool::Task task);
+    void wait();
+};
+
+} // namespace infini
+
+#endif
@@ -20,84 +20,78 @@ Allocator::~Allocator() {
 }
 
 size_t Allocator::alloc(size_t size) {
-	printf("function begin\r\n");
     IT_ASSERT(this->ptr == nullptr);
     // pad the size to the multiple of alignment
-	printf("pad begin\r\n");
     size = this->getAlignedSize(size);
+    used += size;
+
+    // best fit: the smallest free block that is large enough, lowest offset
+    // first among blocks of equal size
+    auto fit = free_block_by_size.lower_bound({size, 0});
+    if (fit != free_block_by_size.end()) {
+        auto [blockSize, addr] = *fit;
+        eraseFreeBlock(free_block.find(addr));
+        if (blockSize > size)
+            insertFreeBlock(addr + size, blockSize - size);
+        return addr;
+    }
 
-    // =================================== 作业 ===================================
-    // TODO: 设计一个算法来分配内存，返回起始地址偏移量
-    // =================================== 作业 ===================================
-	printf("loop begin\r\n");
-    for (auto it = free_block.begin(); it != free_block.end(); ++it) {
-        if (it->second >= size) {
-            size_t addr = it->first;
-
-            // 如果空闲块剩余空间大于所需大小，拆分空闲块
-            if (it->second > size) {
-                free_block[addr + size] = it->second - size;
-            }
-            // 移除已分配的内存块
-            free_block.erase(it);
-
-            used += size;
-            peak = std::max(peak, used);
+    // the last free block touches the end of the arena: grow it in place
+    if (!free_block.empty()) {
+        auto last = std::prev(free_block.end());
+        if (last->first + last->second == peak) {
+            size_t addr = last->first;
+            peak += size - last->second;
+            eraseFreeBlock(last);
             return addr;
         }
     }
-	printf("assign addr\r\n");
-    size_t addr = used;
-    used += size;
-    peak = std::max(peak, used);
-	printf("return addr %ld\r\n",addr);
+
+    size_t addr = peak;
+    peak += size;
     return addr;
-    // return 0;
 }
 
 void Allocator::free(size_t addr, size_t size) {
     IT_ASSERT(this->ptr == nullptr);
     size = getAlignedSize(size);
+    IT_ASSERT(addr + size <= peak);
+    used -= size;
 
-    // =================================== 作业 ===================================
-    // TODO: 设计一个算法来回收内存
-    // =================================== 作业 ===================================
-    auto it = free_block.lower_bound(addr);
+    auto next = free_block.lower_bound(addr);
+    IT_ASSERT(next == free_block.end() || addr + size <= next->first,
+              "Double free of offset " + std::to_string(addr));
 
-    // 合并前面的空闲块
-    if (it != free_block.begin()) {
-        auto prev = std::prev(it);
-        if (prev->first + prev->second >= addr) {
-            prev->second += (size - (prev->first + prev->second - addr));
+    // merge with the following free block
+    if (next != free_block.end() && addr + size == next->first) {
+        size += next->second;
+        auto it = next++;
+        eraseFreeBlock(it);
+    }
+
+    // merge with the preceding free block
+    if (next != free_block.begin()) {
+        auto prev = std::prev(next);
+        IT_ASSERT(prev->first + prev->second <= addr,
+                  "Double free of offset " + std::to_string(addr));
+        if (prev->first + prev->second == addr) {
             addr = prev->first;
-            // free_block.erase(it);
-			used -= (size - (prev->first + prev->second - addr));	//多了的这段内存
-            return;
+            size += prev->second;
+            eraseFreeBlock(prev);
         }
     }
 
-    // 合并后面的空闲块
-    // auto next = free_block.lower_bound(addr + size);
-    // if (next != free_block.end() && addr + size >= next->first) {
-    //     size += (next->second - (addr + size - next->first));
-	// 	used -= (size - next->second);
-	// 	free_block.erase(next);
-	// 	free_block[addr] = size;
-	// 	return;
-    // }
-
-    if (it != free_block.end() && addr + size >= it->first) {
-        size += (it->second - (addr + size - it->first));
-		used -= (size - it->second);
-		free_block.erase(it);
-		free_block[addr] = size;
-		return;
-    }
+    insertFreeBlock(addr, size);
+}
 
-    // 更新空闲块
-    free_block[addr] = size;
+void Allocator::insertFreeBlock(size_t addr, size_t size) {
+    free_block.emplace(addr, size);
+    free_block_by_size.emplace(size, addr);
+}
 
-    used -= size;
+void Allocator::eraseFreeBlock(std::map<size_t, size_t>::iterator it) {
+    free_block_by_size.erase({it->second, it->first});
+    free_block.erase(it);
 }
 
 void *Allocator::getPtr() {
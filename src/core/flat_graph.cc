@@ -0,0 +1,80 @@
+#include "core/flat_graph.h"
+#include <numeric>
+
+namespace infini {
+
+namespace {
+
+using Id = FlatGraph::Id;
+
+// Fills `ids` with the transpose of `rows`, e.g. the targets of the tensors
+// from the inputs of the ops: row i lists i for every column in the rows.
+void transpose(const vector<Id> &rowOffsets, const vector<Id> &rowIds,
+               size_t columns, vector<Id> &offsets, vector<Id> &ids) {
+    offsets.assign(columns + 1, 0);
+    for (auto id : rowIds)
+        ++offsets[id + 1];
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    ids.resize(rowIds.size());
+    vector<Id> next(offsets.begin(), offsets.end() - 1);
+    for (size_t row = 0; row + 1 < rowOffsets.size(); ++row)
+        for (auto i = rowOffsets[row]; i < rowOffsets[row + 1]; ++i)
+            ids[next[rowIds[i]]++] = row;
+}
+
+} // namespace
+
+FlatGraph::FlatGraph(const GraphObj &graph) {
+    const auto &opRefs = graph.getOperators();
+    const auto &tensorRefs = graph.getTensors();
+    IT_ASSERT(opRefs.size() < none && tensorRefs.size() < none);
+    const size_t n = opRefs.size(), m = tensorRefs.size();
+    ops.reserve(n);
+    for (auto &op : opRefs)
+        ops.emplace_back(op.get());
+    tensors.reserve(m);
+    for (auto &tensor : tensorRefs)
+        tensors.emplace_back(tensor.get());
+    auto tensorId = [&](const Tensor &tensor) {
+        Id id = tensor->graphIndex;
+        IT_ASSERT(id < m && tensors[id] == tensor.get(),
+                  "Tensor " + std::to_string(tensor->getGuid()) +
+                      " is not in the graph");
+        return id;
+    };
+
+    tensorSource.assign(m, none);
+    opInputs.offsets.assign(n + 1, 0);
+    opOutputs.offsets.assign(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        for (auto &input : ops[i]->getInputs())
+            opInputs.ids.emplace_back(tensorId(input));
+        for (auto &output : ops[i]->getOutputs()) {
+            Id id = tensorId(output);
+            opOutputs.ids.emplace_back(id);
+            tensorSource[id] = i;
+        }
+        opInputs.offsets[i + 1] = opInputs.ids.size();
+        opOutputs.offsets[i + 1] = opOutputs.ids.size();
+    }
+    transpose(opInputs.offsets, opInputs.ids, m, tensorTargets.offsets,
+              tensorTargets.ids);
+
+    // `seen` holds the last op that listed an op as its predecessor
+    vector<Id> seen(n, none);
+    opPredecessors.offsets.assign(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        for (auto input : getInputs(i)) {
+            Id source = tensorSource[input];
+            if (source != none && seen[source] != i) {
+                seen[source] = i;
+                opPredecessors.ids.emplace_back(source);
+            }
+        }
+        opPredecessors.offsets[i + 1] = opPredecessors.ids.size();
+    }
+    transpose(opPredecessors.offsets, opPredecessors.ids, n,
+              opSuccessors.offsets, opSuccessors.ids);
+}
+
+} // namespace infini
@@ -1,10 +1,10 @@
 #include "core/graph.h"
+#include "core/flat_graph.h"
+#include "core/graph_rewriter.h"
 #include "core/op_type.h"
-#include "operators/matmul.h"
-#include "operators/transpose.h"
+#include "core/tracer.h"
 #include <algorithm>
 #include <cstdio>
-#include <iostream>
 #include <numeric>
 #include <queue>
 
@@ -12,6 +12,8 @@ namespace infini {
 
 void GraphObj::addOperatorAndConnect(const Operator &op) {
     sorted = false;
+    plan = nullptr;
+    op->graphIndex = ops.size();
     ops.push_back(op);
     for (auto &input : op->getInputs()) {
         if (input) {
@@ -33,7 +35,47 @@ void GraphObj::addOperatorAndConnect(const Operator &op) {
     }
 }
 
+void GraphObj::removeOperator(const Operator &op) {
+    if (!hasOperator(op))
+        return;
+    // the order of the others, and so a topological sort, is kept
+    ops[op->graphIndex] = nullptr;
+    plan = nullptr;
+    ++removedOps;
+}
+
+void GraphObj::removeTensor(const Tensor &tensor) {
+    if (!hasTensor(tensor))
+        return;
+    if (fuidIndexed) {
+        auto it = fuidIndex.find(tensor->getFuid());
+        if (it != fuidIndex.end() && it->second == tensor.get())
+            fuidIndex.erase(it);
+    }
+    tensors[tensor->graphIndex] = nullptr;
+    ++removedTensors;
+    plan = nullptr;
+    weights.release(tensor);
+}
+
+void GraphObj::compact() const {
+    if (removedOps > 0) {
+        ops.erase(std::remove(ops.begin(), ops.end(), nullptr), ops.end());
+        for (size_t i = 0; i < ops.size(); ++i)
+            ops[i]->graphIndex = i;
+        removedOps = 0;
+    }
+    if (removedTensors > 0) {
+        tensors.erase(std::remove(tensors.begin(), tensors.end(), nullptr),
+                      tensors.end());
+        for (size_t i = 0; i < tensors.size(); ++i)
+            tensors[i]->graphIndex = i;
+        removedTensors = 0;
+    }
+}
+
 string GraphObj::toString() const {
+    compact();
     std::ostringstream oss;
     oss << "Graph Tensors:\n";
     for (const auto &tensor : tensors)
@@ -55,239 +97,84 @@ string GraphObj::toString() const {
 }
 
 bool GraphObj::topo_sort() {
+    compact();
     if (this->sorted) {
         return true;
     }
-    std::vector<Operator> sorted;
-    std::unordered_set<OperatorObj *> flags;
-    sorted.reserve(ops.size());
-    flags.reserve(ops.size());
-    while (sorted.size() < ops.size()) {
-        // Any node is move to sorted in this loop.
-        auto modified = false;
-        for (auto const &op : ops) {
-            if (auto const &inputs = op->getInputs();
-                flags.find(op.get()) == flags.end() && std::all_of(inputs.begin(), inputs.end(), [&flags](auto const &input) {
-                    auto ptr = input->getSource().get();
-                    return !ptr || flags.find(ptr) != flags.end();
-                })) {
-                modified = true;
-                sorted.emplace_back(op);
-                flags.insert(op.get());
-            }
-        }
-        if (!modified) {
-            return false;
-        }
+    // Kahn's algorithm: an op is ready once the ops writing its inputs are
+    // sorted
+    FlatGraph flat(*this);
+    using Id = FlatGraph::Id;
+    const size_t n = flat.numOps();
+    vector<Id> pending(n), order;
+    order.reserve(n);
+    for (Id i = 0; i < n; ++i)
+        if ((pending[i] = flat.getPredecessors(i).size()) == 0)
+            order.emplace_back(i);
+    for (size_t head = 0; head < order.size(); ++head)
+        for (auto succ : flat.getSuccessors(order[head]))
+            if (--pending[succ] == 0)
+                order.emplace_back(succ);
+    if (order.size() < n) {
+        return false;
     }
+    OpVec sorted;
+    sorted.reserve(n);
+    for (auto i : order)
+        sorted.emplace_back(std::move(ops[i]));
     this->ops = std::move(sorted);
+    for (size_t i = 0; i < n; ++i)
+        ops[i]->graphIndex = i;
+    plan = nullptr;
     return this->sorted = true;
 }
 
-void GraphObj::optimize() {
-    // =================================== 作业 ===================================
-    // TODO: 设计一个算法来实现指定的图优化规则
-    // 图优化规则如下：
-    // 1. 去除冗余的算子（例如，两个相邻的算子都是 transpose 算子，且做的是相反的操作，可以将其全部删除）
-    // 2.
-    // 合并算子（例如，矩阵乘算子中含有属性transA、transB，如果其输入存在transpose，且对最后两个维度做交换，就可以将transpose融入到矩阵乘算子的属性中去）
-    // =================================== 作业 ===================================
-    for (auto it = ops.begin(); it != ops.end();) {
-        auto currentOp = *it;
-        if (currentOp->getOpType() == OpType::Transpose) {
-            // 获取当前 Transpose 算子
-            auto currentTransposeOp = as<TransposeObj>(currentOp);
-
-            // 获取它的前一个算子（如果存在）并判断其类型
-            auto inputTensor = currentTransposeOp->getInputs()[0];
-            auto previousOp = inputTensor ? inputTensor->getSource() : nullptr;
-
-            if (previousOp && previousOp->getOpType() == OpType::Transpose) {
-                auto previousTransposeOp = as<TransposeObj>(previousOp);
-
-                // 判断两个 Transpose 是否是逆操作
-                auto prevPermute = previousTransposeOp->getPermute();
-                auto currPermute = currentTransposeOp->getPermute();
-
-                bool isInverse = true;
-                if (prevPermute.size() == currPermute.size()) {
-                    for (size_t i = 0; i < prevPermute.size(); ++i) {
-                        if (prevPermute[currPermute[i]] != static_cast<int>(i)) {
-                            isInverse = false;
-                            break;
-                        }
-                    }
-                } else {
-                    isInverse = false;
-                }
-
-                if (isInverse) {
-                    // 删除冗余的两个 Transpose 算子
-                    auto outputTensor = currentTransposeOp->getOutputs()[0];
-                    auto inputTensor = previousTransposeOp->getInputs()[0];
-
-                    // 更新连接关系
-                    if (outputTensor && inputTensor) {
-                        outputTensor->setSource(nullptr);               // 清除当前算子的来源
-                        inputTensor->removeTarget(previousTransposeOp); // 从源张量移除目标
-
-                        // 将原始输入的目标对接至当前的后继算子
-                        for (auto &targetOp : outputTensor->getTargets()) {
-                            targetOp->replaceInput(outputTensor, inputTensor);
-                            inputTensor->addTarget(targetOp);
-                        }
-                    }
-
-                    // 删除两个算子
-                    removeOperator(previousTransposeOp);
-                    removeOperator(currentTransposeOp);
-                    // it = ops.erase(std::find(ops.begin(), ops.end(), previousTransposeOp));
-                    // it = ops.erase(it);
-
-                    if (outputTensor) {
-                        removeTensor(outputTensor);
-                    }
-                    auto intermediateTensor = currentTransposeOp->getInputs()[0];
-                    if (intermediateTensor && intermediateTensor != inputTensor) {
-                        removeTensor(intermediateTensor);
-                    }
-
-                    continue; // 跳过递增，直接处理下一个算子
-                }
-            }
-        }
-
-        ++it; // 若无需删除，则处理下一个算子
+void GraphObj::reorder(const vector<size_t> &order) {
+    compact();
+    FlatGraph flat(*this);
+    IT_ASSERT(order.size() == ops.size());
+    constexpr size_t unscheduled = ~size_t(0);
+    vector<size_t> position(ops.size(), unscheduled);
+    for (size_t i = 0; i < order.size(); ++i) {
+        IT_ASSERT(order[i] < ops.size() && position[order[i]] == unscheduled);
+        position[order[i]] = i;
     }
+    for (size_t op = 0; op < ops.size(); ++op)
+        for (auto pred : flat.getPredecessors(op))
+            IT_ASSERT(position[pred] < position[op],
+                      "The order is not topological");
+    OpVec reordered;
+    reordered.reserve(ops.size());
+    for (auto i : order)
+        reordered.emplace_back(std::move(ops[i]));
+    ops = std::move(reordered);
+    for (size_t i = 0; i < ops.size(); ++i)
+        ops[i]->graphIndex = i;
+    plan = nullptr;
+    sorted = true;
+}
 
-    // ==========================
-    // 规则 2: 合并 Transpose 和 MatMul 算子
-    // ==========================
-    for (auto it = ops.begin(); it != ops.end();) {
-        auto currentOp = *it;
-
-        // 打印当前正在处理的操作符详细信息
-        std::cout << "Processing Operation: " << currentOp->toString() << std::endl;
-
-        if (currentOp->getOpType() == OpType::MatMul) {
-            auto matmulOp = as<MatmulObj>(currentOp);
-            std::cout << "MatMul Inputs: A=" << (matmulOp->getInputs()[0] ? matmulOp->getInputs()[0]->toString() : "nullptr")
-                      << ", B=" << (matmulOp->getInputs()[1] ? matmulOp->getInputs()[1]->toString() : "nullptr") << std::endl;
-
-            auto inputA = matmulOp->getInputs()[0];
-            auto inputB = matmulOp->getInputs()[1];
-            bool optimized = false; // 用于标记当前 MatMul 是否优化过
-
-            // 检查输入 A 是否为 Transpose
-            if (inputA) {
-                auto inputAOp = inputA->getSource();
-                if (inputAOp && inputAOp->getOpType() == OpType::Transpose) {
-                    auto transposeOp = as<TransposeObj>(inputAOp);
-                    auto permute = transposeOp->getPermute();
-                    std::cout << "Input A is a Transpose operation: " << transposeOp->toString() << std::endl;
-
-                    // 判断 Transpose 是否对最后两个维度的交换
-                    if (permute.size() >= 2 && permute[permute.size() - 2] == static_cast<int>(permute.size() - 1) &&
-                        permute[permute.size() - 1] == static_cast<int>(permute.size() - 2)) {
-                        std::cout << "Found Transpose on Input A that swaps the last two dimensions." << std::endl;
-
-                        // 更新 MatMul 的 transA 属性
-                        matmulOp->setTransA(!matmulOp->getTransA());
-
-                        // 更新连接
-                        if (!transposeOp->getOutputs().empty()) {
-                            auto transOutput = transposeOp->getOutputs()[0]; // 获取 Transpose 的输出张量
-                            std::cout << "Changing MatMul Input A from Transpose->Input to Transpose's Source." << std::endl;
-
-                            // 将 MatMul 的输入从 Transpose 的输出张量替换为 Transpose 的输入张量
-                            auto transposeInput = transposeOp->getInputs()[0]; // 获取 Transpose 的输入张量
-                            matmulOp->replaceInput(inputA, transposeInput);
-
-                            // 删除 Transpose 输出张量的来源连接
-                            transOutput->setSource(nullptr);
-
-                            // 将 Transpose 从其输入张量的 targets 列表中移除
-                            inputA->removeTarget(transposeOp);
-                        }
-
-                        // 删除 Transpose 算子和输入张量
-                        std::cout << "Removing Transpose for Input A: " << transposeOp->toString() << std::endl;
-
-                        // 确保在删除张量之前已经正确更新图结构
-                        removeTensor(inputA);
-                        removeOperator(transposeOp);
-
-
-                        optimized = true;
-                    }
-                }
-            }
-
-            // 检查输入 B 是否为 Transpose
-            if (inputB) {
-                auto inputBOp = inputB->getSource();
-                if (inputBOp && inputBOp->getOpType() == OpType::Transpose) {
-                    auto transposeOp = as<TransposeObj>(inputBOp);
-                    auto permute = transposeOp->getPermute();
-                    std::cout << "Input B is a Transpose operation: " << transposeOp->toString() << std::endl;
-
-                    // 判断 Transpose 是否对最后两个维度的交换
-                    if (permute.size() >= 2 && permute[permute.size() - 2] == static_cast<int>(permute.size() - 1) &&
-                        permute[permute.size() - 1] == static_cast<int>(permute.size() - 2)) {
-                        std::cout << "Found Transpose on Input B that swaps the last two dimensions." << std::endl;
-
-                        // 更新 MatMul 的 transB 属性
-                        matmulOp->setTransB(!matmulOp->getTransB());
-
-                        // 更新连接
-                        if (!transposeOp->getOutputs().empty()) {
-                            auto transOutput = transposeOp->getOutputs()[0]; // 获取 Transpose 的输出张量
-                            std::cout << "Changing MatMul Input B from Transpose->Input to Transpose's Source." << std::endl;
-
-                            // 将 MatMul 的输入从 Transpose 的输出张量替换为 Transpose 的输入张量
-                            auto transposeInput = transposeOp->getInputs()[0]; // 获取 Transpose 的输入张量
-                            matmulOp->replaceInput(inputB, transposeInput);
-
-                            // 删除 Transpose 输出张量的来源连接
-                            transOutput->setSource(nullptr);
-
-                            // 将 Transpose 从其输入张量的 targets 列表中移除
-                            inputA->removeTarget(transposeOp);
-                        }
-
-                        // 删除 Transpose 算子和输入张量
-                        std::cout << "Removing Transpose for Input B: " << transposeOp->toString() << std::endl;
-
-                        // 确保在删除张量之前已经正确更新图结构
-                        removeTensor(inputB);
-                        removeOperator(transposeOp);
-
-
-                        optimized = true;
-                    }
-                }
-            }
-
-            // // 如果当前 MatMul 优化了，重新开始迭代，避免操作失效的迭代器
-            if (optimized) {
-                continue; // 跳过递增，直接处理下一个算子
-            }
-        }
-
-        ++it; // 移动到下一个操作符
-    }
+vector<PassStatistics> GraphObj::optimize() {
+    PassManager pm;
+    add_default_passes(pm);
+    return pm.run(*this);
 }
 
 Tensor GraphObj::getTensor(int fuid) const {
-    for (auto tensor : tensors) {
-        if (tensor->getFuid() == fuid) {
-            return tensor;
-        }
+    compact();
+    if (!fuidIndexed) {
+        fuidIndex.reserve(tensors.size());
+        for (auto &tensor : tensors)
+            fuidIndex[tensor->getFuid()] = tensor.get();
+        fuidIndexed = true;
     }
-    return nullptr;
+    auto it = fuidIndex.find(fuid);
+    return it == fuidIndex.end() ? nullptr : tensors[it->second->graphIndex];
 }
 
 void GraphObj::shape_infer() {
+    compact();
+    plan = nullptr;
     for (auto &op : ops) {
         auto ans = op->inferShape();
         IT_ASSERT(ans.has_value());
@@ -309,67 +196,127 @@ void GraphObj::shape_infer() {
 void GraphObj::dataMalloc() {
     // topological sorting first
     IT_ASSERT(topo_sort() == true);
+    FlatGraph flat(*this);
+    using Id = FlatGraph::Id;
+    plan = nullptr;
+
+    // Plan the activation memory by liveness: a tensor occupies its block
+    // from the op producing it until its last consumer has run. Graph inputs
+    // and outputs are accessed outside of run(), so they stay alive.
+    vector<size_t> lastUse(flat.numTensors(), 0);
+    for (Id i = 0; i < flat.numOps(); ++i)
+        for (auto input : flat.getInputs(i))
+            lastUse[input] = i;
+    // A view has no block of its own: its uses keep the block of its base
+    // alive instead
+    vector<Id> storage(flat.numTensors());
+    for (Id t = 0; t < flat.numTensors(); ++t) {
+        auto tensor = flat.getTensor(t);
+        storage[t] = tensor->isView() ? flat.getId(tensor->viewBase.get()) : t;
+        lastUse[storage[t]] = std::max(lastUse[storage[t]], lastUse[t]);
+    }
 
-    // =================================== 作业 ===================================
-    // TODO：利用 allocator 给计算图分配内存
-    // HINT: 获取分配好的内存指针后，可以调用 tensor 的 setDataBlob 函数给 tensor 绑定内存
-    // =================================== 作业 ===================================
-    // 为每个张量分配内存
-
-    std::vector<size_t> offsets;
-    void *basePtr = nullptr;
-
-    // 第一个循环：记录每个 tensor 的 offset
-    for (size_t i = 0; i < tensors.size(); i++) {
-        auto &tensor = tensors[i];
-        printf("Processing tensor %zu...\n", i);
-
-        // 分配内存
-        size_t sizeInBytes = tensor->getBytes();
-        printf("getBytes done ...\n");
-        size_t offset = allocator.alloc(sizeInBytes * 8);
-        printf("alloc done ...\n");
-
-        if (offset == std::numeric_limits<size_t>::max()) {
-            throw std::runtime_error("Allocator failed to allocate memory");
+    auto &tracer = Tracer::getInstance();
+    const bool tracing = tracer.isEnabled();
+    constexpr size_t unallocated = ~size_t(0);
+    vector<size_t> offsets(flat.numTensors(), unallocated);
+    auto allocTensor = [&](Id tensor) {
+        if (offsets[tensor] == unallocated) {
+            offsets[tensor] =
+                allocator.alloc(flat.getTensor(tensor)->getBytes());
+            if (tracing)
+                tracer.recordAllocator(allocator.getUsed(),
+                                       allocator.getPeak());
+        }
+    };
+    auto isPersistent = [&](Id tensor) {
+        return flat.getSource(tensor) == FlatGraph::none ||
+               flat.getTargets(tensor).empty();
+    };
+
+    // the constants are in the weight arena instead
+    for (Id t = 0; t < flat.numTensors(); ++t)
+        if (flat.getSource(t) == FlatGraph::none &&
+            !flat.getTensor(t)->isConstant())
+            allocTensor(t);
+    for (Id i = 0; i < flat.numOps(); ++i) {
+        // outputs are allocated before the inputs are released, so that no
+        // kernel has to support an output aliasing one of its inputs
+        for (auto output : flat.getOutputs(i))
+            if (storage[output] == output)
+                allocTensor(output);
+        for (auto input : flat.getInputs(i)) {
+            input = storage[input];
+            if (lastUse[input] == i && !isPersistent(input) &&
+                offsets[input] != unallocated) {
+                allocator.free(offsets[input],
+                               flat.getTensor(input)->getBytes());
+                if (tracing)
+                    tracer.recordAllocator(allocator.getUsed(),
+                                           allocator.getPeak());
+                // an op may read the same tensor twice, only free it once
+                lastUse[input] = flat.numOps();
+            }
         }
-
-        printf("Offset allocated: %zu\n", offset);
-        offsets.push_back(offset); // 记录 offset
     }
-    // 获取一次 basePtr（假设所有分配都从同一 basePtr 开始）
-    basePtr = allocator.getPtr();
-    if (!basePtr) {
-        throw std::runtime_error("Allocator returned null base pointer");
+    auto basePtr = reinterpret_cast<char *>(allocator.getPtr());
+    for (Id t = 0; t < flat.numTensors(); ++t) {
+        if (tensors[t]->isConstant() || storage[t] != t)
+            continue;
+        IT_ASSERT(offsets[t] != unallocated);
+        tensors[t]->setDataBlob(
+            make_ref<BlobObj>(runtime, basePtr + offsets[t]));
     }
-    printf("BasePtr acquired: %p\n", basePtr);
+    weights.seal(tensors);
+    // after the constants moved, as views may alias them too
+    for (Id t = 0; t < flat.numTensors(); ++t)
+        if (storage[t] != t)
+            tensors[t]->setDataBlob(make_ref<BlobObj>(
+                runtime, tensors[storage[t]]->getRawDataPtr<char *>() +
+                             tensors[t]->getOffset()));
+    if (tracing)
+        tracer.flush();
 
-    // 检查是否成功获取 basePtr
-    if (!basePtr) {
-        throw std::runtime_error("Base pointer is null after allocation loop");
-    }
+    allocator.info();
+}
 
-    // 第二个循环：绑定 Blob
-    for (size_t i = 0; i < tensors.size(); i++) {
-        auto &tensor = tensors[i];
-        size_t offset = offsets[i];
-        void *dataPtr = reinterpret_cast<char *>(basePtr) + offset; // 基于 offset 计算 dataPtr
-        printf("Tensor %zu: BasePtr: %p, DataPtr: %p\n", i, basePtr, dataPtr);
+Tensor GraphObj::addTensor(Shape dim, DataType dtype) { return addTensor(make_ref<TensorObj>(dim, dtype, runtime)); }
 
-        // 创建 Blob
-        Blob blob = make_ref<BlobObj>(tensor->getRuntime(), dataPtr);
-        tensor->setDataBlob(blob); // 绑定 Blob
-        printf("Blob set successfully for tensor %zu\n", i);
-    }
+Tensor GraphObj::addConstant(Shape dim, DataType dtype) {
+    auto tensor = addTensor(std::move(dim), dtype);
+    makeConstant(tensor);
+    return tensor;
+}
 
-    allocator.info();
+void GraphObj::makeConstant(const Tensor &tensor) {
+    IT_ASSERT(!tensor->getSource() && !tensor->isConstant());
+    plan = nullptr;
+    tensor->constant = true;
+    weights.stage(tensor);
 }
 
-Tensor GraphObj::addTensor(Shape dim, DataType dtype) { return tensors.emplace_back(make_ref<TensorObj>(dim, dtype, runtime)); }
+void GraphObj::makeView(const Tensor &tensor, const Tensor &base,
+                        vector<size_t> strides, size_t offset) {
+    IT_ASSERT(!tensor->isView() && !tensor->isConstant() && tensor != base);
+    IT_ASSERT(strides.size() == tensor->getRank());
+    IT_ASSERT(tensor->getDType() == base->getDType());
+    plan = nullptr;
+    if (base->isView()) {
+        tensor->viewBase = base->viewBase;
+        tensor->offset = base->offset + offset;
+    } else {
+        tensor->viewBase = base;
+        tensor->offset = offset;
+    }
+    tensor->strides = std::move(strides);
+}
 
 Tensor GraphObj::addTensor(const Tensor &tensor) {
     IT_ASSERT(tensor->getRuntime() == runtime,
               std::string("Tensor runtime mismatch: cannot add a tenosr in ") + tensor->getRuntime()->toString() + " to " + runtime->toString());
+    tensor->graphIndex = tensors.size();
+    if (fuidIndexed)
+        fuidIndex[tensor->getFuid()] = tensor.get();
     tensors.emplace_back(tensor);
     return tensor;
 }
@@ -385,36 +332,38 @@ TensorVec GraphObj::addTensor(const TensorVec &tensors) {
 // "inputs" or "outputs" of operators must be in "tensors"
 // "predecessors" and "successors" of an operator of "ops" must be in "ops".
 bool GraphObj::checkValid() const {
+    compact();
     for (auto tensor : tensors) {
         IT_ASSERT(!(tensor->getTargets().size() == 0 && nullptr == tensor->getSource()));
         for (auto op : tensor->getTargets()) {
-            IT_ASSERT(std::find(ops.begin(), ops.end(), op) != ops.end());
+            IT_ASSERT(hasOperator(op));
         }
         auto op = tensor->getSource();
-        IT_ASSERT(!(op && std::find(ops.begin(), ops.end(), op) == ops.end()));
+        IT_ASSERT(!(op && !hasOperator(op)));
+        if (tensor->isView())
+            IT_ASSERT(hasTensor(tensor->getViewBase()));
     }
     for (auto op : ops) {
         for (auto tensor : op->getInputs()) {
-            IT_ASSERT(std::find(tensors.begin(), tensors.end(), tensor) != tensors.end());
+            IT_ASSERT(hasTensor(tensor));
         }
         for (auto tensor : op->getOutputs()) {
-            IT_ASSERT(std::find(tensors.begin(), tensors.end(), tensor) != tensors.end());
+            IT_ASSERT(hasTensor(tensor));
         }
         for (auto pre : op->getPredecessors()) {
-            IT_ASSERT(std::find(ops.begin(), ops.end(), pre) != ops.end());
+            IT_ASSERT(hasOperator(pre));
         }
         for (auto suc : op->getSuccessors()) {
-            IT_ASSERT(std::find(ops.begin(), ops.end(), suc) != ops.end());
+            IT_ASSERT(hasOperator(suc));
         }
     }
-    std::set<UidBaseType> s;
     // check whether two tensors with the same FUID exist
+    std::unordered_set<UidBaseType> s;
+    s.reserve(tensors.size());
     for (auto tensor : tensors) {
-        int cnt = s.count(tensor->getFuid());
-        IT_ASSERT(cnt == 0, std::to_string(tensor->getFuid()));
-        s.insert(tensor->getFuid());
+        IT_ASSERT(s.insert(tensor->getFuid()).second, std::to_string(tensor->getFuid()));
     }
     return true;
 }
 
-} // namespace infini
\ No newline at end of file
+} // namespace infini
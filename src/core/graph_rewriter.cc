@@ -0,0 +1,180 @@
+#include "core/graph_rewriter.h"
+#include <chrono>
+
+namespace infini {
+
+void GraphRewriter::reconnect(const Operator &op) {
+    for (auto &pred : op->getPredecessors())
+        pred->removeSuccessors(op);
+    op->predecessors.clear();
+    for (auto &input : op->getInputs())
+        if (auto pred = input->getSource()) {
+            pred->addSuccessors(op);
+            op->addPredecessors(pred);
+        }
+}
+
+void GraphRewriter::touchReaders(const Tensor &tensor) {
+    auto targets = tensor->getTargets();
+    touched.insert(touched.end(), targets.begin(), targets.end());
+}
+
+Operator GraphRewriter::addClone(const Operator &op, const TensorVec &inputs,
+                                 const TensorVec &outputs) {
+    auto clone = op->clone(inputs, outputs);
+    graph.addOperatorAndConnect(clone);
+    auto succs = clone->getSuccessors();
+    touched.emplace_back(clone);
+    touched.insert(touched.end(), succs.begin(), succs.end());
+    return clone;
+}
+
+void GraphRewriter::eraseOp(const Operator &op) {
+    if (!graph.hasOperator(op))
+        return;
+    // removing an op keeps the others sorted
+    graph.removeOperator(op);
+    for (auto &input : op->getInputs()) {
+        input->removeTarget(op);
+        // the producer may now be dead
+        if (auto source = input->getSource())
+            touched.emplace_back(source);
+    }
+    for (auto &output : op->getOutputs())
+        if (output->getSource() == op) {
+            output->setSource(nullptr);
+            touchReaders(output);
+        }
+    for (auto &pred : op->getPredecessors())
+        pred->removeSuccessors(op);
+    for (auto &succ : op->getSuccessors())
+        succ->removePredecessors(op);
+}
+
+void GraphRewriter::eraseTensor(const Tensor &tensor) {
+    IT_ASSERT(!tensor->getSource() && tensor->getTargets().empty());
+    graph.removeTensor(tensor);
+}
+
+void GraphRewriter::replaceInput(const Operator &op, const Tensor &from,
+                                 const Tensor &to) {
+    if (from == to)
+        return;
+    graph.sorted = false;
+    graph.plan = nullptr;
+    from->removeTarget(op);
+    for (auto &input : op->getInputs())
+        if (input == from)
+            to->addTarget(op);
+    op->replaceInput(from, to);
+    reconnect(op);
+    touched.emplace_back(op);
+    if (auto source = from->getSource())
+        touched.emplace_back(source);
+}
+
+void GraphRewriter::replaceAllUsesWith(const Tensor &from, const Tensor &to) {
+    for (auto &target : from->getTargets())
+        replaceInput(target, from, to);
+}
+
+OpPattern &
+OpPattern::where(std::function<bool(const Operator &)> predicate) {
+    predicates.emplace_back(std::move(predicate));
+    return *this;
+}
+
+OpPattern &OpPattern::input(int index, OpPattern producer) {
+    inputIndices.emplace_back(index);
+    inputPatterns.emplace_back(std::move(producer));
+    return *this;
+}
+
+OpPattern &OpPattern::oneUse() {
+    singleUse = true;
+    return *this;
+}
+
+bool OpPattern::match(const Operator &op) const {
+    if (op->getOpType() != type)
+        return false;
+    if (singleUse && (op->getOutputs().size() != 1 ||
+                      op->getOutput()->getTargets().size() != 1))
+        return false;
+    for (auto &predicate : predicates)
+        if (!predicate(op))
+            return false;
+    for (size_t i = 0; i < inputIndices.size(); ++i) {
+        if (inputIndices[i] >= int(op->getInputs().size()))
+            return false;
+        auto source = op->getInputs(inputIndices[i])->getSource();
+        if (!source || !inputPatterns[i].match(source))
+            return false;
+    }
+    return true;
+}
+
+vector<PassStatistics> PassManager::run(GraphObj &graph) const {
+    using Clock = std::chrono::steady_clock;
+    auto elapsed = [](Clock::time_point begin) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - begin)
+            .count();
+    };
+
+    vector<PassStatistics> stats;
+    std::unordered_map<OpType::underlying_t, vector<size_t>> rulesOfType;
+    for (size_t i = 0; i < rules.size(); ++i) {
+        stats.push_back({rules[i].name});
+        rulesOfType[rules[i].pattern.getType().underlying()].emplace_back(i);
+    }
+
+    IT_ASSERT(graph.topo_sort() == true);
+    GraphRewriter rewriter(graph);
+    std::deque<Operator> worklist(graph.getOperators().begin(),
+                                  graph.getOperators().end());
+    // indexed by GraphRewriter::getId, which also covers the ops added by
+    // the rules
+    vector<bool> queued(worklist.size(), true);
+    while (!worklist.empty()) {
+        auto op = std::move(worklist.front());
+        worklist.pop_front();
+        if (rewriter.isErased(op))
+            continue;
+        queued[rewriter.getId(op)] = false;
+        auto it = rulesOfType.find(op->getOpType().underlying());
+        if (it == rulesOfType.end())
+            continue;
+        for (auto r : it->second) {
+            auto begin = Clock::now();
+            bool matched = rules[r].pattern.match(op);
+            bool changed = matched && rules[r].rewrite(rewriter, op);
+            stats[r].milliseconds += elapsed(begin);
+            stats[r].matches += matched;
+            stats[r].rewrites += changed;
+            if (changed)
+                break;
+        }
+        for (auto &t : rewriter.takeTouched()) {
+            if (rewriter.isErased(t))
+                continue;
+            size_t id = rewriter.getId(t);
+            if (id >= queued.size())
+                queued.resize(id + 1, false);
+            if (!queued[id]) {
+                queued[id] = true;
+                worklist.emplace_back(t);
+            }
+        }
+    }
+
+    for (auto &[name, pass] : passes) {
+        auto begin = Clock::now();
+        PassStatistics s{name};
+        pass(rewriter, s);
+        s.milliseconds = elapsed(begin);
+        stats.emplace_back(s);
+    }
+    return stats;
+}
+
+} // namespace infini
@@ -0,0 +1,484 @@
+#include "core/graph_rewriter.h"
+#include "core/kernel.h"
+#include "core/memory_schedule.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/fused_element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include <algorithm>
+
+namespace infini {
+
+namespace {
+
+// Drops `op` and its outputs once nothing reads them
+void eraseIfDead(GraphRewriter &rw, const Operator &op) {
+    for (auto &output : op->getOutputs())
+        if (!output->getTargets().empty())
+            return;
+    rw.eraseOp(op);
+    for (auto &output : op->getOutputs())
+        rw.eraseTensor(output);
+}
+
+vector<int> permuteOf(const Operator &transpose) {
+    return as<TransposeObj>(transpose)->getPermute();
+}
+
+bool isIdentity(const vector<int> &permute) {
+    for (size_t i = 0; i < permute.size(); ++i)
+        if (permute[i] != int(i))
+            return false;
+    return true;
+}
+
+bool swapsLastTwoDims(const Operator &op) {
+    auto permute = permuteOf(op);
+    int rank = permute.size();
+    if (rank < 2 || permute[rank - 2] != rank - 1 ||
+        permute[rank - 1] != rank - 2)
+        return false;
+    for (int i = 0; i < rank - 2; ++i)
+        if (permute[i] != i)
+            return false;
+    return true;
+}
+
+// Transpose(Transpose(x, p), q) is Transpose(x, p∘q)
+RewriteRule composeTransposes() {
+    return {"ComposeTransposes",
+            OpPattern(OpType::Transpose).input(0, OpPattern(OpType::Transpose)),
+            [](GraphRewriter &rw, const Operator &op) {
+                auto first = op->getInputs(0)->getSource();
+                auto p = permuteOf(first), q = permuteOf(op);
+                vector<int> composed(q.size());
+                for (size_t i = 0; i < q.size(); ++i)
+                    composed[i] = p[q[i]];
+                auto output = op->getOutput();
+                rw.eraseOp(op);
+                rw.addOp<TransposeObj>(first->getInputs(0), output, composed);
+                eraseIfDead(rw, first);
+                return true;
+            }};
+}
+
+RewriteRule eraseIdentityTranspose() {
+    return {"EraseIdentityTranspose",
+            OpPattern(OpType::Transpose).where([](const Operator &op) {
+                // a graph output keeps its tensor, and so the copy
+                return isIdentity(permuteOf(op)) &&
+                       !op->getOutput()->getTargets().empty();
+            }),
+            [](GraphRewriter &rw, const Operator &op) {
+                rw.replaceAllUsesWith(op->getOutput(), op->getInputs(0));
+                eraseIfDead(rw, op);
+                return true;
+            }};
+}
+
+// The permutation of the Transposes writing the inputs of `op`, if they all
+// have the same one and `op` is their only reader. With `allowInvariant`, an
+// input with every dimension 1 needs no Transpose, as it broadcasts the same
+// way either side of one.
+optional<vector<int>> sinkablePermute(const Operator &op,
+                                      bool allowInvariant) {
+    optional<vector<int>> permute;
+    for (auto &input : op->getInputs()) {
+        auto source = input->getSource();
+        if (!source || source->getOpType() != OpType::Transpose) {
+            const auto &dims = input->getDims();
+            if (allowInvariant && std::all_of(dims.begin(), dims.end(),
+                                              [](int d) { return d == 1; }))
+                continue;
+            return std::nullopt;
+        }
+        auto targets = input->getTargets();
+        if (!std::all_of(targets.begin(), targets.end(),
+                         [&](const Operator &t) { return t == op; }))
+            return std::nullopt;
+        auto p = permuteOf(source);
+        if (permute && *permute != p)
+            return std::nullopt;
+        permute = p;
+    }
+    if (permute && permute->size() != op->getOutput()->getRank())
+        return std::nullopt;
+    return permute;
+}
+
+// Replaces `op`, reading Transposes by `permute`, with the op `make` creates
+// on their inputs, followed by one Transpose of its output
+void sinkTranspose(
+    GraphRewriter &rw, const Operator &op, const vector<int> &permute,
+    const std::function<void(const TensorVec &, const Tensor &)> &make) {
+    auto output = op->getOutput();
+    Shape dims(permute.size());
+    for (size_t i = 0; i < permute.size(); ++i)
+        dims[permute[i]] = output->getDims()[i];
+    TensorVec inputs;
+    OpVec transposes;
+    for (auto &input : op->getInputs()) {
+        auto source = input->getSource();
+        if (source && source->getOpType() == OpType::Transpose) {
+            inputs.emplace_back(source->getInputs(0));
+            transposes.emplace_back(source);
+        } else {
+            inputs.emplace_back(input);
+        }
+    }
+    rw.eraseOp(op);
+    for (auto &t : transposes)
+        eraseIfDead(rw, t);
+    auto result = rw.addTensor(dims, output->getDType());
+    make(inputs, result);
+    rw.addOp<TransposeObj>(result, output, permute);
+}
+
+// Op(Transpose(a, p), Transpose(b, p)) is Transpose(Op(a, b), p) for an
+// element-wise op, so the Transposes move down towards another Transpose or
+// a MatMul that absorbs them
+RewriteRule sinkTransposeThroughElementwise(OpType type) {
+    return {string("SinkTransposeThrough") + type.toString(),
+            OpPattern(type).where([](const Operator &op) {
+                return sinkablePermute(op, true).has_value();
+            }),
+            [](GraphRewriter &rw, const Operator &op) {
+                sinkTranspose(rw, op, *sinkablePermute(op, true),
+                              [&](const TensorVec &inputs, const Tensor &out) {
+                                  rw.addClone(op, inputs, {out});
+                              });
+                return true;
+            }};
+}
+
+// Concat(Transpose(a, p), Transpose(b, p), axis) is
+// Transpose(Concat(a, b, p[axis]), p)
+RewriteRule sinkTransposeThroughConcat() {
+    return {"SinkTransposeThroughConcat",
+            OpPattern(OpType::Concat).where([](const Operator &op) {
+                return sinkablePermute(op, false).has_value();
+            }),
+            [](GraphRewriter &rw, const Operator &op) {
+                auto permute = *sinkablePermute(op, false);
+                int axis = permute[as<ConcatObj>(op)->getDim()];
+                sinkTranspose(rw, op, permute,
+                              [&](const TensorVec &inputs, const Tensor &out) {
+                                  rw.addOp<ConcatObj>(inputs, out, axis);
+                              });
+                return true;
+            }};
+}
+
+// MatMul(Transpose(A), B) swapping the last two dims of A is
+// MatMul(A, B, transA = true), and likewise for B
+RewriteRule foldTransposeIntoMatmul() {
+    return {"FoldTransposeIntoMatmul", OpPattern(OpType::MatMul),
+            [](GraphRewriter &rw, const Operator &op) {
+                auto mm = as<MatmulObj>(op);
+                bool changed = false;
+                for (int i = 0; i < 2; ++i) {
+                    auto input = mm->getInputs(i);
+                    auto source = input->getSource();
+                    if (!source || source->getOpType() != OpType::Transpose ||
+                        !swapsLastTwoDims(source))
+                        continue;
+                    // the bias has no transpose flag to absorb it
+                    if (mm->getBias() == input)
+                        continue;
+                    // replaceInput rewires every operand reading `input`
+                    if (i == 0 || mm->getInputs(0) == input)
+                        mm->setTransA(!mm->getTransA());
+                    if (i == 1 || mm->getInputs(1) == input)
+                        mm->setTransB(!mm->getTransB());
+                    rw.replaceInput(mm, input, source->getInputs(0));
+                    eraseIfDead(rw, source);
+                    changed = true;
+                }
+                return changed;
+            }};
+}
+
+// The op reading `t`, if it is the only one
+Operator soleConsumer(const Tensor &t) {
+    auto targets = t->getTargets();
+    return targets.size() == 1 ? targets[0] : nullptr;
+}
+
+// MatMul -> Add(bias) -> Relu/Clip, or a part of it, is one MatMul applying the
+// bias and the activation as it stores its output. The intermediate tensors
+// are dropped, and with them their memory.
+RewriteRule fuseMatmulEpilogue() {
+    return {
+        "FuseMatmulEpilogue",
+        OpPattern(OpType::MatMul).oneUse().where([](const Operator &op) {
+            return as<MatmulObj>(op)->getAct() == ActType::None;
+        }),
+        [](GraphRewriter &rw, const Operator &op) {
+            auto mm = as<MatmulObj>(op);
+            Tensor output = mm->getOutput(), bias = mm->getBias();
+            auto act = mm->getAct();
+            auto actMin = mm->getActMin(), actMax = mm->getActMax();
+            OpVec fused{mm};
+            TensorVec intermediates;
+
+            // Add(C, bias) or Add(bias, C), where bias is a row of C
+            auto next = soleConsumer(output);
+            if (!bias && next && next->getOpType() == OpType::Add) {
+                auto other = next->getInputs(0) == output ? next->getInputs(1)
+                                                          : next->getInputs(0);
+                const auto &dims = other->getDims();
+                bool isRow = other != output &&
+                             other->getDType() == output->getDType() &&
+                             next->getOutput()->getDims() == output->getDims() &&
+                             !dims.empty() && dims.back() == mm->getN() &&
+                             std::all_of(dims.begin(), dims.end() - 1,
+                                         [](int d) { return d == 1; });
+                if (isRow) {
+                    bias = other;
+                    fused.emplace_back(next);
+                    intermediates.emplace_back(output);
+                    output = next->getOutput();
+                    next = soleConsumer(output);
+                }
+            }
+            if (next && (next->getOpType() == OpType::Relu ||
+                         next->getOpType() == OpType::Clip)) {
+                if (next->getOpType() == OpType::Relu) {
+                    act = ActType::Relu;
+                } else {
+                    act = ActType::Clip;
+                    actMin = as<ClipObj>(next)->getMin();
+                    actMax = as<ClipObj>(next)->getMax();
+                }
+                fused.emplace_back(next);
+                intermediates.emplace_back(output);
+                output = next->getOutput();
+            }
+            if (fused.size() == 1)
+                return false;
+
+            for (auto &f : fused)
+                rw.eraseOp(f);
+            for (auto &t : intermediates)
+                rw.eraseTensor(t);
+            rw.addOp<MatmulObj>(mm->getInputs(0), mm->getInputs(1), output,
+                                mm->getTransA(), mm->getTransB(), bias, act,
+                                actMin, actMax);
+            return true;
+        }};
+}
+
+// Evaluates every op reading only constants once, with the CPU kernels. Its
+// outputs become constants and the constants nothing reads any more are
+// dropped.
+size_t foldConstants(GraphRewriter &rw) {
+    auto &graph = rw.getGraph();
+    auto runtime = graph.getRuntime();
+    if (!runtime->isCpu())
+        return 0;
+    IT_ASSERT(graph.topo_sort() == true);
+    auto &registry = KernelRegistry::getInstance();
+    size_t folded = 0;
+    for (auto &op : OpVec(graph.getOperators())) {
+        const auto &inputs = op->getInputs();
+        if (inputs.empty() ||
+            !std::all_of(inputs.begin(), inputs.end(),
+                         [](const Tensor &t) { return t->isConstant(); }))
+            continue;
+        rw.eraseOp(op);
+        for (auto &output : op->getOutputs())
+            rw.makeConstant(output);
+        std::get<0>(registry.selectKernel(op, runtime.get()))
+            ->compute(op, runtime.get());
+        for (auto &input : inputs)
+            if (input->getTargets().empty())
+                rw.eraseTensor(input);
+        ++folded;
+    }
+    return folded;
+}
+
+// Replaces every maximal connected group of element-wise ops with a single
+// FusedElementwise op. A group has one output, and all its intermediate
+// tensors have the shape of the output and are only read inside the group.
+size_t fuseElementwise(GraphRewriter &rw) {
+    auto &graph = rw.getGraph();
+    IT_ASSERT(graph.topo_sort() == true);
+    const OpVec topo = graph.getOperators();
+    std::unordered_map<OperatorObj *, size_t> order;
+    for (size_t i = 0; i < topo.size(); ++i)
+        order[topo[i].get()] = i;
+
+    size_t groups = 0;
+    std::unordered_set<OperatorObj *> done;
+    // from the last op backwards, so that each group grows from its output
+    for (size_t i = topo.size(); i-- > 0;) {
+        auto sink = topo[i];
+        if (done.count(sink.get()) || !FusedElementwiseObj::canFuse(sink))
+            continue;
+        const auto &shape = sink->getOutput()->getDims();
+        std::unordered_set<OperatorObj *> members{sink.get()};
+        OpVec group{sink};
+        // add the producers of the inputs whose readers are all in the group,
+        // until none is left
+        for (bool grown = true; grown;) {
+            grown = false;
+            for (size_t g = 0; g < group.size(); ++g)
+                for (auto &input : group[g]->getInputs()) {
+                    auto source = input->getSource();
+                    if (!source || members.count(source.get()) ||
+                        done.count(source.get()) ||
+                        !FusedElementwiseObj::canFuse(source) ||
+                        input->getDims() != shape)
+                        continue;
+                    auto targets = input->getTargets();
+                    if (!std::all_of(targets.begin(), targets.end(),
+                                     [&](const Operator &t) {
+                                         return members.count(t.get()) > 0;
+                                     }))
+                        continue;
+                    members.insert(source.get());
+                    group.emplace_back(source);
+                    grown = true;
+                }
+        }
+        for (auto &op : group)
+            done.insert(op.get());
+        if (group.size() < 2)
+            continue;
+
+        // the program evaluates the group in topological order
+        std::sort(group.begin(), group.end(),
+                  [&](const Operator &a, const Operator &b) {
+                      return order[a.get()] < order[b.get()];
+                  });
+        TensorVec inputs, intermediates;
+        vector<ElementwiseStep> program;
+        std::unordered_map<TensorObj *, int> regs;
+        auto reg = [&](const Tensor &t) {
+            auto it = regs.find(t.get());
+            if (it != regs.end())
+                return it->second;
+            inputs.emplace_back(t);
+            return regs[t.get()] = inputs.size() - 1;
+        };
+        for (auto &op : group)
+            for (auto &input : op->getInputs())
+                if (!members.count(input->getSource().get()))
+                    reg(input);
+        for (auto &op : group) {
+            ElementwiseStep step{op->getOpType(), reg(op->getInputs(0)), -1,
+                                 std::nullopt, std::nullopt,
+                                 op->getOutput()->getDType()};
+            if (op->numInputs() == 2)
+                step.b = reg(op->getInputs(1));
+            if (op->getOpType() == OpType::Clip) {
+                step.min = as<ClipObj>(op)->getMin();
+                step.max = as<ClipObj>(op)->getMax();
+            }
+            program.emplace_back(step);
+            regs[op->getOutput().get()] = inputs.size() + program.size() - 1;
+            if (op != sink)
+                intermediates.emplace_back(op->getOutput());
+        }
+
+        for (auto &op : group)
+            rw.eraseOp(op);
+        for (auto &t : intermediates)
+            rw.eraseTensor(t);
+        rw.addOp<FusedElementwiseObj>(inputs, sink->getOutput(), program);
+        ++groups;
+    }
+    return groups;
+}
+
+// Turns Transposes into views of their inputs, so that the ops reading them
+// walk the input with permuted strides instead of a copy. Only the readers
+// whose kernels all accept strided inputs read the view: the Transpose stays a
+// copy for the others, which materializes the layout where a kernel needs it.
+size_t makeViews(GraphRewriter &rw) {
+    auto &graph = rw.getGraph();
+    auto runtime = graph.getRuntime();
+    if (!runtime->isCpu())
+        return 0;
+    IT_ASSERT(graph.topo_sort() == true);
+    auto &registry = KernelRegistry::getInstance();
+    auto acceptsViews = [&](const Operator &op) {
+        auto candidates = registry.getKernelCandidates(KernelAttrs{
+            runtime->getDevice(), op->getOpType().underlying(),
+            op->getDType()});
+        return !candidates.empty() &&
+               std::all_of(candidates.begin(), candidates.end(),
+                           [](const KernelRegistry::KernelRecord *record) {
+                               return std::get<0>(*record)
+                                   ->acceptsStridedInputs();
+                           });
+    };
+
+    size_t views = 0;
+    for (auto &op : OpVec(graph.getOperators())) {
+        if (op->getOpType() != OpType::Transpose)
+            continue;
+        auto input = op->getInputs(0), output = op->getOutput();
+        if (output->isView() || output->isConstant())
+            continue;
+        OpVec readers, others;
+        for (auto &target : output->getTargets()) {
+            if (std::find(readers.begin(), readers.end(), target) !=
+                    readers.end() ||
+                std::find(others.begin(), others.end(), target) !=
+                    others.end())
+                continue;
+            (acceptsViews(target) ? readers : others).emplace_back(target);
+        }
+        // a graph output is read outside of the graph, densely
+        if (readers.empty())
+            continue;
+
+        // the strides of the output dims are those of the input dims they
+        // come from
+        auto inStrides = input->getStrides();
+        vector<size_t> strides;
+        for (int d : permuteOf(op))
+            strides.emplace_back(inStrides[d]);
+        if (others.empty()) {
+            rw.makeView(output, input, strides);
+        } else {
+            auto view = rw.addTensor(output->getDims(), output->getDType());
+            rw.addClone(op, {input}, {view});
+            rw.makeView(view, input, strides);
+            for (auto &reader : readers)
+                rw.replaceInput(reader, output, view);
+        }
+        ++views;
+    }
+    return views;
+}
+
+} // namespace
+
+void add_default_passes(PassManager &pm) {
+    pm.addRule(composeTransposes());
+    pm.addRule(eraseIdentityTranspose());
+    for (auto type : {OpType::Add, OpType::Sub, OpType::Mul, OpType::Div,
+                      OpType::Relu, OpType::Clip, OpType::Cast})
+        pm.addRule(sinkTransposeThroughElementwise(type));
+    pm.addRule(sinkTransposeThroughConcat());
+    pm.addRule(foldTransposeIntoMatmul());
+    pm.addRule(fuseMatmulEpilogue());
+    pm.addPass("FoldConstants", foldConstants);
+    pm.addPass("FuseElementwise", fuseElementwise);
+    pm.addPass("MakeViews", makeViews);
+    pm.addPass("ScheduleForMemory",
+               [](GraphRewriter &rw, PassStatistics &stats) {
+                   auto schedule = schedule_for_memory(rw.getGraph());
+                   stats.matches = stats.rewrites =
+                       schedule.peakAfter < schedule.peakBefore;
+                   stats.peakBefore = schedule.peakBefore;
+                   stats.peakAfter = schedule.peakAfter;
+               });
+}
+
+} // namespace infini
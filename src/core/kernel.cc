@@ -0,0 +1,117 @@
+#include "core/kernel.h"
+#include "core/runtime.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+
+namespace infini
+{
+    // timed runs of every candidate, after a warm-up one
+    constexpr int tuningRuns = 3;
+
+    KernelRegistry::KernelRegistry()
+    {
+        if (auto path = std::getenv("INFINI_TUNING_CACHE"))
+            setTuningCache(path);
+    }
+
+    string KernelRegistry::workloadKey(Device device, const Operator &op)
+    {
+        return device_to_str(device) + ":" +
+               vecToString(op->getWorkloadVector());
+    }
+
+    void KernelRegistry::setTuningCache(const string &path)
+    {
+        std::lock_guard<std::mutex> lock(tuningMutex);
+        tuning = true;
+        tuningCache = path;
+        ++version;
+        // one "<workload key> <kernel name>" line per tuned workload, the
+        // last line of a key wins
+        std::ifstream file(path);
+        string key, name;
+        while (file >> key >> name)
+            tunedKernels[key] = name;
+    }
+
+    void KernelRegistry::clearTuning()
+    {
+        std::lock_guard<std::mutex> lock(tuningMutex);
+        tunedKernels.clear();
+        ++version;
+    }
+
+    const KernelRegistry::KernelRecord &
+    KernelRegistry::selectKernel(const Operator &op, const RuntimeObj *context)
+    {
+        auto kernelAttrs = KernelAttrs{context->getDevice(),
+                                       op->getOpType().underlying(),
+                                       op->getDType()};
+        if (!tuning)
+            return getKernelItem(kernelAttrs);
+        auto candidates = getKernelCandidates(kernelAttrs);
+        IT_ASSERT(!candidates.empty(), "Kernel not found for key {" +
+                                           get_kernel_attrs_str(kernelAttrs) +
+                                           "}");
+        if (candidates.size() == 1)
+            return *candidates[0];
+
+        std::lock_guard<std::mutex> lock(tuningMutex);
+        auto key = workloadKey(context->getDevice(), op);
+        auto it = tunedKernels.find(key);
+        if (it != tunedKernels.end())
+            for (auto candidate : candidates)
+                if (std::get<1>(*candidate) == it->second)
+                    return *candidate;
+        // new workload, or its kernel is gone
+        auto &best = tune(op, context, candidates);
+        tunedKernels[key] = std::get<1>(best);
+        if (!tuningCache.empty())
+        {
+            std::ofstream file(tuningCache, std::ios::app);
+            file << key << " " << std::get<1>(best) << "\n";
+        }
+        return best;
+    }
+
+    const KernelRegistry::KernelRecord &
+    KernelRegistry::tune(const Operator &op, const RuntimeObj *context,
+                         const vector<const KernelRecord *> &candidates)
+    {
+        const KernelRecord *best = candidates[0];
+        double bestTime = std::numeric_limits<double>::infinity();
+        for (auto candidate : candidates)
+        {
+            double time = std::numeric_limits<double>::infinity();
+            try
+            {
+                // the compiled step leaves out the per-call preparation
+                auto step = std::get<0>(*candidate)->compile(op, context);
+                step();
+                for (int i = 0; i < tuningRuns; ++i)
+                {
+                    auto begin = std::chrono::steady_clock::now();
+                    step();
+                    std::chrono::duration<double> d =
+                        std::chrono::steady_clock::now() - begin;
+                    time = std::min(time, d.count());
+                }
+            }
+            catch (const Exception &)
+            {
+                // the candidate does not support the op
+                continue;
+            }
+            // ties keep the preferred kernel
+            if (time < bestTime)
+            {
+                bestTime = time;
+                best = candidate;
+            }
+        }
+        return *best;
+    }
+
+} // namespace infini
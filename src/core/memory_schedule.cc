@@ -0,0 +1,238 @@
+#include "core/memory_schedule.h"
+#include "core/flat_graph.h"
+#include <queue>
+
+namespace infini {
+
+namespace {
+
+using Id = FlatGraph::Id;
+
+// The activation memory of a graph as dataMalloc() plans it. A storage is
+// the tensor owning a block, i.e. a tensor or the base of a view.
+struct MemoryModel {
+    size_t nOps;
+    // the graph inputs, live from the start
+    size_t baseline = 0;
+    // the bytes the outputs of every op allocate
+    vector<size_t> allocs;
+    // the bytes of every storage, by tensor id
+    vector<size_t> bytes;
+    // the storages every op reads that are released after their last reader
+    vector<vector<Id>> reads;
+    // the distinct ops reading every storage
+    vector<vector<Id>> readers;
+    vector<vector<Id>> preds, succs;
+
+    explicit MemoryModel(const FlatGraph &flat)
+        : nOps(flat.numOps()), allocs(nOps, 0), bytes(flat.numTensors(), 0),
+          reads(nOps), readers(flat.numTensors()), preds(nOps), succs(nOps) {
+        const size_t m = flat.numTensors();
+        vector<Id> storage(m);
+        vector<bool> released(m);
+        for (Id t = 0; t < m; ++t) {
+            auto tensor = flat.getTensor(t);
+            storage[t] =
+                tensor->isView() ? flat.getId(tensor->getViewBase().get()) : t;
+            if (tensor->isConstant() || storage[t] != t)
+                continue;
+            bytes[t] = tensor->getBytes();
+            if (flat.getSource(t) == FlatGraph::none)
+                baseline += bytes[t];
+            // the graph outputs stay, and so do the inputs
+            released[t] = flat.getSource(t) != FlatGraph::none &&
+                          !flat.getTargets(t).empty();
+        }
+        // `seen` holds the last op that read a storage
+        vector<Id> seen(m, FlatGraph::none);
+        for (Id v = 0; v < nOps; ++v) {
+            for (auto t : flat.getOutputs(v))
+                if (storage[t] == t)
+                    allocs[v] += bytes[t];
+            for (auto t : flat.getInputs(v)) {
+                Id s = storage[t];
+                if (seen[s] == v)
+                    continue;
+                seen[s] = v;
+                readers[s].emplace_back(v);
+                if (released[s] && bytes[s] > 0)
+                    reads[v].emplace_back(s);
+            }
+            auto p = flat.getPredecessors(v), q = flat.getSuccessors(v);
+            preds[v].assign(p.begin(), p.end());
+            succs[v].assign(q.begin(), q.end());
+        }
+    }
+
+    size_t peakOf(const vector<size_t> &order) const {
+        vector<size_t> remaining(bytes.size());
+        for (size_t s = 0; s < bytes.size(); ++s)
+            remaining[s] = readers[s].size();
+        size_t live = baseline, peak = baseline;
+        for (auto v : order) {
+            live += allocs[v];
+            peak = std::max(peak, live);
+            for (auto s : reads[v])
+                if (--remaining[s] == 0)
+                    live -= bytes[s];
+        }
+        return peak;
+    }
+};
+
+// The order with the lowest peak, by a dynamic program over the sets of
+// scheduled ops: the live memory after a set does not depend on the order it
+// was scheduled in, so only the lowest peak reaching every set is kept
+vector<size_t> scheduleExactly(const MemoryModel &model) {
+    const size_t n = model.nOps, states = size_t(1) << n;
+    using Mask = uint32_t;
+    vector<Mask> predMask(n, 0), readerMask(model.bytes.size(), 0);
+    for (size_t v = 0; v < n; ++v) {
+        for (auto p : model.preds[v])
+            predMask[v] |= Mask(1) << p;
+        for (auto s : model.reads[v])
+            readerMask[s] |= Mask(1) << v;
+    }
+
+    constexpr size_t unreached = ~size_t(0);
+    vector<size_t> peak(states, unreached), live(states, 0);
+    vector<uint8_t> last(states, 0);
+    peak[0] = live[0] = model.baseline;
+    for (Mask mask = 0; mask + 1 < states; ++mask) {
+        if (peak[mask] == unreached)
+            continue;
+        for (size_t v = 0; v < n; ++v) {
+            Mask bit = Mask(1) << v;
+            if ((mask & bit) || (predMask[v] & ~mask))
+                continue;
+            Mask next = mask | bit;
+            size_t during = live[mask] + model.allocs[v];
+            if (peak[next] == unreached) {
+                live[next] = during;
+                for (auto s : model.reads[v])
+                    if (!(readerMask[s] & ~next))
+                        live[next] -= model.bytes[s];
+            }
+            size_t p = std::max(peak[mask], during);
+            if (p < peak[next]) {
+                peak[next] = p;
+                last[next] = v;
+            }
+        }
+    }
+
+    vector<size_t> order(n);
+    Mask mask = states - 1;
+    for (size_t i = n; i-- > 0;) {
+        order[i] = last[mask];
+        mask &= ~(Mask(1) << order[i]);
+    }
+    return order;
+}
+
+// List scheduling: the ready op with the lowest score runs first, the most
+// recently readied one on ties so that a branch is finished before the next
+// is started. The score of an op is the memory it allocates minus the memory
+// it releases, plus the lowest such score, if negative, of the successors it
+// makes ready.
+vector<size_t> scheduleGreedily(const MemoryModel &model) {
+    const size_t n = model.nOps;
+    vector<size_t> pending(n), remaining(model.bytes.size());
+    for (size_t v = 0; v < n; ++v)
+        pending[v] = model.preds[v].size();
+    for (size_t s = 0; s < remaining.size(); ++s)
+        remaining[s] = model.readers[s].size();
+
+    // `readBy` marks the storages of the op being scored. The net memory of
+    // an op is computed as if `after` ran first, if it is not none.
+    vector<Id> readBy(model.bytes.size(), FlatGraph::none);
+    auto delta = [&](size_t v, Id after) {
+        long long d = model.allocs[v];
+        for (auto s : model.reads[v]) {
+            bool readFirst = after != FlatGraph::none && readBy[s] == after;
+            if (remaining[s] - readFirst == 1)
+                d -= model.bytes[s];
+        }
+        return d;
+    };
+    auto score = [&](size_t v) {
+        long long own = delta(v, FlatGraph::none), ahead = 0;
+        for (auto s : model.reads[v])
+            readBy[s] = v;
+        for (auto u : model.succs[v])
+            if (pending[u] == 1)
+                ahead = std::min(ahead, delta(u, v));
+        for (auto s : model.reads[v])
+            readBy[s] = FlatGraph::none;
+        return own + ahead;
+    };
+
+    struct Entry {
+        long long score;
+        size_t stamp;
+        size_t op;
+        bool operator<(const Entry &rhs) const {
+            return score != rhs.score ? score > rhs.score : stamp < rhs.stamp;
+        }
+    };
+    std::priority_queue<Entry> ready;
+    // the stamp of the entry of every op in the queue that is up to date
+    vector<size_t> latest(n, 0);
+    size_t stamps = 0;
+    vector<bool> scheduled(n, false);
+    auto push = [&](size_t v) {
+        latest[v] = ++stamps;
+        ready.push({score(v), stamps, v});
+    };
+    for (size_t v = 0; v < n; ++v)
+        if (pending[v] == 0)
+            push(v);
+
+    vector<size_t> order;
+    order.reserve(n);
+    while (!ready.empty()) {
+        auto [_, stamp, v] = ready.top();
+        ready.pop();
+        if (scheduled[v] || stamp != latest[v])
+            continue;
+        scheduled[v] = true;
+        order.emplace_back(v);
+        for (auto s : model.reads[v])
+            if (--remaining[s] == 1)
+                // the last reader now releases it, rescore it if it is ready
+                for (auto r : model.readers[s])
+                    if (!scheduled[r] && pending[r] == 0)
+                        push(r);
+        for (auto u : model.succs[v])
+            if (--pending[u] == 0)
+                push(u);
+    }
+    IT_ASSERT(order.size() == n, "Cannot schedule a graph with cycles");
+    return order;
+}
+
+} // namespace
+
+MemorySchedule schedule_for_memory(GraphObj &graph, size_t exactLimit) {
+    IT_ASSERT(exactLimit <= 24, "The exact schedule takes 2^n states");
+    IT_ASSERT(graph.topo_sort() == true);
+    FlatGraph flat(graph);
+    MemoryModel model(flat);
+    MemorySchedule ret;
+
+    vector<size_t> current(model.nOps);
+    for (size_t v = 0; v < model.nOps; ++v)
+        current[v] = v;
+    ret.peakBefore = model.peakOf(current);
+    ret.exact = model.nOps <= exactLimit;
+    auto order =
+        ret.exact ? scheduleExactly(model) : scheduleGreedily(model);
+    ret.peakAfter = model.peakOf(order);
+    if (ret.peakAfter < ret.peakBefore)
+        graph.reorder(order);
+    else
+        ret.peakAfter = ret.peakBefore;
+    return ret;
+}
+
+} // namespace infini
@@ -7,6 +7,22 @@ namespace infini
     OperatorObj::OperatorObj(OpType opType, TensorVec inputs, TensorVec outputs)
         : type(opType), inputs(inputs), outputs(outputs) {}
 
+    vector<int64_t> OperatorObj::getWorkloadVector() const
+    {
+        vector<int64_t> ret{int64_t(type.underlying())};
+        auto attrs = getOpAttrVector();
+        ret.emplace_back(attrs.size());
+        ret.insert(ret.end(), attrs.begin(), attrs.end());
+        for (auto &input : inputs)
+        {
+            ret.emplace_back(input->getDType().getIndex());
+            ret.emplace_back(input->getRank());
+            for (auto d : input->getDims())
+                ret.emplace_back(d);
+        }
+        return ret;
+    }
+
     void OperatorObj::removePredecessors(const Operator &op)
     {
         for (auto it = predecessors.begin(); it != predecessors.end();)
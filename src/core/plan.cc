@@ -0,0 +1,190 @@
+#include "core/plan.h"
+#include "core/tracer.h"
+#include "utils/parallel.h"
+#include <chrono>
+
+namespace infini
+{
+    PlanObj::PlanObj(const RuntimeObj *runtime, OpVec ops,
+                     const vector<KernelStep> &kernelSteps,
+                     vector<string> kernelNames)
+        : runtime(runtime), ops(std::move(ops)),
+          kernelNames(std::move(kernelNames)), isa(get_cpu_isa()),
+          registryVersion(KernelRegistry::getInstance().getVersion())
+    {
+        IT_ASSERT(this->ops.size() == kernelSteps.size());
+        IT_ASSERT(this->kernelNames.size() == kernelSteps.size());
+        steps.reserve(kernelSteps.size());
+        params.reserve(kernelSteps.size());
+        for (const auto &step : kernelSteps)
+        {
+            steps.push_back({step.fn, step.params.get()});
+            params.emplace_back(step.params);
+        }
+        buildDependencies();
+    }
+
+    void PlanObj::buildDependencies()
+    {
+        const size_t n = ops.size();
+        std::unordered_map<OperatorObj *, size_t> position;
+        for (size_t i = 0; i < n; ++i)
+            position[ops[i].get()] = i;
+        vector<std::set<size_t>> dependencies(n);
+        for (size_t i = 0; i < n; ++i)
+            for (auto &input : ops[i]->getInputs())
+                if (auto source = input->getSource())
+                    if (position.count(source.get()))
+                        dependencies[i].insert(position[source.get()]);
+
+        // The memory accesses since the last write of each range, by first
+        // byte: [begin, end) and the step. A step writing a range waits for
+        // all the accesses overlapping it, then replaces the ones it covers.
+        std::multimap<uintptr_t, pair<uintptr_t, size_t>> accesses;
+        auto range = [](const Tensor &t)
+        {
+            auto begin = reinterpret_cast<uintptr_t>(t->getRawDataPtr<char *>());
+            return std::make_pair(begin, begin + t->getBytes());
+        };
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (auto &output : ops[i]->getOutputs())
+            {
+                auto [begin, end] = range(output);
+                for (auto it = accesses.begin();
+                     it != accesses.end() && it->first < end;)
+                {
+                    auto [accessEnd, step] = it->second;
+                    if (accessEnd <= begin)
+                    {
+                        ++it;
+                        continue;
+                    }
+                    dependencies[i].insert(step);
+                    if (it->first >= begin && accessEnd <= end)
+                        it = accesses.erase(it);
+                    else
+                        ++it;
+                }
+                accesses.emplace(begin, std::make_pair(end, i));
+            }
+            for (auto &input : ops[i]->getInputs())
+            {
+                auto [begin, end] = range(input);
+                accesses.emplace(begin, std::make_pair(end, i));
+            }
+        }
+
+        nDependencies.assign(n, 0);
+        dependents.assign(n, {});
+        for (size_t i = 0; i < n; ++i)
+        {
+            dependencies[i].erase(i);
+            nDependencies[i] = dependencies[i].size();
+            for (auto d : dependencies[i])
+                dependents[d].emplace_back(i);
+            if (i > 0 && !dependencies[i].count(i - 1))
+                hasConcurrency = true;
+        }
+    }
+
+    template <bool Timed>
+    inline void PlanObj::runStep(size_t i, double *times) const
+    {
+        if constexpr (Timed)
+        {
+            auto begin = Tracer::Clock::now();
+            steps[i].fn(steps[i].params);
+            auto end = Tracer::Clock::now();
+            if (times)
+                times[i] = std::chrono::duration<double>(end - begin).count();
+            auto &tracer = Tracer::getInstance();
+            if (tracer.isEnabled())
+                tracer.recordOp(ops[i].get(), &kernelNames[i], begin, end);
+        }
+        else
+            steps[i].fn(steps[i].params);
+    }
+
+    void PlanObj::run(bool profiling) const
+    {
+        const bool concurrent = hasConcurrency && get_num_threads() > 1;
+        const bool tracing = Tracer::getInstance().isEnabled();
+        if (!profiling && !tracing)
+        {
+            if (concurrent)
+                runConcurrent<false>(nullptr);
+            else
+                runSequential<false>(nullptr);
+            return;
+        }
+
+        vector<double> times(profiling ? steps.size() : 0);
+        double *timesPtr = profiling ? times.data() : nullptr;
+        if (concurrent)
+            runConcurrent<true>(timesPtr);
+        else
+            runSequential<true>(timesPtr);
+        if (tracing)
+            Tracer::getInstance().flush();
+        if (profiling)
+        {
+            auto &profiler = runtime->getProfiler();
+            for (size_t i = 0; i < steps.size(); ++i)
+                profiler.add(ops[i], kernelNames[i], times[i]);
+        }
+    }
+
+    template <bool Timed>
+    void PlanObj::runSequential(double *times) const
+    {
+        for (size_t i = 0; i < steps.size(); ++i)
+            runStep<Timed>(i, times);
+    }
+
+    template <bool Timed>
+    void PlanObj::runConcurrent(double *times) const
+    {
+        const size_t n = steps.size();
+        auto remaining = std::make_unique<std::atomic<int>[]>(n);
+        for (size_t i = 0; i < n; ++i)
+            remaining[i].store(nDependencies[i], std::memory_order_relaxed);
+
+        ThreadPool::getInstance().reserve(get_num_threads());
+        TaskGroup group;
+        // Runs a step, then one of the steps it made ready on the same
+        // thread and the others on the pool
+        std::function<void(size_t)> execute = [&](size_t i)
+        {
+            while (i < n)
+            {
+                runStep<Timed>(i, times);
+                size_t next = n;
+                for (auto d : dependents[i])
+                    if (remaining[d].fetch_sub(1, std::memory_order_acq_rel) ==
+                        1)
+                    {
+                        if (next == n)
+                            next = d;
+                        else
+                            group.run([&execute, d]
+                                      { execute(d); });
+                    }
+                i = next;
+            }
+        };
+        size_t first = n;
+        for (size_t i = 0; i < n; ++i)
+            if (nDependencies[i] == 0)
+            {
+                if (first == n)
+                    first = i;
+                else
+                    group.run([&execute, i]
+                              { execute(i); });
+            }
+        execute(first);
+        group.wait();
+    }
+
+} // namespace infini
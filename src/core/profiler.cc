@@ -0,0 +1,181 @@
+#include "core/profiler.h"
+#include "core/operator.h"
+#include "kernels/cpu/gemm.h"
+#include "operators/fused_element_wise.h"
+#include "operators/matmul.h"
+#include "utils/parallel.h"
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+
+namespace infini
+{
+    OpCost get_op_cost(const Operator &op)
+    {
+        OpCost cost;
+        for (auto &tensor : op->getInputs())
+            cost.bytes += tensor->getBytes();
+        for (auto &tensor : op->getOutputs())
+            cost.bytes += tensor->getBytes();
+        double outSize = op->getOutput()->size();
+        switch (op->getOpType().underlying())
+        {
+        case OpType::MatMul:
+        {
+            auto mm = as<MatmulObj>(op);
+            cost.flops = 2.0 * outSize * mm->getK();
+            // one more for each stage of the epilogue
+            if (mm->getBias())
+                cost.flops += outSize;
+            if (mm->getAct() != ActType::None)
+                cost.flops += outSize;
+            break;
+        }
+        case OpType::FusedElementwise:
+            // one per step of the program
+            cost.flops =
+                outSize * as<FusedElementwiseObj>(op)->getProgram().size();
+            break;
+        case OpType::Add:
+        case OpType::Sub:
+        case OpType::Mul:
+        case OpType::Div:
+        case OpType::Relu:
+        case OpType::Clip:
+            cost.flops = outSize;
+            break;
+        default: // data movement only
+            break;
+        }
+        return cost;
+    }
+
+    void Profiler::add(const Operator &op, const string &kernel,
+                       double seconds)
+    {
+        Record record{op->getOpType(), kernel, seconds, get_op_cost(op)};
+        std::lock_guard<std::mutex> lock(mutex);
+        records.emplace_back(std::move(record));
+    }
+
+    void Profiler::clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        records.clear();
+    }
+
+    vector<Profiler::Record> Profiler::getRecords() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return records;
+    }
+
+    void Profiler::setRoofline(Roofline peak)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        roofline = peak;
+    }
+
+    // Best of a few runs of `f`, in seconds
+    template <typename F>
+    static double bestTime(F &&f)
+    {
+        double best = INFINITY;
+        for (int i = 0; i < 3; ++i)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            f();
+            std::chrono::duration<double> d =
+                std::chrono::steady_clock::now() - begin;
+            best = std::min(best, d.count());
+        }
+        return best;
+    }
+
+    Profiler::Roofline Profiler::getRoofline()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (roofline)
+                return *roofline;
+        }
+        const size_t n = 512;
+        vector<float> a(n * n, 1.0f), b(n * n, 1.0f), c(n * n);
+        size_t offset = 0;
+        double gemmTime = bestTime([&]
+                                   { batchedGemm<float>(
+                                         1, n, n, n, {a.data(), ptrdiff_t(n), 1},
+                                         &offset, {b.data(), ptrdiff_t(n), 1},
+                                         &offset, c.data()); });
+
+        const size_t bytes = 64 << 20;
+        vector<char> src(bytes, 1), dst(bytes);
+        double copyTime = bestTime([&]
+                                   { parallel_for(bytes, 1 << 20,
+                                                  [&](size_t begin, size_t end)
+                                                  { std::memcpy(dst.data() + begin,
+                                                                src.data() + begin,
+                                                                end - begin); }); });
+
+        Roofline peak{2.0 * n * n * n / gemmTime * 1e-9,
+                      2.0 * bytes / copyTime * 1e-9};
+        setRoofline(peak);
+        return peak;
+    }
+
+    string Profiler::report()
+    {
+        auto peak = getRoofline();
+        struct Row
+        {
+            size_t count = 0;
+            double seconds = 0, flops = 0, bytes = 0, boundSeconds = 0;
+        };
+        map<pair<string, string>, Row> rows;
+        Row total;
+        for (auto &record : getRecords())
+        {
+            // the time at the roofline: compute or bandwidth bound
+            double bound =
+                std::max(record.cost.flops / (peak.gflops * 1e9),
+                         record.cost.bytes / (peak.gbps * 1e9));
+            for (Row *row :
+                 {&rows[{record.opType.toString(), record.kernel}], &total})
+            {
+                row->count += 1;
+                row->seconds += record.seconds;
+                row->flops += record.cost.flops;
+                row->bytes += record.cost.bytes;
+                row->boundSeconds += bound;
+            }
+        }
+
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2);
+        os << "Roofline: " << peak.gflops << " GFLOP/s, " << peak.gbps
+           << " GB/s\n";
+        os << std::left << std::setw(12) << "Op" << std::setw(22) << "Kernel"
+           << std::right << std::setw(8) << "Count" << std::setw(12)
+           << "Time(ms)" << std::setw(9) << "Time%" << std::setw(11)
+           << "GFLOP/s" << std::setw(10) << "GB/s" << std::setw(11)
+           << "Roofline%"
+           << "\n";
+        auto print = [&](const string &op, const string &kernel,
+                         const Row &row)
+        {
+            double seconds = std::max(row.seconds, 1e-12);
+            os << std::left << std::setw(12) << op << std::setw(22) << kernel
+               << std::right << std::setw(8) << row.count << std::setw(12)
+               << row.seconds * 1e3 << std::setw(9)
+               << 100 * row.seconds / std::max(total.seconds, 1e-12)
+               << std::setw(11) << row.flops / seconds * 1e-9
+               << std::setw(10) << row.bytes / seconds * 1e-9
+               << std::setw(11) << 100 * row.boundSeconds / seconds << "\n";
+        };
+        for (auto &[key, row] : rows)
+            print(key.first, key.second, row);
+        print("Total", "", total);
+        return os.str();
+    }
+
+} // namespace infini
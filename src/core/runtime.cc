@@ -2,22 +2,36 @@
 #include "core/blob.h"
 #include "core/kernel.h"
 #include "core/graph.h"
-#include "core/kernel.h"
-#include <chrono>
+#include "core/plan.h"
 #include <cstring>
 #include <memory>
 namespace infini
 {
-    void NativeCpuRuntimeObj::run(const Graph &graph) const
+    void NativeCpuRuntimeObj::run(const Graph &graph, bool profiling) const
+    {
+        // compiled again only after the graph, its memory or the kernels to
+        // pick changed
+        if (!graph->plan || graph->plan->isStale())
+            graph->plan = compile(graph);
+        graph->plan->run(profiling);
+    }
+
+    Plan NativeCpuRuntimeObj::compile(const Graph &graph) const
     {
-        const auto &kernelRegistry = KernelRegistry::getInstance();
+        IT_ASSERT(graph->topo_sort(), "Cannot compile a graph with cycles");
+        auto &kernelRegistry = KernelRegistry::getInstance();
 
-        for (auto &op : graph->getOperators())
+        const auto &ops = graph->getOperators();
+        vector<KernelStep> steps;
+        vector<string> kernelNames;
+        steps.reserve(ops.size());
+        for (auto &op : ops)
         {
-            auto kernelAttrs = KernelAttrs{device, op->getOpType().underlying()};
-            Kernel *kernel = kernelRegistry.getKernel(kernelAttrs);
-            kernel->compute(op, this);
+            const auto &record = kernelRegistry.selectKernel(op, this);
+            steps.emplace_back(std::get<0>(record)->compile(op, this));
+            kernelNames.emplace_back(std::get<1>(record));
         }
+        return make_ref<PlanObj>(this, ops, steps, kernelNames);
     }
 
     string NativeCpuRuntimeObj::toString() const { return "CPU Runtime"; }
@@ -9,7 +9,8 @@ namespace infini {
 
     TensorObj::TensorObj(Shape shape_, DataType dtype, Runtime runtime)
         : dim(shape_.size()), dtype(dtype), runtime(runtime), shape(std::move(shape_)),
-          _size(std::accumulate(shape.begin(), shape.end(), 1, std::multiplies{})) {}
+          _size(std::accumulate(shape.begin(), shape.end(), size_t(1),
+                                std::multiplies<size_t>{})) {}
 
     string TensorObj::toString() const
     {
@@ -22,7 +23,12 @@ namespace infini {
         string ret = "Tensor " + std::to_string(guid) + ", Fuid " +
                      std::to_string(fuid) + ", shape " + vecToString(shape) +
                      ", dtype " + dtype.toString() + ", " + runtime->toString() +
-                     ", " + ss.str() + "\n";
+                     ", " + ss.str() + (constant ? ", constant" : "");
+        if (viewBase)
+            ret += ", view of " + std::to_string(viewBase->getGuid()) +
+                   " with strides " + vecToString(strides) + ", offset " +
+                   std::to_string(offset);
+        ret += "\n";
         vector<UidBaseType> targetGuids;
         for (const auto &op : targets)
             targetGuids.emplace_back(op.lock()->getGuid());
@@ -36,11 +42,30 @@ namespace infini {
 
 void TensorObj::setShape(Shape shape_) {
     shape = shape_;
-    size_t size = std::accumulate(shape.begin(), shape.end(), 1,
-                                  [](auto acc, auto x) { return acc * x; });
+    size_t size = std::accumulate(shape.begin(), shape.end(), size_t(1),
+                                  std::multiplies<size_t>{});
     _size = size;
 }
 
+vector<size_t> TensorObj::getStrides() const {
+    if (!strides.empty())
+        return strides;
+    vector<size_t> dense(shape.size());
+    for (size_t d = shape.size(), s = 1; d-- > 0; s *= shape[d])
+        dense[d] = s;
+    return dense;
+}
+
+bool TensorObj::isContiguous() const {
+    if (strides.empty())
+        return true;
+    // the stride of a dim of extent 1 never applies
+    for (size_t d = shape.size(), s = 1; d-- > 0; s *= shape[d])
+        if (shape[d] != 1 && strides[d] != s)
+            return false;
+    return true;
+}
+
 void TensorObj::printData() const {
     IT_ASSERT(data != nullptr);
     if (!runtime->isCpu())
@@ -0,0 +1,98 @@
+#include "core/tracer.h"
+#include "core/operator.h"
+#include <fstream>
+
+namespace infini
+{
+    Tracer &Tracer::getInstance()
+    {
+        static Tracer instance;
+        return instance;
+    }
+
+    Tracer::ThreadBuffer &Tracer::localBuffer()
+    {
+        // registered once per thread, the tracer owns the buffer
+        static thread_local ThreadBuffer *buffer = nullptr;
+        if (!buffer)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.emplace_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers.back().get();
+            buffer->tid = buffers.size() - 1;
+        }
+        return *buffer;
+    }
+
+    void Tracer::start()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &buffer : buffers)
+            buffer->events.clear();
+        events.clear();
+        origin = Clock::now();
+        enabled.store(true, std::memory_order_relaxed);
+    }
+
+    static string shapesToJson(const TensorVec &tensors)
+    {
+        string ret = "[";
+        for (size_t i = 0; i < tensors.size(); ++i)
+            ret += (i ? "," : "") + vecToString(tensors[i]->getDims());
+        return ret + "]";
+    }
+
+    void Tracer::flush()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto micros = [&](Clock::time_point t)
+        {
+            return std::chrono::duration<double, std::micro>(t - origin)
+                .count();
+        };
+        for (auto &buffer : buffers)
+        {
+            for (auto &e : buffer->events)
+            {
+                std::ostringstream os;
+                os.precision(3);
+                os << std::fixed;
+                if (e.op)
+                    os << "{\"name\":\"" << e.op->getOpType().toString()
+                       << "\",\"cat\":\"op\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+                       << buffer->tid << ",\"ts\":" << micros(e.begin)
+                       << ",\"dur\":" << micros(e.end) - micros(e.begin)
+                       << ",\"args\":{\"guid\":" << e.op->getGuid()
+                       << ",\"kernel\":\"" << *e.kernel
+                       << "\",\"inputs\":" << shapesToJson(e.op->getInputs())
+                       << ",\"outputs\":" << shapesToJson(e.op->getOutputs())
+                       << "}}";
+                else
+                    os << "{\"name\":\"allocator\",\"cat\":\"memory\","
+                          "\"ph\":\"C\",\"pid\":0,\"tid\":"
+                       << buffer->tid << ",\"ts\":" << micros(e.begin)
+                       << ",\"args\":{\"used\":" << e.used
+                       << ",\"peak\":" << e.peak << "}}";
+                events.emplace_back(os.str());
+            }
+            buffer->events.clear();
+        }
+    }
+
+    string Tracer::toJson()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        string ret = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        for (size_t i = 0; i < events.size(); ++i)
+            ret += (i ? ",\n" : "\n") + events[i];
+        return ret + "\n]}\n";
+    }
+
+    void Tracer::save(const string &path)
+    {
+        std::ofstream file(path);
+        IT_ASSERT(file, "Cannot open " + path);
+        file << toJson();
+    }
+
+} // namespace infini
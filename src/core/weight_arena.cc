@@ -0,0 +1,72 @@
+#include "core/weight_arena.h"
+#include "core/blob.h"
+#include <cstring>
+#include <sys/mman.h>
+
+namespace infini {
+WeightArena::WeightArena(Runtime runtime)
+    : runtime(runtime), ptr(nullptr), size(0), sealed(false) {}
+
+WeightArena::~WeightArena() {
+    for (auto &[key, entry] : staged)
+        runtime->dealloc(entry.second);
+    if (ptr != nullptr)
+        munmap(ptr, size);
+}
+
+void WeightArena::stage(const Tensor &tensor) {
+    IT_ASSERT(!isSealed(), "The weights are read-only once planned");
+    IT_ASSERT(staged.count(tensor.get()) == 0);
+    void *buffer = runtime->alloc(tensor->getBytes());
+    staged.emplace(tensor.get(), std::make_pair(tensor, buffer));
+    tensor->setDataBlob(make_ref<BlobObj>(runtime, buffer));
+}
+
+void WeightArena::release(const Tensor &tensor) {
+    auto it = staged.find(tensor.get());
+    if (it == staged.end())
+        return;
+    runtime->dealloc(it->second.second);
+    staged.erase(it);
+}
+
+void WeightArena::seal(const TensorVec &tensors) {
+    IT_ASSERT(!isSealed());
+    sealed = true;
+    auto aligned = [](size_t n) {
+        return (n + alignment - 1) / alignment * alignment;
+    };
+
+    std::unordered_map<TensorObj *, size_t> offsets;
+    size_t total = 0;
+    for (auto &tensor : tensors)
+        if (staged.count(tensor.get())) {
+            offsets[tensor.get()] = total;
+            total += aligned(tensor->getBytes());
+        }
+
+    if (total > 0) {
+        // an anonymous mapping starts on a page boundary
+        size = total;
+        ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        IT_ASSERT(ptr != MAP_FAILED, "Failed to map the weights");
+        auto base = static_cast<char *>(ptr);
+        for (auto &tensor : tensors) {
+            auto it = offsets.find(tensor.get());
+            if (it == offsets.end())
+                continue;
+            std::memcpy(base + it->second, staged.at(tensor.get()).second,
+                        tensor->getBytes());
+            tensor->setDataBlob(make_ref<BlobObj>(runtime, base + it->second));
+        }
+        IT_ASSERT(mprotect(ptr, size, PROT_READ) == 0,
+                  "Failed to protect the weights");
+    }
+
+    // the constants dropped from the graph go too
+    for (auto &[key, entry] : staged)
+        runtime->dealloc(entry.second);
+    staged.clear();
+}
+} // namespace infini
@@ -0,0 +1,98 @@
+#include "kernels/cpu/broadcast.h"
+#include <algorithm>
+
+namespace infini {
+
+static vector<Shape> shapesOf(const TensorVec &tensors) {
+    vector<Shape> shapes;
+    for (auto &tensor : tensors)
+        shapes.emplace_back(tensor->getDims());
+    return shapes;
+}
+
+// empty when every tensor is contiguous
+static vector<vector<size_t>> stridesOf(const TensorVec &tensors) {
+    vector<vector<size_t>> strides;
+    if (std::all_of(tensors.begin(), tensors.end(),
+                    [](const Tensor &t) { return t->isContiguous(); }))
+        return strides;
+    for (auto &tensor : tensors)
+        strides.emplace_back(tensor->getStrides());
+    return strides;
+}
+
+BroadcastIterator::BroadcastIterator(const Tensor &output,
+                                     const TensorVec &inputs)
+    : BroadcastIterator(output->getDims(), shapesOf(inputs),
+                        stridesOf(inputs)) {}
+
+BroadcastIterator::BroadcastIterator(
+    const Shape &output, const vector<Shape> &inputs,
+    const vector<vector<size_t>> &inputStrides)
+    : nInputs(inputs.size()), outSize(1) {
+    const size_t rank = output.size();
+    for (auto d : output)
+        outSize *= d;
+
+    // strides of every input over the full output rank, 0 where broadcast
+    vector<vector<size_t>> fullStrides(nInputs, vector<size_t>(rank, 0));
+    for (size_t i = 0; i < nInputs; ++i) {
+        const auto &shape = inputs[i];
+        IT_ASSERT(shape.size() <= rank);
+        const size_t *own =
+            inputStrides.empty() ? nullptr : inputStrides[i].data();
+        size_t stride = 1;
+        for (size_t j = shape.size(); j-- > 0;) {
+            size_t d = j + rank - shape.size();
+            IT_ASSERT(shape[j] == output[d] || shape[j] == 1);
+            if (shape[j] != 1)
+                fullStrides[i][d] = own ? own[j] : stride;
+            stride *= shape[j];
+        }
+    }
+
+    // drop dims of extent 1 and merge dims every input is contiguous across
+    vector<vector<size_t>> merged(nInputs);
+    for (size_t d = 0; d < rank; ++d) {
+        if (output[d] == 1)
+            continue;
+        bool mergeable = !dims.empty();
+        for (size_t i = 0; mergeable && i < nInputs; ++i)
+            mergeable = merged[i].back() == fullStrides[i][d] * output[d];
+        if (mergeable) {
+            dims.back() *= output[d];
+            for (size_t i = 0; i < nInputs; ++i)
+                merged[i].back() = fullStrides[i][d];
+        } else {
+            dims.emplace_back(output[d]);
+            for (size_t i = 0; i < nInputs; ++i)
+                merged[i].emplace_back(fullStrides[i][d]);
+        }
+    }
+    if (dims.empty()) {
+        // a single element, every input is a single element too
+        dims.emplace_back(1);
+        for (auto &s : merged)
+            s.emplace_back(1);
+    }
+
+    const size_t newRank = dims.size();
+    for (auto &s : merged)
+        strides.insert(strides.end(), s.begin(), s.end());
+
+    bool contiguous = true, unit = true, rowsOnly = newRank == 2;
+    for (size_t i = 0; i < nInputs; ++i) {
+        const size_t *s = &strides[i * newRank];
+        contiguous = contiguous && s[newRank - 1] == 1;
+        unit = unit && s[newRank - 1] <= 1;
+        rowsOnly = rowsOnly && s[1] == 1 && (s[0] == 0 || s[0] == dims[1]);
+    }
+    if (newRank == 1 && unit)
+        _kind = contiguous ? Kind::SameShape : Kind::ScalarBroadcast;
+    else if (rowsOnly)
+        _kind = Kind::RowBroadcast;
+    else
+        _kind = Kind::General;
+}
+
+} // namespace infini
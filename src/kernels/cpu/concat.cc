@@ -1,64 +1,113 @@
 #include "operators/concat.h"
 #include "core/kernel.h"
+#include "kernels/cpu/simd.h"
+#include "utils/parallel.h"
+#include <algorithm>
+#include <cstring>
 
 namespace infini {
 
-class NaiveConcat : public CpuKernelWithoutConfig {
-    template <typename T>
-    void doCompute(const Operator &_op, const RuntimeObj *context) const {
+/**
+ * @brief Concatenation as block copies: along the concatenated dim every
+ * input contributes one contiguous chunk to each of the `outer` rows of the
+ * output. Chunks are cut into pieces of at most `pieceBytes`, and the pieces
+ * of all the rows and all the inputs are split among threads. Elements are
+ * only handled by their size.
+ */
+template <typename T> class NaiveConcat : public CpuKernelWithoutConfig {
+    static constexpr size_t pieceBytes = 1 << 16;
+    // bytes per thread below which threading does not pay off
+    static constexpr size_t grainBytes = 1 << 16;
+    // outputs larger than this are written around the cache
+    static constexpr size_t nonTemporalBytes = 1 << 23;
+
+    struct Params {
+        vector<const char *> src;
+        char *dst;
+        // the chunk of each input in a row, its offset in the row and its
+        // first piece
+        vector<size_t> chunk, offset, firstPiece;
+        size_t outer, rowBytes, piecesPerRow;
+        void (*copy)(void *, const void *, size_t);
+    };
+
+    static Params prepare(const Operator &_op) {
         auto op = as<ConcatObj>(_op);
-        auto inputs = op->getInputs(), outputs = op->getOutputs();
-        auto dim = op->getDim();
-        auto output = outputs[0];
-        std::vector<Shape> iDims;
-        for (auto input : inputs)
-            iDims.emplace_back(input->getDims());
+        auto inputs = op->getInputs();
+        auto output = op->getOutput();
         const auto &outDim = output->getDims();
-        size_t blockOffsetInner = 1;
-        for (size_t i = outDim.size() - 1; i > (size_t)dim; --i)
-            blockOffsetInner *= outDim[i];
-        size_t blockOffset = outDim[dim] * blockOffsetInner;
-        for (size_t i = 0; i < inputs.size(); ++i) {
-            auto input = inputs[i];
-            auto dimOffset = 0;
-            auto iDim = iDims[i];
-            for (size_t j = 0; j < i; ++j)
-                dimOffset += iDims[j][dim];
-            size_t localBlockOffset = 1;
-            for (size_t i = iDim.size() - 1;
-                 i >= (size_t)dim && i != (size_t)-1; --i)
-                localBlockOffset *= iDim[i];
-            auto innerOffset = blockOffsetInner * dimOffset;
-            auto inSize = input->size();
-            auto inPtr = input->getRawDataPtr<T *>(),
-                 outPtr = output->getRawDataPtr<T *>();
-#pragma omp parallel for
-            for (size_t iOffset = 0; iOffset < inSize; ++iOffset) {
-                auto oOffset = iOffset % localBlockOffset + innerOffset +
-                               iOffset / localBlockOffset * blockOffset;
-                outPtr[oOffset] = inPtr[iOffset];
-            }
+        const size_t dim = op->getDim();
+
+        Params p;
+        size_t inner = sizeof(T);
+        p.outer = 1;
+        for (size_t i = 0; i < dim; ++i)
+            p.outer *= outDim[i];
+        for (size_t i = dim + 1; i < outDim.size(); ++i)
+            inner *= outDim[i];
+        p.rowBytes = outDim[dim] * inner;
+
+        const size_t n = inputs.size();
+        p.chunk.resize(n);
+        p.offset.resize(n);
+        p.firstPiece.assign(n + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            p.chunk[i] = inputs[i]->getDims()[dim] * inner;
+            p.offset[i] = i == 0 ? 0 : p.offset[i - 1] + p.chunk[i - 1];
+            p.firstPiece[i + 1] =
+                p.firstPiece[i] + (p.chunk[i] + pieceBytes - 1) / pieceBytes;
+            p.src.emplace_back(inputs[i]->getRawDataPtr<char *>());
         }
+        p.piecesPerRow = p.firstPiece[n];
+        p.dst = output->getRawDataPtr<char *>();
+        p.copy = stream_copy;
+        if (output->getBytes() < nonTemporalBytes)
+            p.copy = [](void *d, const void *s, size_t bytes) {
+                std::memcpy(d, s, bytes);
+            };
+        return p;
+    }
+
+    static void run(const Params &p) {
+        const size_t piecesPerRow = p.piecesPerRow;
+        if (p.outer == 0 || piecesPerRow == 0)
+            return;
+        const auto &firstPiece = p.firstPiece;
+        size_t units = p.outer * piecesPerRow;
+        size_t unitBytes = std::max<size_t>(1, p.rowBytes / piecesPerRow);
+        parallel_for(
+            units, std::max<size_t>(1, grainBytes / unitBytes),
+            [&](size_t begin, size_t end) {
+                size_t row = begin / piecesPerRow, q = begin % piecesPerRow;
+                size_t i = std::upper_bound(firstPiece.begin(),
+                                            firstPiece.end(), q) -
+                           firstPiece.begin() - 1;
+                for (size_t u = begin; u < end; ++u) {
+                    size_t at = (q - firstPiece[i]) * pieceBytes;
+                    p.copy(p.dst + row * p.rowBytes + p.offset[i] + at,
+                           p.src[i] + row * p.chunk[i] + at,
+                           std::min(pieceBytes, p.chunk[i] - at));
+                    if (++q == piecesPerRow)
+                        ++row, q = 0, i = 0;
+                    // skip the inputs with empty chunks
+                    while (q == firstPiece[i + 1])
+                        ++i;
+                }
+            });
     }
 
     void compute(const Operator &_op,
                  const RuntimeObj *context) const override {
-#define CASE(N)                                                                \
-    case N:                                                                    \
-        doCompute<DT<N>::t>(_op, context)
+        run(prepare(_op));
+    }
 
-        int dataTypeIdx = _op->getDType().getIndex();
-        switch (dataTypeIdx) {
-            CASE(1); // DataType::Float32
-            break;
-            CASE(12); // DataType::UInt32
-            break;
-        default:
-            IT_TODO_HALT();
-        }
+    KernelStep compile(const Operator &_op,
+                       const RuntimeObj *context) const override {
+        return KernelStep::make<Params, run>(prepare(_op));
     }
 };
 
-REGISTER_KERNEL(Device::CPU, OpType::Concat, NaiveConcat, "ConcatNaive_CPU");
+REGISTER_KERNEL_FOR_TYPES(Device::CPU, OpType::Concat, CpuArithmeticTypes,
+                          NaiveConcat, "ConcatNaive_CPU");
 
 } // namespace infini
@@ -1,119 +1,257 @@
 #include "operators/element_wise.h"
 #include "core/kernel.h"
-#include "utils/operator_utils.h"
+#include "kernels/cpu/broadcast.h"
+#include "kernels/cpu/simd.h"
+#include "utils/parallel.h"
 
 namespace infini
 {
+    template <typename T>
     class NativeElementWise : public CpuKernelWithoutConfig
     {
-        template <typename T>
-        static T addCompute(T val0, T val1)
+        // One row of the broadcast output. Each combination of strides 0
+        // and 1 gets its own loop so that the compiler can vectorize it.
+        template <typename F>
+        static void computeRow(size_t n, const T *a, size_t strideA,
+                               const T *b, size_t strideB, T *c, F f)
         {
-            return val0 + val1;
+            if (strideA > 1 || strideB > 1)
+                for (size_t i = 0; i < n; ++i)
+                    c[i] = f(a[i * strideA], b[i * strideB]);
+            else if (strideA && strideB)
+                for (size_t i = 0; i < n; ++i)
+                    c[i] = f(a[i], b[i]);
+            else if (strideB)
+                for (size_t i = 0; i < n; ++i)
+                    c[i] = f(a[0], b[i]);
+            else if (strideA)
+                for (size_t i = 0; i < n; ++i)
+                    c[i] = f(a[i], b[0]);
+            else
+                std::fill(c, c + n, f(a[0], b[0]));
         }
 
-        template <typename T>
-        static T subCompute(T val0, T val1)
+        template <typename F>
+        static void compute(const BroadcastIterator &it, const T *a,
+                            const T *b, T *c, F f)
         {
-            return val0 - val1;
-        }
-
-        template <typename T>
-        static T mulCompute(T val0, T val1)
-        {
-            return val0 * val1;
+            size_t n = it.innerSize();
+            size_t strideA = it.innerStride(0), strideB = it.innerStride(1);
+            switch (it.kind())
+            {
+            case BroadcastIterator::Kind::SameShape:
+            case BroadcastIterator::Kind::ScalarBroadcast:
+                computeRow(n, a, strideA, b, strideB, c, f);
+                break;
+            case BroadcastIterator::Kind::RowBroadcast:
+            {
+                // a full input moves by a row, a row vector stays in place
+                size_t rowA = it.stride(0, 0), rowB = it.stride(1, 0);
+                for (size_t r = 0, rows = it.rows(); r < rows; ++r)
+                    computeRow(n, a + r * rowA, strideA, b + r * rowB, strideB,
+                               c + r * n, f);
+                break;
+            }
+            default:
+                it.forEachRow([&](size_t o, const size_t *offsets)
+                              { computeRow(n, a + offsets[0], strideA,
+                                           b + offsets[1], strideB, c + o,
+                                           f); });
+            }
         }
 
-        template <typename T>
-        static T divCompute(T val0, T val1)
-        {
-            return (T)(val0 / val1);
-        }
+    public:
+        bool acceptsStridedInputs() const override { return true; }
 
-        template <typename T>
-        void doCompute(const Operator &_op, const RuntimeObj *context) const
+    protected:
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
         {
             auto op = as<ElementWiseObj>(_op);
             T *inptr0 = op->getInputs(0)->getRawDataPtr<T *>();
             T *inptr1 = op->getInputs(1)->getRawDataPtr<T *>();
             T *outptr = op->getOutput()->getRawDataPtr<T *>();
 
-            auto shapeA = op->getInputs(0)->getDims();
-            auto shapeB = op->getInputs(1)->getDims();
-            auto shapeC = op->getOutput()->getDims();
-            auto rank = op->getOutput()->getRank();
-            Shape a(rank, 1);
-            Shape b(rank, 1);
-            std::copy(shapeA.begin(), shapeA.end(),
-                      a.begin() + (rank - shapeA.size()));
-            std::copy(shapeB.begin(), shapeB.end(),
-                      b.begin() + (rank - shapeB.size()));
-            auto getStride = [&](const Shape &shape)
-            {
-                int p = 1;
-                Shape stride(rank);
-                for (auto i = rank; i > 0; --i)
-                {
-                    stride[i - 1] = p;
-                    p = p * shape[i - 1];
-                }
-                return stride;
-            };
-            Shape strideA = getStride(a);
-            Shape strideB = getStride(b);
-
-            auto n = op->getOutput()->size();
-            T (*_doCompute)
-            (T val0, T val1);
+            BroadcastIterator it(op->getOutput(), op->getInputs());
             switch (op->getOpType().underlying())
             {
             case OpType::Add:
-                _doCompute = addCompute<T>;
+                compute(it, inptr0, inptr1, outptr,
+                        [](T x, T y) { return T(x + y); });
                 break;
             case OpType::Sub:
-                _doCompute = subCompute<T>;
+                compute(it, inptr0, inptr1, outptr,
+                        [](T x, T y) { return T(x - y); });
                 break;
             case OpType::Mul:
-                _doCompute = mulCompute<T>;
+                compute(it, inptr0, inptr1, outptr,
+                        [](T x, T y) { return T(x * y); });
                 break;
             case OpType::Div:
-                _doCompute = divCompute<T>;
+                compute(it, inptr0, inptr1, outptr,
+                        [](T x, T y) { return T(x / y); });
                 break;
             default:
                 IT_TODO_HALT();
             }
+        }
+    };
+
+    /**
+     * @brief Float32 element-wise ops with explicit SSE/AVX2/AVX-512 loops,
+     * the instruction set being picked from CPUID. Float16 and BFloat16 rows
+     * are converted to Float32 by chunks and computed by the same loops.
+     * Large outputs are split among threads.
+     */
+    template <typename T>
+    class SimdElementWise : public CpuKernelWithoutConfig
+    {
+        // elements per thread below which threading does not pay off
+        static constexpr size_t grain = 1 << 15;
 
+        struct Params
+        {
+            SimdKernels::BinaryRow row;
+            WidenRow widen;
+            NarrowRow narrow;
+            const T *a, *b;
+            T *c;
+            BroadcastIterator it;
+        };
+
+        // Copies `n` elements `stride` apart into `dst`
+        static const T *gather(size_t n, const T *src, size_t stride, T *dst)
+        {
             for (size_t i = 0; i < n; ++i)
+                dst[i] = src[i * stride];
+            return dst;
+        }
+
+        // Calls the Float32 row on a row of T. The rows of strided inputs
+        // are gathered by chunks first.
+        static void row(const Params &p, size_t n, const T *a, size_t strideA,
+                        const T *b, size_t strideB, T *c)
+        {
+            if constexpr (std::is_same_v<T, float>)
             {
-                auto shapeIndexC = locate_index(i, shapeC);
-                auto indexA = delocate_index(shapeIndexC, a, strideA);
-                auto indexB = delocate_index(shapeIndexC, b, strideB);
-                outptr[i] = _doCompute(inptr0[indexA], inptr1[indexB]);
+                if (strideA <= 1 && strideB <= 1)
+                {
+                    p.row(n, a, strideA, b, strideB, c);
+                    return;
+                }
+            }
+            T ga[halfChunk], gb[halfChunk];
+            for (size_t i = 0; i < n; i += halfChunk)
+            {
+                size_t m = std::min(halfChunk, n - i);
+                const T *ra = a + i * strideA, *rb = b + i * strideB;
+                size_t sa = std::min<size_t>(strideA, 1),
+                       sb = std::min<size_t>(strideB, 1);
+                if (strideA > 1)
+                    ra = gather(m, ra, strideA, ga);
+                if (strideB > 1)
+                    rb = gather(m, rb, strideB, gb);
+                if constexpr (std::is_same_v<T, float>)
+                    p.row(m, ra, sa, rb, sb, c + i);
+                else
+                {
+                    float x[halfChunk], y[halfChunk], z[halfChunk];
+                    p.widen(sa ? m : 1, bits(ra), x);
+                    p.widen(sb ? m : 1, bits(rb), y);
+                    p.row(m, x, sa, y, sb, z);
+                    p.narrow(m, z, bits(c + i));
+                }
             }
         }
 
-        void compute(const Operator &_op,
-                     const RuntimeObj *context) const override
+        static Params prepare(const Operator &_op)
         {
-#define CASE(N) \
-    case N:     \
-        doCompute<DT<N>::t>(_op, context)
-
-            int dataTypeIdx = _op->getDType().getIndex();
-            switch (dataTypeIdx)
+            auto op = as<ElementWiseObj>(_op);
+            const auto &kernels = get_simd_kernels(get_cpu_isa());
+            SimdKernels::BinaryRow row;
+            switch (op->getOpType().underlying())
             {
-                CASE(1); // DataType::Float32
+            case OpType::Add:
+                row = kernels.add;
+                break;
+            case OpType::Sub:
+                row = kernels.sub;
                 break;
-                CASE(12); // DataType::UInt32
+            case OpType::Mul:
+                row = kernels.mul;
+                break;
+            case OpType::Div:
+                row = kernels.div;
                 break;
             default:
                 IT_TODO_HALT();
             }
+            auto [widen, narrow] = half_conversions<T>(kernels);
+            return {row, widen, narrow,
+                    op->getInputs(0)->getRawDataPtr<T *>(),
+                    op->getInputs(1)->getRawDataPtr<T *>(),
+                    op->getOutput()->getRawDataPtr<T *>(),
+                    BroadcastIterator(op->getOutput(), op->getInputs())};
         }
+
+        static void run(const Params &p)
+        {
+            const auto &it = p.it;
+            const T *a = p.a, *b = p.b;
+            T *c = p.c;
+            size_t n = it.innerSize();
+            size_t strideA = it.innerStride(0), strideB = it.innerStride(1);
+            if (it.rows() == 1)
+            {
+                parallel_for(n, grain, [&](size_t begin, size_t end)
+                             { row(p, end - begin, a + begin * strideA,
+                                   strideA, b + begin * strideB, strideB,
+                                   c + begin); });
+                return;
+            }
+            parallel_for(it.rows(), std::max<size_t>(1, grain / n),
+                         [&](size_t begin, size_t end)
+                         { it.forEachRow(begin, end,
+                                         [&](size_t o, const size_t *offsets)
+                                         { row(p, n, a + offsets[0], strideA,
+                                               b + offsets[1], strideB,
+                                               c + o); }); });
+        }
+
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
+        {
+            run(prepare(_op));
+        }
+
+        KernelStep compile(const Operator &_op,
+                           const RuntimeObj *context) const override
+        {
+            return KernelStep::make<Params, run>(prepare(_op));
+        }
+
+    public:
+        bool acceptsStridedInputs() const override { return true; }
     };
 
-    REGISTER_KERNEL(Device::CPU, OpType::Add, NativeElementWise, "addNaive_CPU");
-    REGISTER_KERNEL(Device::CPU, OpType::Sub, NativeElementWise, "subNaive_CPU");
-    REGISTER_KERNEL(Device::CPU, OpType::Mul, NativeElementWise, "mulNaive_CPU");
-    REGISTER_KERNEL(Device::CPU, OpType::Div, NativeElementWise, "divNaive_CPU");
+    REGISTER_KERNEL_FOR_TYPES(Device::CPU, OpType::Add, CpuArithmeticTypes,
+                              NativeElementWise, "addNaive_CPU");
+    REGISTER_KERNEL_FOR_TYPES(Device::CPU, OpType::Sub, CpuArithmeticTypes,
+                              NativeElementWise, "subNaive_CPU");
+    REGISTER_KERNEL_FOR_TYPES(Device::CPU, OpType::Mul, CpuArithmeticTypes,
+                              NativeElementWise, "mulNaive_CPU");
+    REGISTER_KERNEL_FOR_TYPES(Device::CPU, OpType::Div, CpuArithmeticTypes,
+                              NativeElementWise, "divNaive_CPU");
+    REGISTER_KERNEL_FOR_TYPES_WITH_PRIORITY(Device::CPU, OpType::Add,
+                                            CpuFloatTypes, SimdElementWise,
+                                            "addSimd_CPU", 1);
+    REGISTER_KERNEL_FOR_TYPES_WITH_PRIORITY(Device::CPU, OpType::Sub,
+                                            CpuFloatTypes, SimdElementWise,
+                                            "subSimd_CPU", 1);
+    REGISTER_KERNEL_FOR_TYPES_WITH_PRIORITY(Device::CPU, OpType::Mul,
+                                            CpuFloatTypes, SimdElementWise,
+                                            "mulSimd_CPU", 1);
+    REGISTER_KERNEL_FOR_TYPES_WITH_PRIORITY(Device::CPU, OpType::Div,
+                                            CpuFloatTypes, SimdElementWise,
+                                            "divSimd_CPU", 1);
 }; // namespace infini
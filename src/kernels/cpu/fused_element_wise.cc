@@ -0,0 +1,297 @@
+#include "operators/fused_element_wise.h"
+#include "core/kernel.h"
+#include "kernels/cpu/broadcast.h"
+#include "kernels/cpu/simd.h"
+#include "utils/parallel.h"
+#include <cstring>
+#include <limits>
+
+namespace infini
+{
+    /**
+     * @brief Evaluates the program of a FusedElementwiseObj in one pass. Every
+     * row of the broadcast output is cut into chunks of `halfChunk` elements
+     * and each step runs the SIMD loop of its op over a chunk, so that the
+     * registers of the program stay in L1 and only the inputs and the output
+     * go through memory. Everything is computed in Float32: Float16 and
+     * BFloat16 inputs are widened as they are loaded, the output is narrowed
+     * as it is stored and a Cast to them rounds in place.
+     */
+    class SimdFusedElementwise : public CpuKernelWithoutConfig
+    {
+        // elements per thread below which threading does not pay off
+        static constexpr size_t grain = 1 << 15;
+
+        struct Step
+        {
+            OpType type;
+            int a, b;
+            SimdKernels::BinaryRow binary;
+            float lo, hi;
+            // the rounding of a Cast to Float16/BFloat16, null otherwise
+            WidenRow widen;
+            NarrowRow narrow;
+        };
+
+        struct Params
+        {
+            const SimdKernels *kernels;
+            vector<Step> steps;
+            vector<const void *> inputs;
+            // the conversion of every input, null for Float32
+            vector<WidenRow> widen;
+            void *output;
+            NarrowRow narrow;
+            BroadcastIterator it;
+        };
+
+        // A register: a chunk, or a single element broadcast along the chunk
+        struct Operand
+        {
+            const float *ptr;
+            size_t stride;
+        };
+
+        // The registers of one thread, in buffers of the thread that only
+        // grow so that a run allocates nothing once the thread has run a
+        // program as large
+        struct Workspace
+        {
+            float *regs;
+            Operand *operands;
+            uint16_t scratch[halfChunk];
+
+            explicit Workspace(const Params &p)
+            {
+                thread_local vector<float> regBuffer;
+                thread_local vector<Operand> operandBuffer;
+                size_t n = p.inputs.size() + p.steps.size();
+                if (regBuffer.size() < n * halfChunk)
+                    regBuffer.resize(n * halfChunk);
+                if (operandBuffer.size() < n)
+                    operandBuffer.resize(n);
+                regs = regBuffer.data();
+                operands = operandBuffer.data();
+            }
+            float *reg(size_t r) { return regs + r * halfChunk; }
+        };
+
+        static Params prepare(const Operator &_op)
+        {
+            auto op = as<FusedElementwiseObj>(_op);
+            const auto &kernels = get_simd_kernels(get_cpu_isa());
+            auto conversions =
+                [&](DataType dtype) -> std::pair<WidenRow, NarrowRow>
+            {
+                if (dtype == DataType::Float16)
+                    return half_conversions<float16_t>(kernels);
+                if (dtype == DataType::BFloat16)
+                    return half_conversions<bfloat16_t>(kernels);
+                return {nullptr, nullptr};
+            };
+
+            Params p{&kernels, {}, {}, {}, nullptr, nullptr,
+                     BroadcastIterator(op->getOutput(), op->getInputs())};
+            for (auto &step : op->getProgram())
+            {
+                constexpr float inf = std::numeric_limits<float>::infinity();
+                Step s{step.type, step.a, step.b, nullptr,
+                       step.min.value_or(-inf), step.max.value_or(inf),
+                       nullptr, nullptr};
+                switch (step.type.underlying())
+                {
+                case OpType::Add:
+                    s.binary = kernels.add;
+                    break;
+                case OpType::Sub:
+                    s.binary = kernels.sub;
+                    break;
+                case OpType::Mul:
+                    s.binary = kernels.mul;
+                    break;
+                case OpType::Div:
+                    s.binary = kernels.div;
+                    break;
+                case OpType::Relu:
+                case OpType::Clip:
+                    break;
+                case OpType::Cast:
+                    std::tie(s.widen, s.narrow) = conversions(step.dtype);
+                    break;
+                default:
+                    IT_TODO_HALT();
+                }
+                p.steps.emplace_back(s);
+            }
+            for (auto &input : op->getInputs())
+            {
+                p.inputs.emplace_back(input->getRawDataPtr<void *>());
+                p.widen.emplace_back(conversions(input->getDType()).first);
+            }
+            p.output = op->getOutput()->getRawDataPtr<void *>();
+            p.narrow = conversions(op->getOutput()->getDType()).second;
+            return p;
+        }
+
+        // Evaluates `n` elements of the output from `outOffset` on, where the
+        // elements of input i start at `offsets[i]` and move by its inner
+        // stride
+        static void row(const Params &p, Workspace &ws, size_t n,
+                        const size_t *offsets, size_t outOffset)
+        {
+            const size_t nInputs = p.inputs.size(), nSteps = p.steps.size();
+            auto &operands = ws.operands;
+            for (size_t i = 0; i < n; i += halfChunk)
+            {
+                size_t m = std::min(halfChunk, n - i);
+                for (size_t r = 0; r < nInputs; ++r)
+                {
+                    size_t stride = p.it.innerStride(r);
+                    size_t at = offsets[r] + i * stride;
+                    if (stride > 1)
+                    {
+                        // a strided view, gathered into its register
+                        float *reg = ws.reg(r);
+                        if (!p.widen[r])
+                        {
+                            auto in = static_cast<const float *>(p.inputs[r]);
+                            for (size_t j = 0; j < m; ++j)
+                                reg[j] = in[at + j * stride];
+                        }
+                        else
+                        {
+                            auto in =
+                                static_cast<const uint16_t *>(p.inputs[r]);
+                            for (size_t j = 0; j < m; ++j)
+                                ws.scratch[j] = in[at + j * stride];
+                            p.widen[r](m, ws.scratch, reg);
+                        }
+                        operands[r] = {reg, 1};
+                    }
+                    else if (!p.widen[r])
+                        operands[r] = {
+                            static_cast<const float *>(p.inputs[r]) + at,
+                            stride};
+                    else
+                    {
+                        auto in = static_cast<const uint16_t *>(p.inputs[r]);
+                        p.widen[r](stride ? m : 1, in + at, ws.reg(r));
+                        operands[r] = {ws.reg(r), stride};
+                    }
+                }
+
+                // a Float32 output is written by the last step directly
+                float *out =
+                    p.narrow ? nullptr
+                             : static_cast<float *>(p.output) + outOffset + i;
+                for (size_t k = 0; k < nSteps; ++k)
+                {
+                    const auto &step = p.steps[k];
+                    Operand a = operands[step.a];
+                    Operand b = step.b >= 0 ? operands[step.b]
+                                            : Operand{nullptr, 0};
+                    size_t stride = std::max(a.stride, b.stride);
+                    size_t cnt = stride ? m : 1;
+                    float *dst = out && stride && k + 1 == nSteps
+                                     ? out
+                                     : ws.reg(nInputs + k);
+                    switch (step.type.underlying())
+                    {
+                    case OpType::Relu:
+                        p.kernels->relu(cnt, a.ptr, dst);
+                        break;
+                    case OpType::Clip:
+                        p.kernels->clip(cnt, a.ptr, dst, step.lo, step.hi);
+                        break;
+                    case OpType::Cast:
+                        if (!step.narrow)
+                        {
+                            // Float32 represents the operand exactly
+                            operands[nInputs + k] = a;
+                            continue;
+                        }
+                        step.narrow(cnt, a.ptr, ws.scratch);
+                        step.widen(cnt, ws.scratch, dst);
+                        break;
+                    default:
+                        step.binary(cnt, a.ptr, a.stride, b.ptr, b.stride, dst);
+                    }
+                    operands[nInputs + k] = {dst, stride};
+                }
+
+                Operand res = operands[nInputs + nSteps - 1];
+                if (out)
+                {
+                    if (res.ptr == out)
+                        continue;
+                    if (res.stride)
+                        std::memcpy(out, res.ptr, m * sizeof(float));
+                    else
+                        std::fill(out, out + m, res.ptr[0]);
+                }
+                else
+                {
+                    uint16_t *bits =
+                        static_cast<uint16_t *>(p.output) + outOffset + i;
+                    if (res.stride)
+                        p.narrow(m, res.ptr, bits);
+                    else
+                    {
+                        p.narrow(1, res.ptr, bits);
+                        std::fill(bits + 1, bits + m, bits[0]);
+                    }
+                }
+            }
+        }
+
+        static void run(const Params &p)
+        {
+            const auto &it = p.it;
+            const size_t n = it.innerSize(), nInputs = p.inputs.size();
+            if (it.size() == 0)
+                return;
+            if (it.rows() == 1)
+            {
+                parallel_for(n, grain, [&](size_t begin, size_t end)
+                             {
+                                 Workspace ws(p);
+                                 vector<size_t> offsets(nInputs);
+                                 for (size_t r = 0; r < nInputs; ++r)
+                                     offsets[r] = begin * it.innerStride(r);
+                                 row(p, ws, end - begin, offsets.data(),
+                                     begin); });
+                return;
+            }
+            parallel_for(it.rows(), std::max<size_t>(1, grain / n),
+                         [&](size_t begin, size_t end)
+                         {
+                             Workspace ws(p);
+                             it.forEachRow(begin, end,
+                                           [&](size_t o, const size_t *offsets)
+                                           { row(p, ws, n, offsets, o); }); });
+        }
+
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
+        {
+            run(prepare(_op));
+        }
+
+        KernelStep compile(const Operator &_op,
+                           const RuntimeObj *context) const override
+        {
+            return KernelStep::make<Params, run>(prepare(_op));
+        }
+
+    public:
+        bool acceptsStridedInputs() const override { return true; }
+    };
+
+    // Keyed by the type of the first input, the others may differ
+    REGISTER_KERNEL(Device::CPU, OpType::FusedElementwise, DataType::Float32,
+                    SimdFusedElementwise, "FusedElementwiseSimd_CPU");
+    REGISTER_KERNEL(Device::CPU, OpType::FusedElementwise, DataType::Float16,
+                    SimdFusedElementwise, "FusedElementwiseSimd_CPU");
+    REGISTER_KERNEL(Device::CPU, OpType::FusedElementwise, DataType::BFloat16,
+                    SimdFusedElementwise, "FusedElementwiseSimd_CPU");
+}; // namespace infini
@@ -0,0 +1,409 @@
+#include "kernels/cpu/gemm.h"
+#include "utils/cpu_features.h"
+#include "utils/parallel.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace infini {
+
+namespace {
+
+// Computes a full MR x NR tile of C (leading dimension ldc) from a packed
+// MR x kc panel of A and a packed kc x NR panel of B. The tile is overwritten
+// unless `accumulate` is set. An epilogue `ep`, whose bias starts at the
+// first column of the tile, is applied before the store.
+template <typename T>
+using MicroKernel = void (*)(size_t kc, const T *a, const T *b, T *c,
+                             size_t ldc, bool accumulate,
+                             const GemmEpilogue<T> *ep);
+
+template <typename T> struct GemmConfig {
+    size_t mr, nr;     // register block
+    size_t mc, nc, kc; // cache blocks, mc % mr == 0 and nc % nr == 0
+    MicroKernel<T> kernel;
+};
+
+template <typename T>
+inline T applyEpilogue(const GemmEpilogue<T> &ep, T v, size_t j) {
+    if (ep.bias)
+        v += ep.bias[j];
+    return std::min(std::max(v, ep.lo), ep.hi);
+}
+
+template <typename T, size_t MR, size_t NR>
+void microKernelScalar(size_t kc, const T *a, const T *b, T *c, size_t ldc,
+                       bool accumulate, const GemmEpilogue<T> *ep) {
+    T acc[MR][NR] = {};
+    for (size_t p = 0; p < kc; ++p, a += MR, b += NR)
+        for (size_t i = 0; i < MR; ++i)
+            for (size_t j = 0; j < NR; ++j)
+                acc[i][j] += a[i] * b[j];
+    for (size_t i = 0; i < MR; ++i)
+        for (size_t j = 0; j < NR; ++j) {
+            T v = accumulate ? c[i * ldc + j] + acc[i][j] : acc[i][j];
+            c[i * ldc + j] = ep ? applyEpilogue(*ep, v, j) : v;
+        }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 6 x 16: 12 ymm accumulators, 2 for the B row and 1 for the broadcast of A
+__attribute__((target("avx2,fma"))) void
+microKernelAvx2(size_t kc, const float *a, const float *b, float *c,
+                size_t ldc, bool accumulate, const GemmEpilogue<float> *ep) {
+    constexpr size_t MR = 6;
+    __m256 acc[MR][2];
+#pragma GCC unroll 6
+    for (size_t i = 0; i < MR; ++i)
+        acc[i][0] = acc[i][1] = _mm256_setzero_ps();
+    for (size_t p = 0; p < kc; ++p, a += MR, b += 16) {
+        __m256 b0 = _mm256_loadu_ps(b), b1 = _mm256_loadu_ps(b + 8);
+#pragma GCC unroll 6
+        for (size_t i = 0; i < MR; ++i) {
+            __m256 ai = _mm256_broadcast_ss(a + i);
+            acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+        }
+    }
+    __m256 bias0 = _mm256_setzero_ps(), bias1 = bias0, lo = bias0, hi = bias0;
+    if (ep) {
+        if (ep->bias) {
+            bias0 = _mm256_loadu_ps(ep->bias);
+            bias1 = _mm256_loadu_ps(ep->bias + 8);
+        }
+        lo = _mm256_set1_ps(ep->lo);
+        hi = _mm256_set1_ps(ep->hi);
+    }
+#pragma GCC unroll 6
+    for (size_t i = 0; i < MR; ++i) {
+        float *ci = c + i * ldc;
+        if (accumulate) {
+            acc[i][0] = _mm256_add_ps(acc[i][0], _mm256_loadu_ps(ci));
+            acc[i][1] = _mm256_add_ps(acc[i][1], _mm256_loadu_ps(ci + 8));
+        }
+        if (ep) {
+            acc[i][0] = _mm256_add_ps(acc[i][0], bias0);
+            acc[i][1] = _mm256_add_ps(acc[i][1], bias1);
+            acc[i][0] = _mm256_min_ps(_mm256_max_ps(acc[i][0], lo), hi);
+            acc[i][1] = _mm256_min_ps(_mm256_max_ps(acc[i][1], lo), hi);
+        }
+        _mm256_storeu_ps(ci, acc[i][0]);
+        _mm256_storeu_ps(ci + 8, acc[i][1]);
+    }
+}
+
+// 12 x 32: 24 zmm accumulators, 2 for the B row and 1 for the broadcast of A
+__attribute__((target("avx512f"))) void
+microKernelAvx512(size_t kc, const float *a, const float *b, float *c,
+                  size_t ldc, bool accumulate, const GemmEpilogue<float> *ep) {
+    constexpr size_t MR = 12;
+    __m512 acc[MR][2];
+#pragma GCC unroll 12
+    for (size_t i = 0; i < MR; ++i)
+        acc[i][0] = acc[i][1] = _mm512_setzero_ps();
+    for (size_t p = 0; p < kc; ++p, a += MR, b += 32) {
+        __m512 b0 = _mm512_loadu_ps(b), b1 = _mm512_loadu_ps(b + 16);
+#pragma GCC unroll 12
+        for (size_t i = 0; i < MR; ++i) {
+            __m512 ai = _mm512_set1_ps(a[i]);
+            acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+        }
+    }
+    __m512 bias0 = _mm512_setzero_ps(), bias1 = bias0, lo = bias0, hi = bias0;
+    if (ep) {
+        if (ep->bias) {
+            bias0 = _mm512_loadu_ps(ep->bias);
+            bias1 = _mm512_loadu_ps(ep->bias + 16);
+        }
+        lo = _mm512_set1_ps(ep->lo);
+        hi = _mm512_set1_ps(ep->hi);
+    }
+    const __mmask16 all = 0xFFFF;
+#pragma GCC unroll 12
+    for (size_t i = 0; i < MR; ++i) {
+        float *ci = c + i * ldc;
+        if (accumulate) {
+            acc[i][0] = _mm512_add_ps(acc[i][0], _mm512_loadu_ps(ci));
+            acc[i][1] = _mm512_add_ps(acc[i][1], _mm512_loadu_ps(ci + 16));
+        }
+        if (ep) {
+            acc[i][0] = _mm512_add_ps(acc[i][0], bias0);
+            acc[i][1] = _mm512_add_ps(acc[i][1], bias1);
+            // the masked forms, as GCC 12 flags the undefined source of
+            // _mm512_max_ps as maybe uninitialized
+            for (auto &v : acc[i])
+                v = _mm512_mask_min_ps(v, all,
+                                       _mm512_mask_max_ps(v, all, v, lo), hi);
+        }
+        _mm512_storeu_ps(ci, acc[i][0]);
+        _mm512_storeu_ps(ci + 16, acc[i][1]);
+    }
+}
+#endif
+
+template <typename T> GemmConfig<T> getGemmConfig() {
+    return {4, 4, 64, 1024, 256, microKernelScalar<T, 4, 4>};
+}
+
+template <> GemmConfig<float> getGemmConfig<float>() {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (get_cpu_isa()) {
+    case CpuIsa::AVX512:
+        return {12, 32, 96, 2048, 256, microKernelAvx512};
+    case CpuIsa::AVX2:
+        return {6, 16, 96, 2048, 256, microKernelAvx2};
+    default:
+        break;
+    }
+#endif
+    return {4, 8, 64, 1024, 256, microKernelScalar<float, 4, 8>};
+}
+
+// Packs rows [0, rows) x columns [0, cols) of A into panels of mr rows, each
+// panel stored column by column. Rows past the end are zero padded.
+template <typename T>
+void packA(const T *A, ptrdiff_t rs, ptrdiff_t cs, size_t rows, size_t cols,
+           size_t mr, T *dst) {
+    for (size_t i0 = 0; i0 < rows; i0 += mr) {
+        size_t mrb = std::min(mr, rows - i0);
+        for (size_t p = 0; p < cols; ++p) {
+            const T *src = A + i0 * rs + p * cs;
+            size_t i = 0;
+            for (; i < mrb; ++i)
+                *dst++ = src[i * rs];
+            for (; i < mr; ++i)
+                *dst++ = T(0);
+        }
+    }
+}
+
+// Packs rows [0, rows) x columns [0, cols) of B into panels of nr columns,
+// each panel stored row by row. Columns past the end are zero padded.
+template <typename T>
+void packB(const T *B, ptrdiff_t rs, ptrdiff_t cs, size_t rows, size_t cols,
+           size_t nr, T *dst) {
+    for (size_t j0 = 0; j0 < cols; j0 += nr) {
+        size_t nrb = std::min(nr, cols - j0);
+        for (size_t p = 0; p < rows; ++p) {
+            const T *src = B + p * rs + j0 * cs;
+            size_t j = 0;
+            if (cs == 1)
+                for (; j < nrb; ++j)
+                    *dst++ = src[j];
+            else
+                for (; j < nrb; ++j)
+                    *dst++ = src[j * cs];
+            for (; j < nr; ++j)
+                *dst++ = T(0);
+        }
+    }
+}
+
+// Packing buffers of one thread, sized for the blocks it will compute. They
+// live in a buffer of the thread that only grows, so that a GEMM allocates
+// nothing once the thread has run one as large. A workspace must not outlive
+// the block computing with it, as the next one on the thread reuses it.
+template <typename T> struct GemmWorkspace {
+    T *a, *b, *tile;
+    GemmWorkspace(const GemmConfig<T> &cfg, size_t m, size_t n, size_t k) {
+        thread_local std::vector<T> buffer;
+        size_t sizeA = std::min(cfg.mc, roundUp(m, cfg.mr)) *
+                       std::min(cfg.kc, k),
+               sizeB = std::min(cfg.kc, k) *
+                       std::min(cfg.nc, roundUp(n, cfg.nr)),
+               sizeTile = cfg.mr * cfg.nr;
+        if (buffer.size() < sizeA + sizeB + sizeTile)
+            buffer.resize(sizeA + sizeB + sizeTile);
+        a = buffer.data();
+        b = a + sizeA;
+        tile = b + sizeB;
+    }
+
+    static size_t roundUp(size_t x, size_t align) {
+        return (x + align - 1) / align * align;
+    }
+};
+
+// The epilogue `ep`, whose bias starts at the first column of C, is applied
+// by the micro-kernels of the last block of K
+template <typename T>
+void gemmBlocked(const GemmConfig<T> &cfg, GemmWorkspace<T> &ws, size_t m,
+                 size_t n, size_t k, MatrixRef<T> A, MatrixRef<T> B, T *C,
+                 size_t ldc, const GemmEpilogue<T> *ep) {
+    if (m == 0 || n == 0)
+        return;
+    if (k == 0) {
+        for (size_t i = 0; i < m; ++i)
+            for (size_t j = 0; j < n; ++j)
+                C[i * ldc + j] = ep ? applyEpilogue(*ep, T(0), j) : T(0);
+        return;
+    }
+
+    for (size_t jc = 0; jc < n; jc += cfg.nc) {
+        size_t ncb = std::min(cfg.nc, n - jc);
+        for (size_t pc = 0; pc < k; pc += cfg.kc) {
+            size_t kcb = std::min(cfg.kc, k - pc);
+            // the first block of K initializes C, the others add to it
+            bool accumulate = pc != 0, last = pc + kcb == k;
+            packB(B.ptr + pc * B.rowStride + jc * B.colStride, B.rowStride,
+                  B.colStride, kcb, ncb, cfg.nr, ws.b);
+            for (size_t ic = 0; ic < m; ic += cfg.mc) {
+                size_t mcb = std::min(cfg.mc, m - ic);
+                packA(A.ptr + ic * A.rowStride + pc * A.colStride,
+                      A.rowStride, A.colStride, mcb, kcb, cfg.mr,
+                      ws.a);
+                for (size_t jr = 0; jr < ncb; jr += cfg.nr) {
+                    size_t nrb = std::min(cfg.nr, ncb - jr);
+                    for (size_t ir = 0; ir < mcb; ir += cfg.mr) {
+                        size_t mrb = std::min(cfg.mr, mcb - ir);
+                        const T *a = ws.a + ir * kcb;
+                        const T *b = ws.b + jr * kcb;
+                        T *c = C + (ic + ir) * ldc + jc + jr;
+                        GemmEpilogue<T> tileEp{};
+                        if (ep && last)
+                            tileEp = {ep->bias ? ep->bias + jc + jr : nullptr,
+                                      ep->lo, ep->hi};
+                        const auto *epTile = ep && last ? &tileEp : nullptr;
+                        if (mrb == cfg.mr && nrb == cfg.nr) {
+                            cfg.kernel(kcb, a, b, c, ldc, accumulate, epTile);
+                            continue;
+                        }
+                        // partial tile at the border of C
+                        T *tile = ws.tile;
+                        cfg.kernel(kcb, a, b, tile, cfg.nr, false, nullptr);
+                        for (size_t i = 0; i < mrb; ++i)
+                            for (size_t j = 0; j < nrb; ++j) {
+                                T v = tile[i * cfg.nr + j];
+                                if (accumulate)
+                                    v = c[i * ldc + j] + v;
+                                c[i * ldc + j] =
+                                    epTile ? applyEpilogue(*epTile, v, j) : v;
+                            }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Below this many multiply-adds per thread, threading costs more than it saves
+constexpr size_t minWorkPerThread = 1 << 15;
+
+template <typename T>
+GemmPartition partition(const GemmConfig<T> &cfg, size_t batch, size_t m,
+                        size_t n, size_t k, int nThreads) {
+    auto ceilDiv = [](size_t a, size_t b) { return (a + b - 1) / b; };
+    size_t work = batch * m * n * std::max<size_t>(k, 1);
+    size_t maxThreads = std::max<size_t>(
+        1, std::min<size_t>(nThreads, work / minWorkPerThread));
+    size_t mTiles = ceilDiv(m, cfg.mr), nTiles = ceilDiv(n, cfg.nr);
+
+    GemmPartition best{1, 1, 1};
+    double bestCost = -1;
+    for (size_t tb = std::min(batch, maxThreads); tb >= 1; --tb)
+        for (size_t tm = 1; tm <= std::min(mTiles, maxThreads / tb); ++tm)
+            for (size_t tn = 1;
+                 tn <= std::min(nTiles, maxThreads / (tb * tm)); ++tn) {
+                // the largest block a single thread gets
+                double b = ceilDiv(batch, tb);
+                double rows = ceilDiv(mTiles, tm) * cfg.mr;
+                double cols = ceilDiv(nTiles, tn) * cfg.nr;
+                double cost = b * (rows * cols * k + 4 * k * (rows + cols));
+                if (bestCost < 0 || cost < bestCost) {
+                    bestCost = cost;
+                    best = {int(tb), int(tm), int(tn)};
+                }
+            }
+    return best;
+}
+
+// Splits [0, total) into `parts` nearly equal ranges aligned to `align` and
+// returns the idx-th one
+std::pair<size_t, size_t> splitRange(size_t total, int parts, int idx,
+                                     size_t align) {
+    size_t units = (total + align - 1) / align;
+    size_t begin = units * idx / parts * align;
+    size_t end = units * (idx + 1) / parts * align;
+    return {std::min(begin, total), std::min(end, total)};
+}
+
+} // namespace
+
+template <typename T>
+void gemm(size_t m, size_t n, size_t k, MatrixRef<T> A, MatrixRef<T> B, T *C,
+          size_t ldc) {
+    const auto cfg = getGemmConfig<T>();
+    GemmWorkspace<T> ws(cfg, m, n, k);
+    gemmBlocked<T>(cfg, ws, m, n, k, A, B, C, ldc, nullptr);
+}
+
+template <typename T>
+GemmPartition partitionGemm(size_t batch, size_t m, size_t n, size_t k,
+                            int nThreads) {
+    return partition(getGemmConfig<T>(), batch, m, n, k, nThreads);
+}
+
+template <typename T>
+void batchedGemm(size_t batch, size_t m, size_t n, size_t k, MatrixRef<T> A,
+                 const size_t *offsetsA, MatrixRef<T> B,
+                 const size_t *offsetsB, T *C, GemmBlocking blocking,
+                 const GemmEpilogue<T> *epilogue) {
+    auto cfg = getGemmConfig<T>();
+    if (blocking.mc)
+        cfg.mc = GemmWorkspace<T>::roundUp(blocking.mc, cfg.mr);
+    if (blocking.nc)
+        cfg.nc = GemmWorkspace<T>::roundUp(blocking.nc, cfg.nr);
+    if (blocking.kc)
+        cfg.kc = blocking.kc;
+    const auto part = partition(cfg, batch, m, n, k, get_num_threads());
+    const int nThreads = part.threads();
+    parallel_for(nThreads, 1, [&](size_t begin, size_t end) {
+        for (size_t tid = begin; tid < end; ++tid) {
+            auto [b0, b1] = splitRange(batch, part.batch,
+                                       tid / (part.m * part.n), 1);
+            auto [i0, i1] =
+                splitRange(m, part.m, tid / part.n % part.m, cfg.mr);
+            auto [j0, j1] = splitRange(n, part.n, tid % part.n, cfg.nr);
+            if (b0 == b1 || i0 == i1 || j0 == j1)
+                continue;
+            GemmWorkspace<T> ws(cfg, i1 - i0, j1 - j0, k);
+            GemmEpilogue<T> ep{};
+            if (epilogue)
+                ep = {epilogue->bias ? epilogue->bias + j0 : nullptr,
+                      epilogue->lo, epilogue->hi};
+            for (size_t b = b0; b < b1; ++b) {
+                MatrixRef<T> a{A.ptr + offsetsA[b] + i0 * A.rowStride,
+                               A.rowStride, A.colStride};
+                MatrixRef<T> bb{B.ptr + offsetsB[b] + j0 * B.colStride,
+                                B.rowStride, B.colStride};
+                gemmBlocked(cfg, ws, i1 - i0, j1 - j0, k, a, bb,
+                            C + b * m * n + i0 * n + j0, n,
+                            epilogue ? &ep : nullptr);
+            }
+        }
+    });
+}
+
+#define INSTANTIATE_GEMM(T)                                                    \
+    template void gemm<T>(size_t, size_t, size_t, MatrixRef<T>, MatrixRef<T>, \
+                          T *, size_t);                                        \
+    template GemmPartition partitionGemm<T>(size_t, size_t, size_t, size_t,    \
+                                            int);                              \
+    template void batchedGemm<T>(size_t, size_t, size_t, size_t, MatrixRef<T>, \
+                                 const size_t *, MatrixRef<T>, const size_t *, \
+                                 T *, GemmBlocking, const GemmEpilogue<T> *);
+
+INSTANTIATE_GEMM(float)
+INSTANTIATE_GEMM(double)
+INSTANTIATE_GEMM(int8_t)
+INSTANTIATE_GEMM(int32_t)
+INSTANTIATE_GEMM(int64_t)
+INSTANTIATE_GEMM(uint32_t)
+#undef INSTANTIATE_GEMM
+
+} // namespace infini
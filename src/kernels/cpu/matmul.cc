@@ -0,0 +1,182 @@
+#include "operators/matmul.h"
+#include "core/kernel.h"
+#include "kernels/cpu/gemm.h"
+#include "kernels/cpu/simd.h"
+#include <limits>
+
+namespace infini {
+
+// Offsets of the matrices of a tensor with `dims` when its leading dims are
+// broadcast to `outBatch`, one for every matrix of the output.
+static vector<size_t> batchOffsets(const Shape &dims, const Shape &outBatch,
+                                   size_t matSize) {
+    size_t rank = outBatch.size(), batchRank = dims.size() - 2;
+    vector<size_t> strides(rank, 0);
+    size_t stride = matSize;
+    for (size_t i = 0; i < batchRank; ++i) {
+        auto d = dims[batchRank - 1 - i];
+        if (d != 1)
+            strides[rank - 1 - i] = stride;
+        stride *= d;
+    }
+    size_t batch = 1;
+    for (auto d : outBatch)
+        batch *= d;
+    vector<size_t> offsets(batch);
+    for (size_t b = 0; b < batch; ++b) {
+        size_t rest = b, offset = 0;
+        for (size_t i = rank; i-- > 0;) {
+            offset += rest % outBatch[i] * strides[i];
+            rest /= outBatch[i];
+        }
+        offsets[b] = offset;
+    }
+    return offsets;
+}
+
+// The bound an activation clamps to, or the widest value of T without one
+template <typename T> static T actBound(optional<float> bound, bool upper) {
+    if (bound)
+        return T(*bound);
+    if constexpr (std::numeric_limits<T>::has_infinity)
+        return upper ? std::numeric_limits<T>::infinity()
+                     : -std::numeric_limits<T>::infinity();
+    else
+        return upper ? std::numeric_limits<T>::max()
+                     : std::numeric_limits<T>::lowest();
+}
+
+/**
+ * @brief MatMul on the blocked GEMM. Float16 and BFloat16 operands are
+ * converted to Float32 first and the product is rounded back once. The bias
+ * and activation of a fused MatMul are applied by the GEMM as it stores C.
+ */
+template <typename E> class BlockedMatmul : public CpuKernelWithoutConfig {
+    using T = std::conditional_t<is_half_v<E>, float, E>;
+
+    struct Params {
+        size_t m, n, k;
+        MatrixRef<T> A, B;
+        vector<size_t> offsetsA, offsetsB;
+        T *C;
+        GemmBlocking blocking;
+        bool hasEpilogue;
+        GemmEpilogue<T> epilogue;
+        // the Float16/BFloat16 tensors, whose Float32 copies A, B, C and the
+        // bias view
+        const E *halfA, *halfB, *halfBias;
+        E *halfC;
+        size_t sizeA, sizeB, sizeC;
+    };
+
+    GemmBlocking blocking;
+
+    Params prepare(const Operator &_op) const {
+        auto op = as<MatmulObj>(_op);
+        auto A = op->getInputs(0), B = op->getInputs(1), C = op->getOutput();
+        size_t m = op->getM(), n = op->getN(), k = op->getK();
+
+        // transposed operands only swap the strides of their view
+        T *ptrA = nullptr, *ptrB = nullptr, *ptrC = nullptr;
+        if constexpr (!is_half_v<E>) {
+            ptrA = A->getRawDataPtr<T *>();
+            ptrB = B->getRawDataPtr<T *>();
+            ptrC = C->getRawDataPtr<T *>();
+        }
+        MatrixRef<T> viewA =
+            op->getTransA() ? MatrixRef<T>{ptrA, 1, ptrdiff_t(m)}
+                            : MatrixRef<T>{ptrA, ptrdiff_t(k), 1};
+        MatrixRef<T> viewB =
+            op->getTransB() ? MatrixRef<T>{ptrB, 1, ptrdiff_t(k)}
+                            : MatrixRef<T>{ptrB, ptrdiff_t(n), 1};
+
+        auto bias = op->getBias();
+        const bool hasEpilogue = bias || op->getAct() != ActType::None;
+        GemmEpilogue<T> epilogue{nullptr, actBound<T>(op->getActMin(), false),
+                                 actBound<T>(op->getActMax(), true)};
+        if constexpr (!is_half_v<E>)
+            if (bias)
+                epilogue.bias = bias->getRawDataPtr<T *>();
+
+        const auto &outDims = C->getDims();
+        Shape outBatch(outDims.begin(), outDims.end() - 2);
+        return {m,
+                n,
+                k,
+                viewA,
+                viewB,
+                batchOffsets(A->getDims(), outBatch, m * k),
+                batchOffsets(B->getDims(), outBatch, k * n),
+                ptrC,
+                blocking,
+                hasEpilogue,
+                epilogue,
+                A->getRawDataPtr<E *>(),
+                B->getRawDataPtr<E *>(),
+                bias ? bias->getRawDataPtr<E *>() : nullptr,
+                C->getRawDataPtr<E *>(),
+                A->size(),
+                B->size(),
+                C->size()};
+    }
+
+    static void gemm(const Params &p, const T *a, const T *b, T *c,
+                     const GemmEpilogue<T> &epilogue) {
+        batchedGemm<T>(p.offsetsA.size(), p.m, p.n, p.k,
+                       {a, p.A.rowStride, p.A.colStride}, p.offsetsA.data(),
+                       {b, p.B.rowStride, p.B.colStride}, p.offsetsB.data(), c,
+                       p.blocking, p.hasEpilogue ? &epilogue : nullptr);
+    }
+
+    static void run(const Params &p) {
+        if constexpr (!is_half_v<E>)
+            gemm(p, p.A.ptr, p.B.ptr, p.C, p.epilogue);
+        else {
+            auto [widen, narrow] =
+                half_conversions<E>(get_simd_kernels(get_cpu_isa()));
+            vector<float> a(p.sizeA), b(p.sizeB), c(p.sizeC), bias;
+            widen(p.sizeA, bits(p.halfA), a.data());
+            widen(p.sizeB, bits(p.halfB), b.data());
+            auto epilogue = p.epilogue;
+            if (p.halfBias) {
+                bias.resize(p.n);
+                widen(p.n, bits(p.halfBias), bias.data());
+                epilogue.bias = bias.data();
+            }
+            gemm(p, a.data(), b.data(), c.data(), epilogue);
+            narrow(p.sizeC, c.data(), bits(p.halfC));
+        }
+    }
+
+    void compute(const Operator &_op,
+                 const RuntimeObj *context) const override {
+        run(prepare(_op));
+    }
+
+    KernelStep compile(const Operator &_op,
+                       const RuntimeObj *context) const override {
+        return KernelStep::make<Params, run>(prepare(_op));
+    }
+
+  public:
+    explicit BlockedMatmul(GemmBlocking blocking = {}) : blocking(blocking) {}
+};
+
+// Variants with a shallower and a deeper K block, for the tuner to pick from
+template <typename E> struct BlockedMatmulK128 : BlockedMatmul<E> {
+    BlockedMatmulK128() : BlockedMatmul<E>({0, 0, 128}) {}
+};
+template <typename E> struct BlockedMatmulK512 : BlockedMatmul<E> {
+    BlockedMatmulK512() : BlockedMatmul<E>({0, 0, 512}) {}
+};
+
+REGISTER_KERNEL_FOR_TYPES(Device::CPU, OpType::MatMul, CpuArithmeticTypes,
+                          BlockedMatmul, "MatmulBlocked_CPU");
+REGISTER_KERNEL_FOR_TYPES_WITH_PRIORITY(Device::CPU, OpType::MatMul,
+                                        CpuFloatTypes, BlockedMatmulK128,
+                                        "MatmulBlockedK128_CPU", -1);
+REGISTER_KERNEL_FOR_TYPES_WITH_PRIORITY(Device::CPU, OpType::MatMul,
+                                        CpuFloatTypes, BlockedMatmulK512,
+                                        "MatmulBlockedK512_CPU", -1);
+
+} // namespace infini
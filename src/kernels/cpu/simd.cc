@@ -0,0 +1,315 @@
+#include "kernels/cpu/simd.h"
+#include "utils/data_convert.h"
+#include <cstdint>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace infini {
+
+namespace {
+
+// GCC vector extensions: the loops below are written once and get compiled
+// for SSE, AVX2 and AVX-512 once inlined into the target specific functions.
+// Vectors are only passed by reference to keep the ABI of the helpers
+// independent of the target.
+typedef float f32x4 __attribute__((vector_size(16)));
+typedef float f32x8 __attribute__((vector_size(32)));
+typedef float f32x16 __attribute__((vector_size(64)));
+
+// Integer vectors with the lanes of a float vector, for bit manipulations
+template <typename V> struct LaneTypes;
+template <> struct LaneTypes<float> {
+    using U32 = uint32_t;
+    using U16 = uint16_t;
+};
+#define DEFINE_LANE_TYPES(V, N)                                                \
+    template <> struct LaneTypes<V> {                                          \
+        typedef uint32_t U32 __attribute__((vector_size(4 * N)));              \
+        typedef uint16_t U16 __attribute__((vector_size(2 * N)));              \
+    };
+DEFINE_LANE_TYPES(f32x4, 4)
+DEFINE_LANE_TYPES(f32x8, 8)
+DEFINE_LANE_TYPES(f32x16, 16)
+#undef DEFINE_LANE_TYPES
+
+#define SIMD_INLINE inline __attribute__((always_inline))
+
+template <typename V> SIMD_INLINE void load(V &v, const float *p) {
+    std::memcpy(&v, p, sizeof(V));
+}
+template <typename V> SIMD_INLINE void store(float *p, const V &v) {
+    std::memcpy(p, &v, sizeof(V));
+}
+
+struct AddOp {
+    template <typename V> SIMD_INLINE void operator()(V &x, const V &y) const {
+        x = x + y;
+    }
+};
+struct SubOp {
+    template <typename V> SIMD_INLINE void operator()(V &x, const V &y) const {
+        x = x - y;
+    }
+};
+struct MulOp {
+    template <typename V> SIMD_INLINE void operator()(V &x, const V &y) const {
+        x = x * y;
+    }
+};
+struct DivOp {
+    template <typename V> SIMD_INLINE void operator()(V &x, const V &y) const {
+        x = x / y;
+    }
+};
+
+template <typename V, typename F>
+SIMD_INLINE void binaryRow(size_t n, const float *a, size_t strideA,
+                           const float *b, size_t strideB, float *c, F f) {
+    constexpr size_t W = sizeof(V) / sizeof(float);
+    size_t i = 0;
+    V va, vb;
+    if (strideA && strideB) {
+        for (; i + W <= n; i += W) {
+            load(va, a + i), load(vb, b + i);
+            f(va, vb);
+            store(c + i, va);
+        }
+    } else if (strideB) {
+        va = V{} + a[0];
+        for (; i + W <= n; i += W) {
+            V x = va;
+            load(vb, b + i);
+            f(x, vb);
+            store(c + i, x);
+        }
+    } else if (strideA) {
+        vb = V{} + b[0];
+        for (; i + W <= n; i += W) {
+            load(va, a + i);
+            f(va, vb);
+            store(c + i, va);
+        }
+    }
+    for (; i < n; ++i) {
+        float x = a[i * strideA], y = b[i * strideB];
+        f(x, y);
+        c[i] = x;
+    }
+}
+
+template <typename V>
+SIMD_INLINE void clipRow(size_t n, const float *x, float *y, float lo,
+                         float hi) {
+    constexpr size_t W = sizeof(V) / sizeof(float);
+    // NaN compares false both ways and goes through unchanged
+    size_t i = 0;
+    V v, vlo = V{} + lo, vhi = V{} + hi;
+    for (; i + W <= n; i += W) {
+        load(v, x + i);
+        v = v < vlo ? vlo : v;
+        v = v > vhi ? vhi : v;
+        store(y + i, v);
+    }
+    for (; i < n; ++i)
+        y[i] = x[i] < lo ? lo : x[i] > hi ? hi : x[i];
+}
+
+template <typename V>
+SIMD_INLINE void reluRow(size_t n, const float *x, float *y) {
+    constexpr size_t W = sizeof(V) / sizeof(float);
+    size_t i = 0;
+    V v, zero = V{};
+    for (; i + W <= n; i += W) {
+        load(v, x + i);
+        v = v > zero ? v : zero;
+        store(y + i, v);
+    }
+    for (; i < n; ++i)
+        y[i] = x[i] > 0 ? x[i] : 0;
+}
+
+template <typename V>
+SIMD_INLINE void toBFloat16Row(size_t n, const float *x, uint16_t *y) {
+    using U32 = typename LaneTypes<V>::U32;
+    using U16 = typename LaneTypes<V>::U16;
+    constexpr size_t W = sizeof(V) / sizeof(float);
+    size_t i = 0;
+    if constexpr (W > 1)
+        for (; i + W <= n; i += W) {
+            U32 u;
+            std::memcpy(&u, x + i, sizeof(u));
+            U32 nan = (u >> 16) | 0x40;
+            U32 r = (u + 0x7fff + ((u >> 16) & 1)) >> 16;
+            r = (u & 0x7fffffff) > 0x7f800000 ? nan : r;
+            U16 h = __builtin_convertvector(r, U16);
+            std::memcpy(y + i, &h, sizeof(h));
+        }
+    for (; i < n; ++i)
+        y[i] = float_to_bf16(x[i]);
+}
+
+template <typename V>
+SIMD_INLINE void fromBFloat16Row(size_t n, const uint16_t *x, float *y) {
+    using U32 = typename LaneTypes<V>::U32;
+    using U16 = typename LaneTypes<V>::U16;
+    constexpr size_t W = sizeof(V) / sizeof(float);
+    size_t i = 0;
+    if constexpr (W > 1)
+        for (; i + W <= n; i += W) {
+            U16 h;
+            std::memcpy(&h, x + i, sizeof(h));
+            U32 u = __builtin_convertvector(h, U32) << 16;
+            std::memcpy(y + i, &u, sizeof(u));
+        }
+    for (; i < n; ++i)
+        y[i] = bf16_to_float(x[i]);
+}
+
+// Float16 needs the F16C/AVX-512 conversion instructions, without them the
+// rows are converted one element at a time.
+void toFloat16Scalar(size_t n, const float *x, uint16_t *y) {
+    for (size_t i = 0; i < n; ++i)
+        y[i] = float_to_fp16(x[i]);
+}
+void fromFloat16Scalar(size_t n, const uint16_t *x, float *y) {
+    for (size_t i = 0; i < n; ++i)
+        y[i] = fp16_to_float(x[i]);
+}
+#define toFloat16SSE toFloat16Scalar
+#define fromFloat16SSE fromFloat16Scalar
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2,f16c"))) void
+toFloat16AVX2(size_t n, const float *x, uint16_t *y) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm_storeu_si128(
+            (__m128i *)(y + i),
+            _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT));
+    toFloat16Scalar(n - i, x + i, y + i);
+}
+__attribute__((target("avx2,f16c"))) void
+fromFloat16AVX2(size_t n, const uint16_t *x, float *y) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(y + i, _mm256_cvtph_ps(
+                                    _mm_loadu_si128((const __m128i *)(x + i))));
+    fromFloat16Scalar(n - i, x + i, y + i);
+}
+// The masked forms avoid GCC's uninitialized warnings on the unmasked ones
+__attribute__((target("avx512f"))) void
+toFloat16AVX512(size_t n, const float *x, uint16_t *y) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm256_storeu_si256(
+            (__m256i *)(y + i),
+            _mm512_maskz_cvtps_ph(0xffff, _mm512_loadu_ps(x + i),
+                                  _MM_FROUND_TO_NEAREST_INT));
+    toFloat16Scalar(n - i, x + i, y + i);
+}
+__attribute__((target("avx512f"))) void
+fromFloat16AVX512(size_t n, const uint16_t *x, float *y) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(y + i,
+                         _mm512_maskz_cvtph_ps(
+                             0xffff, _mm256_loadu_si256((const __m256i *)(x + i))));
+    fromFloat16Scalar(n - i, x + i, y + i);
+}
+#endif
+
+#define DEFINE_SIMD_KERNELS(ISA, TARGET, VEC)                                  \
+    TARGET void add##ISA(size_t n, const float *a, size_t sa, const float *b,  \
+                         size_t sb, float *c) {                                \
+        binaryRow<VEC>(n, a, sa, b, sb, c, AddOp{});                           \
+    }                                                                          \
+    TARGET void sub##ISA(size_t n, const float *a, size_t sa, const float *b,  \
+                         size_t sb, float *c) {                                \
+        binaryRow<VEC>(n, a, sa, b, sb, c, SubOp{});                           \
+    }                                                                          \
+    TARGET void mul##ISA(size_t n, const float *a, size_t sa, const float *b,  \
+                         size_t sb, float *c) {                                \
+        binaryRow<VEC>(n, a, sa, b, sb, c, MulOp{});                           \
+    }                                                                          \
+    TARGET void div##ISA(size_t n, const float *a, size_t sa, const float *b,  \
+                         size_t sb, float *c) {                                \
+        binaryRow<VEC>(n, a, sa, b, sb, c, DivOp{});                           \
+    }                                                                          \
+    TARGET void relu##ISA(size_t n, const float *x, float *y) {                \
+        reluRow<VEC>(n, x, y);                                                 \
+    }                                                                          \
+    TARGET void clip##ISA(size_t n, const float *x, float *y, float lo,        \
+                          float hi) {                                          \
+        clipRow<VEC>(n, x, y, lo, hi);                                         \
+    }                                                                          \
+    TARGET void toBFloat16##ISA(size_t n, const float *x, uint16_t *y) {       \
+        toBFloat16Row<VEC>(n, x, y);                                           \
+    }                                                                          \
+    TARGET void fromBFloat16##ISA(size_t n, const uint16_t *x, float *y) {     \
+        fromBFloat16Row<VEC>(n, x, y);                                         \
+    }                                                                          \
+    const SimdKernels simd##ISA{add##ISA,          sub##ISA,                   \
+                                mul##ISA,          div##ISA,                   \
+                                relu##ISA,         clip##ISA,                  \
+                                toFloat16##ISA,    fromFloat16##ISA,           \
+                                toBFloat16##ISA,   fromBFloat16##ISA};
+
+DEFINE_SIMD_KERNELS(Scalar, , float)
+#if defined(__x86_64__) || defined(__i386__)
+DEFINE_SIMD_KERNELS(SSE, __attribute__((target("sse4.1"))), f32x4)
+DEFINE_SIMD_KERNELS(AVX2, __attribute__((target("avx2"))), f32x8)
+DEFINE_SIMD_KERNELS(AVX512, __attribute__((target("avx512f"))), f32x16)
+#endif
+
+#undef DEFINE_SIMD_KERNELS
+#undef toFloat16SSE
+#undef fromFloat16SSE
+
+} // namespace
+
+const SimdKernels &get_simd_kernels(CpuIsa isa) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (isa) {
+    case CpuIsa::AVX512:
+        return simdAVX512;
+    case CpuIsa::AVX2:
+        return simdAVX2;
+    case CpuIsa::SSE:
+        return simdSSE;
+    default:
+        break;
+    }
+#endif
+    return simdScalar;
+}
+
+void stream_copy(void *dst, const void *src, size_t bytes) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (get_cpu_isa() >= CpuIsa::SSE && bytes >= 256) {
+        auto d = static_cast<char *>(dst);
+        auto s = static_cast<const char *>(src);
+        // the streaming stores need 16 byte aligned destinations
+        size_t head = -reinterpret_cast<uintptr_t>(d) & 15;
+        std::memcpy(d, s, head);
+        size_t i = head;
+        for (; i + 64 <= bytes; i += 64) {
+            __m128i v0 = _mm_loadu_si128((const __m128i *)(s + i));
+            __m128i v1 = _mm_loadu_si128((const __m128i *)(s + i + 16));
+            __m128i v2 = _mm_loadu_si128((const __m128i *)(s + i + 32));
+            __m128i v3 = _mm_loadu_si128((const __m128i *)(s + i + 48));
+            _mm_stream_si128((__m128i *)(d + i), v0);
+            _mm_stream_si128((__m128i *)(d + i + 16), v1);
+            _mm_stream_si128((__m128i *)(d + i + 32), v2);
+            _mm_stream_si128((__m128i *)(d + i + 48), v3);
+        }
+        std::memcpy(d + i, s + i, bytes - i);
+        _mm_sfence();
+        return;
+    }
+#endif
+    std::memcpy(dst, src, bytes);
+}
+
+} // namespace infini
@@ -1,60 +1,304 @@
 #include "operators/transpose.h"
 #include "core/kernel.h"
+#include "utils/cpu_features.h"
+#include "utils/parallel.h"
+#include <algorithm>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace infini {
 
-inline Shape idx2Pos(const Shape &shape, size_t idx) {
-    Shape pos = Shape(shape.size(), 0);
-    auto rest = idx, curDimId = shape.size() - 1;
-    while (rest > 0) {
-        pos[curDimId] = rest % shape[curDimId];
-        rest /= shape[curDimId];
-        curDimId--;
+/**
+ * @brief Drops the dims of extent 1 and merges the input dims that stay
+ * adjacent and in order under the permutation, e.g. transposing [2,3,4,5]
+ * with {2,3,0,1} becomes transposing [6,20] with {1,0}. An identity
+ * permutation reduces to a single dim.
+ */
+static void coalesceTranspose(const Shape &inDims, const vector<int> &perm,
+                              vector<size_t> &dims, vector<int> &newPerm) {
+    // runs of input dims that are consecutive in the output, in output order
+    vector<pair<int, int>> runs; // [first, last] input dim
+    auto follows = [&](int last, int d) {
+        if (d <= last)
+            return false;
+        for (int i = last + 1; i < d; ++i)
+            if (inDims[i] != 1)
+                return false;
+        return true;
+    };
+    for (int d : perm) {
+        if (inDims[d] == 1)
+            continue;
+        if (!runs.empty() && follows(runs.back().second, d))
+            runs.back().second = d;
+        else
+            runs.emplace_back(d, d);
     }
-    return pos;
+    vector<int> order(runs.size());
+    for (size_t i = 0; i < runs.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return runs[a].first < runs[b].first;
+    });
+    dims.clear();
+    newPerm.assign(runs.size(), 0);
+    for (size_t i = 0; i < order.size(); ++i) {
+        auto [first, last] = runs[order[i]];
+        size_t extent = 1;
+        for (int d = first; d <= last; ++d)
+            extent *= inDims[d];
+        dims.emplace_back(extent);
+        newPerm[order[i]] = i;
+    }
+    if (dims.empty()) {
+        dims.emplace_back(1);
+        newPerm.emplace_back(0);
+    }
+}
+
+// Square tiles keep both the rows read and the rows written in cache, the
+// default size
+constexpr size_t transposeTile = 32;
+
+// dst[j * ldd + i] = src[i * lds + j] for i < rows and j < cols
+template <typename T>
+void transposeBlock(size_t rows, size_t cols, const T *src, size_t lds,
+                    T *dst, size_t ldd) {
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            dst[j * ldd + i] = src[i * lds + j];
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 8 x 8 block of 4 byte elements transposed in AVX registers
+__attribute__((target("avx2"))) static void
+transpose8x8(const uint32_t *src, size_t lds, uint32_t *dst, size_t ldd) {
+    __m256 r[8], t[8];
+    for (int k = 0; k < 8; ++k)
+        r[k] = _mm256_loadu_ps(reinterpret_cast<const float *>(src + k * lds));
+    for (int k = 0; k < 8; k += 2) {
+        t[k] = _mm256_unpacklo_ps(r[k], r[k + 1]);
+        t[k + 1] = _mm256_unpackhi_ps(r[k], r[k + 1]);
+    }
+    for (int k = 0; k < 8; k += 4) {
+        r[k] = _mm256_shuffle_ps(t[k], t[k + 2], _MM_SHUFFLE(1, 0, 1, 0));
+        r[k + 1] = _mm256_shuffle_ps(t[k], t[k + 2], _MM_SHUFFLE(3, 2, 3, 2));
+        r[k + 2] =
+            _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(1, 0, 1, 0));
+        r[k + 3] =
+            _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(3, 2, 3, 2));
+    }
+    for (int k = 0; k < 4; ++k) {
+        t[k] = _mm256_permute2f128_ps(r[k], r[k + 4], 0x20);
+        t[k + 4] = _mm256_permute2f128_ps(r[k], r[k + 4], 0x31);
+    }
+    for (int k = 0; k < 8; ++k)
+        _mm256_storeu_ps(reinterpret_cast<float *>(dst + k * ldd), t[k]);
 }
 
-class NaiveTranspose : public CpuKernelWithoutConfig {
-    template <typename T>
-    void doCompute(const Operator &_op, const RuntimeObj *context) const {
+// 4 x 4 block of 4 byte elements transposed in SSE registers
+__attribute__((target("sse4.1"))) static void
+transpose4x4(const uint32_t *src, size_t lds, uint32_t *dst, size_t ldd) {
+    auto s = reinterpret_cast<const float *>(src);
+    auto d = reinterpret_cast<float *>(dst);
+    __m128 r0 = _mm_loadu_ps(s), r1 = _mm_loadu_ps(s + lds),
+           r2 = _mm_loadu_ps(s + 2 * lds), r3 = _mm_loadu_ps(s + 3 * lds);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(d, r0);
+    _mm_storeu_ps(d + ldd, r1);
+    _mm_storeu_ps(d + 2 * ldd, r2);
+    _mm_storeu_ps(d + 3 * ldd, r3);
+}
+
+template <>
+void transposeBlock<uint32_t>(size_t rows, size_t cols, const uint32_t *src,
+                              size_t lds, uint32_t *dst, size_t ldd) {
+    auto isa = get_cpu_isa();
+    size_t step = isa >= CpuIsa::AVX2 ? 8 : isa >= CpuIsa::SSE ? 4 : 1;
+    auto kernel = isa >= CpuIsa::AVX2 ? transpose8x8 : transpose4x4;
+    size_t i = 0, j = 0;
+    if (step > 1) {
+        for (i = 0; i + step <= rows; i += step)
+            for (j = 0; j + step <= cols; j += step)
+                kernel(src + i * lds + j, lds, dst + j * ldd + i, ldd);
+        // right border of the full rows
+        for (size_t i0 = 0; i0 < i; ++i0)
+            for (size_t j0 = j; j0 < cols; ++j0)
+                dst[j0 * ldd + i0] = src[i0 * lds + j0];
+    }
+    // bottom border
+    for (; i < rows; ++i)
+        for (size_t j0 = 0; j0 < cols; ++j0)
+            dst[j0 * ldd + i] = src[i * lds + j0];
+}
+#endif
+
+// The unsigned integer of N bytes
+template <size_t N> struct UIntOfSize;
+template <> struct UIntOfSize<1> { using t = uint8_t; };
+template <> struct UIntOfSize<2> { using t = uint16_t; };
+template <> struct UIntOfSize<4> { using t = uint32_t; };
+template <> struct UIntOfSize<8> { using t = uint64_t; };
+
+template <typename E> class NaiveTranspose : public CpuKernelWithoutConfig {
+    // The elements are only moved, so they are handled as unsigned integers
+    // of the same size.
+    using T = typename UIntOfSize<sizeof(E)>::t;
+
+    struct Params {
+        const T *in;
+        T *out;
+        size_t size;
+        // The output is a view of the input, nothing moves
+        bool alias;
+        // No outer dims: a copy of `size` elements. Otherwise the outer loops
+        // run over the output dims in output order but the last one and, for
+        // a 2D transpose, the last input dim.
+        bool copy, keepLast;
+        vector<size_t> outerDims, outerInStride, outerOutStride;
+        size_t nOuter;
+        // the kept rows, or the 2D transposed plane and its tiles
+        size_t rows, cols, lds, ldd, tile;
+
+        // the offsets of the outer position `idx` in the input and output
+        void locate(size_t idx, size_t &inOffset, size_t &outOffset) const {
+            inOffset = outOffset = 0;
+            for (size_t k = outerDims.size(); k-- > 0;) {
+                size_t i = idx % outerDims[k];
+                idx /= outerDims[k];
+                inOffset += i * outerInStride[k];
+                outOffset += i * outerOutStride[k];
+            }
+        }
+    };
+
+    size_t tile;
+
+    Params prepare(const Operator &_op) const {
         auto op = as<TransposeObj>(_op);
-        auto inputs = op->getInputs(), outputs = op->getOutputs();
-        const auto &inDim = inputs[0]->getDims();
-        const auto &perm = op->getPermute();
-
-        size_t inSize = inputs[0]->size();
-        auto inPtr = inputs[0]->getRawDataPtr<T *>(),
-             outPtr = outputs[0]->getRawDataPtr<T *>();
-        // #pragma omp parallel for
-        for (size_t inIdx = 0; inIdx < inSize; ++inIdx) {
-            auto posInput = idx2Pos(inDim, inIdx);
-            int outIdx = 0;
-            for (size_t j = 0, jEnd = perm.size(); j < jEnd; ++j) {
-                outIdx = outIdx * inDim[perm[j]] + posInput[perm[j]];
+        auto input = op->getInputs(0), output = op->getOutput();
+        Params p{};
+        p.in = input->getRawDataPtr<T *>();
+        p.out = output->getRawDataPtr<T *>();
+        p.size = input->size();
+        p.alias = output->isView();
+        if (p.alias)
+            return p;
+        IT_ASSERT(input->isContiguous());
+
+        vector<size_t> dims;
+        vector<int> perm;
+        coalesceTranspose(input->getDims(), op->getPermute(), dims, perm);
+        const size_t rank = dims.size();
+        p.copy = rank == 1;
+        if (p.copy)
+            return p;
+
+        // strides of the input dims in the input and in the output
+        vector<size_t> inStride(rank), outStride(rank);
+        for (size_t d = rank, s = 1; d-- > 0; s *= dims[d])
+            inStride[d] = s;
+        for (size_t k = rank, s = 1; k-- > 0; s *= dims[perm[k]])
+            outStride[perm[k]] = s;
+
+        const int q = perm[rank - 1];
+        p.keepLast = q == int(rank) - 1;
+        p.nOuter = 1;
+        for (size_t k = 0; k < rank - 1; ++k)
+            if (p.keepLast || perm[k] != int(rank) - 1) {
+                p.outerDims.emplace_back(dims[perm[k]]);
+                p.outerInStride.emplace_back(inStride[perm[k]]);
+                p.outerOutStride.emplace_back(outStride[perm[k]]);
+                p.nOuter *= dims[perm[k]];
             }
-            outPtr[outIdx] = inPtr[inIdx];
+        p.rows = dims[q];
+        p.cols = dims[rank - 1];
+        p.lds = inStride[q];
+        p.ldd = outStride[rank - 1];
+        p.tile = tile;
+        return p;
+    }
+
+    static void run(const Params &p) {
+        if (p.alias)
+            return;
+        const T *inPtr = p.in;
+        T *outPtr = p.out;
+        if (p.copy) {
+            parallel_for(p.size, 1 << 16, [&](size_t begin, size_t end) {
+                std::memcpy(outPtr + begin, inPtr + begin,
+                            (end - begin) * sizeof(T));
+            });
+            return;
+        }
+
+        if (p.keepLast) {
+            // contiguous rows are kept, copy them
+            const size_t inner = p.cols;
+            parallel_for(p.nOuter, std::max<size_t>(1, (1 << 14) / inner),
+                         [&](size_t begin, size_t end) {
+                             for (size_t r = begin; r < end; ++r) {
+                                 size_t in, out;
+                                 p.locate(r, in, out);
+                                 std::memcpy(outPtr + out, inPtr + in,
+                                             inner * sizeof(T));
+                             }
+                         });
+            return;
         }
+
+        // 2D transpose of the plane, by bands of `tile` rows
+        const size_t rows = p.rows, cols = p.cols, lds = p.lds, ldd = p.ldd;
+        const size_t tile = p.tile;
+        const size_t bands = (rows + tile - 1) / tile;
+        parallel_for(
+            p.nOuter * bands, std::max<size_t>(1, (1 << 14) / (cols * tile)),
+            [&](size_t begin, size_t end) {
+                for (size_t u = begin; u < end; ++u) {
+                    size_t in, out;
+                    p.locate(u / bands, in, out);
+                    size_t i = u % bands * tile;
+                    size_t nRows = std::min(tile, rows - i);
+                    for (size_t j = 0; j < cols; j += tile)
+                        transposeBlock<T>(
+                            nRows, std::min(tile, cols - j),
+                            inPtr + in + i * lds + j, lds,
+                            outPtr + out + j * ldd + i, ldd);
+                }
+            });
     }
 
     void compute(const Operator &_op,
                  const RuntimeObj *context) const override {
-#define CASE(N)                                                                \
-    case N:                                                                    \
-        doCompute<DT<N>::t>(_op, context)
-
-        int dataTypeIdx = _op->getDType().getIndex();
-        switch (dataTypeIdx) {
-            CASE(1); // DataType::Float32
-            break;
-            CASE(12); // DataType::UInt32
-            break;
-        default:
-            IT_TODO_HALT();
-        }
+        run(prepare(_op));
+    }
+
+    KernelStep compile(const Operator &_op,
+                       const RuntimeObj *context) const override {
+        return KernelStep::make<Params, run>(prepare(_op));
     }
+
+  public:
+    explicit NaiveTranspose(size_t tile = transposeTile) : tile(tile) {}
+};
+
+// Variants with smaller and larger tiles, for the tuner to pick from
+template <typename E> struct NaiveTranspose16 : NaiveTranspose<E> {
+    NaiveTranspose16() : NaiveTranspose<E>(16) {}
+};
+template <typename E> struct NaiveTranspose64 : NaiveTranspose<E> {
+    NaiveTranspose64() : NaiveTranspose<E>(64) {}
 };
 
-REGISTER_KERNEL(Device::CPU, OpType::Transpose, NaiveTranspose,
-                "TransposeNaive_CPU");
+REGISTER_KERNEL_FOR_TYPES(Device::CPU, OpType::Transpose, CpuArithmeticTypes,
+                          NaiveTranspose, "TransposeNaive_CPU");
+REGISTER_KERNEL_FOR_TYPES_WITH_PRIORITY(Device::CPU, OpType::Transpose,
+                                        CpuArithmeticTypes, NaiveTranspose16,
+                                        "TransposeTile16_CPU", -1);
+REGISTER_KERNEL_FOR_TYPES_WITH_PRIORITY(Device::CPU, OpType::Transpose,
+                                        CpuArithmeticTypes, NaiveTranspose64,
+                                        "TransposeTile64_CPU", -1);
 
 } // namespace infini
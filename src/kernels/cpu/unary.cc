@@ -1,18 +1,23 @@
 #include "operators/unary.h"
 #include "core/kernel.h"
+#include "kernels/cpu/simd.h"
+#include "utils/parallel.h"
+#include <cmath>
+#include <limits>
 
 namespace infini
 {
+    template <typename T>
     class NativeUnary : public CpuKernelWithoutConfig
     {
-        template <typename T>
         static T reluCompute(T val)
         {
             return std::max(T(0), val);
         }
 
-        template <typename T>
-        void doCompute(const Operator &_op, const RuntimeObj *context) const
+    protected:
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
         {
             auto op = as<UnaryObj>(_op);
             T *inptr = op->getInputs(0)->getRawDataPtr<T *>();
@@ -26,7 +31,7 @@ namespace infini
             switch (op->getOpType().underlying())
             {
             case OpType::Relu:
-                _doCompute = reluCompute<T>;
+                _doCompute = reluCompute;
                 break;
             default:
                 IT_TODO_HALT();
@@ -37,69 +42,329 @@ namespace infini
                 outptr[offset] = _doCompute(inptr[offset]);
             }
         }
-
-        void compute(const Operator &_op,
-                     const RuntimeObj *context) const override
-        {
-#define CASE(N) \
-    case N:     \
-        doCompute<DT<N>::t>(_op, context)
-
-            int dataTypeIdx = _op->getDType().getIndex();
-            switch (dataTypeIdx)
-            {
-                CASE(1); // DataType::Float32
-                break;
-                CASE(12); // DataType::UInt32
-                break;
-            default:
-                IT_TODO_HALT();
-            }
-        }
     };
 
+    template <typename T>
     class Clip : public CpuKernelWithoutConfig
     {
-        template <typename T>
-        void doCompute(const Operator &_op, const RuntimeObj *context) const
+    protected:
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
         {
             auto op = as<ClipObj>(_op);
             T *inptr = op->getInputs(0)->getRawDataPtr<T *>();
             T *outptr = op->getOutput()->getRawDataPtr<T *>();
             auto minValue = op->getMin();
             auto maxValue = op->getMax();
+            T lo = T(minValue.value_or(0)), hi = T(maxValue.value_or(0));
 
             auto n = op->getOutput()->size();
             for (size_t offset = 0; offset < n; offset++)
             {
                 auto val = *inptr++;
-                *outptr++ = (minValue && val < *minValue)   ? *minValue
-                            : (maxValue && val > *maxValue) ? *maxValue
-                                                            : val;
+                *outptr++ = (minValue && val < lo)   ? lo
+                            : (maxValue && val > hi) ? hi
+                                                     : val;
             }
         }
+    };
+
+    // elements per thread below which threading does not pay off
+    constexpr size_t simdUnaryGrain = 1 << 16;
+
+    // A row function applied to a whole tensor, with the extra arguments it
+    // takes after the row
+    template <typename From, typename To, typename... Args>
+    struct RowParams
+    {
+        void (*row)(size_t n, const From *x, To *y, Args...);
+        const From *x;
+        To *y;
+        size_t n;
+        std::tuple<Args...> args;
+    };
+
+    template <typename Params>
+    void runRows(const Params &p)
+    {
+        parallel_for(p.n, simdUnaryGrain, [&](size_t begin, size_t end)
+                     { std::apply([&](auto... args)
+                                  { p.row(end - begin, p.x + begin,
+                                          p.y + begin, args...); },
+                                  p.args); });
+    }
+
+    template <typename From, typename To, typename... Args>
+    RowParams<From, To, Args...> rowParams(const Operator &op,
+                                           void (*row)(size_t, const From *,
+                                                       To *, Args...),
+                                           Args... args)
+    {
+        return {row, op->getInputs(0)->getRawDataPtr<From *>(),
+                op->getOutput()->getRawDataPtr<To *>(),
+                op->getOutput()->size(), {args...}};
+    }
+
+    // A Float32 row function applied to a Float16/BFloat16 tensor, converted
+    // by chunks
+    template <typename T, typename... Args>
+    struct HalfRowParams
+    {
+        void (*row)(size_t n, const float *x, float *y, Args...);
+        WidenRow widen;
+        NarrowRow narrow;
+        const T *x;
+        T *y;
+        size_t n;
+        std::tuple<Args...> args;
+    };
+
+    template <typename Params>
+    void runHalfRows(const Params &p)
+    {
+        parallel_for(p.n, simdUnaryGrain, [&](size_t begin, size_t end)
+                     {
+            float x[halfChunk];
+            for (size_t i = begin; i < end; i += halfChunk)
+            {
+                size_t m = std::min(halfChunk, end - i);
+                p.widen(m, bits(p.x + i), x);
+                std::apply([&](auto... args)
+                           { p.row(m, x, x, args...); },
+                           p.args);
+                p.narrow(m, x, bits(p.y + i));
+            } });
+    }
+
+    // The params of a Float32 row function applied to a tensor of T
+    template <typename T, typename... Args>
+    auto floatRowParams(const Operator &op,
+                        void (*row)(size_t, const float *, float *, Args...),
+                        Args... args)
+    {
+        if constexpr (std::is_same_v<T, float>)
+            return rowParams(op, row, args...);
+        else
+        {
+            auto [widen, narrow] =
+                half_conversions<T>(get_simd_kernels(get_cpu_isa()));
+            return HalfRowParams<T, Args...>{
+                row,
+                widen,
+                narrow,
+                op->getInputs(0)->getRawDataPtr<T *>(),
+                op->getOutput()->getRawDataPtr<T *>(),
+                op->getOutput()->size(),
+                {args...}};
+        }
+    }
+
+    /**
+     * @brief Relu with explicit SSE/AVX2/AVX-512 loops, the instruction set
+     * being picked from CPUID. Float16 and BFloat16 are converted to Float32
+     * by chunks. Large tensors are split among threads.
+     */
+    template <typename T>
+    class SimdUnary : public CpuKernelWithoutConfig
+    {
+        static auto prepare(const Operator &op)
+        {
+            return floatRowParams<T>(op, get_simd_kernels(get_cpu_isa()).relu);
+        }
+        using Params = decltype(prepare(std::declval<const Operator &>()));
+
+        static void run(const Params &p)
+        {
+            if constexpr (is_half_v<T>)
+                runHalfRows(p);
+            else
+                runRows(p);
+        }
 
         void compute(const Operator &_op,
                      const RuntimeObj *context) const override
         {
-#define CASE(N) \
-    case N:     \
-        doCompute<DT<N>::t>(_op, context)
+            run(prepare(_op));
+        }
 
-            int dataTypeIdx = _op->getDType().getIndex();
-            switch (dataTypeIdx)
+        KernelStep compile(const Operator &_op,
+                           const RuntimeObj *context) const override
+        {
+            return KernelStep::make<Params, run>(prepare(_op));
+        }
+    };
+
+    /**
+     * @brief Clip with explicit SSE/AVX2/AVX-512 loops, see SimdUnary.
+     */
+    template <typename T>
+    class SimdClip : public CpuKernelWithoutConfig
+    {
+        static auto prepare(const Operator &_op)
+        {
+            auto op = as<ClipObj>(_op);
+            return floatRowParams<T>(_op,
+                                     get_simd_kernels(get_cpu_isa()).clip,
+                                     op->getMin().value_or(-INFINITY),
+                                     op->getMax().value_or(INFINITY));
+        }
+        using Params = decltype(prepare(std::declval<const Operator &>()));
+
+        static void run(const Params &p)
+        {
+            if constexpr (is_half_v<T>)
+                runHalfRows(p);
+            else
+                runRows(p);
+        }
+
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
+        {
+            run(prepare(_op));
+        }
+
+        KernelStep compile(const Operator &_op,
+                           const RuntimeObj *context) const override
+        {
+            return KernelStep::make<Params, run>(prepare(_op));
+        }
+    };
+
+    /**
+     * @brief Every CastType. Conversions between Float32 and Float16/BFloat16
+     * go through the vectorized rows of SimdKernels, the others are plain
+     * static_casts that the compiler vectorizes. Float to integer casts
+     * truncate toward zero and saturate, NaN becoming 0.
+     */
+    class NaiveCast : public CpuKernelWithoutConfig
+    {
+        template <typename From, typename To>
+        static To castValue(From x)
+        {
+            if constexpr (std::is_floating_point_v<From> &&
+                          std::is_integral_v<To>)
+            {
+                // converting NaN or a value out of the range of To is
+                // undefined. Both bounds are powers of two, or one less, so
+                // `hi` rounds up to the first value out of range.
+                constexpr From lo = From(std::numeric_limits<To>::min()),
+                               hi = From(std::numeric_limits<To>::max());
+                if (std::isnan(x))
+                    return To(0);
+                if (x <= lo)
+                    return std::numeric_limits<To>::min();
+                if (x >= hi)
+                    return std::numeric_limits<To>::max();
+            }
+            return static_cast<To>(x);
+        }
+
+        template <typename From, typename To>
+        static void castRow(size_t n, const From *x, To *y)
+        {
+            for (size_t i = 0; i < n; ++i)
+                y[i] = castValue<From, To>(x[i]);
+        }
+
+        // Calls `f` with the RowParams of the cast
+        template <typename F>
+        static void visit(const Operator &_op, F &&f)
+        {
+            const auto &kernels = get_simd_kernels(get_cpu_isa());
+#undef CASE
+#define CASE(TYPE, FROM, TO)                      \
+    case CastType::TYPE:                          \
+        f(rowParams(_op, castRow<FROM, TO>));     \
+        break
+
+            switch (as<CastObj>(_op)->getType())
             {
-                CASE(1); // DataType::Float32
+            case CastType::Float2Float16:
+                f(rowParams(_op, kernels.toFloat16));
                 break;
-                CASE(12); // DataType::UInt32
+            case CastType::Float2BFloat16:
+                f(rowParams(_op, kernels.toBFloat16));
                 break;
+            case CastType::Float162Float:
+                f(rowParams(_op, kernels.fromFloat16));
+                break;
+            case CastType::BFloat162Float:
+                f(rowParams(_op, kernels.fromBFloat16));
+                break;
+                CASE(Float2Int64, float, int64_t);
+                CASE(Float2Int32, float, int32_t);
+                CASE(Float2Int16, float, int16_t);
+                CASE(Float2Int8, float, int8_t);
+                CASE(Int322Float, int32_t, float);
+                CASE(Int322Int8, int32_t, int8_t);
+                CASE(Int322Int16, int32_t, int16_t);
+                CASE(Int322Int64, int32_t, int64_t);
+                CASE(Int162Float, int16_t, float);
+                CASE(Int162Int32, int16_t, int32_t);
+                CASE(Int82Float, int8_t, float);
+                CASE(Int82Int16, int8_t, int16_t);
+                CASE(Int82Int32, int8_t, int32_t);
+                CASE(Uint82Float, uint8_t, float);
+                CASE(Uint82Int32, uint8_t, int32_t);
+                CASE(Uint82Int64, uint8_t, int64_t);
+                CASE(Int642Int32, int64_t, int32_t);
+                CASE(Int642Uint32, int64_t, uint32_t);
+                CASE(Int642Float, int64_t, float);
+                CASE(Uint322Int64, uint32_t, int64_t);
+                CASE(Float2Float, float, float);
             default:
                 IT_TODO_HALT();
             }
+#undef CASE
+        }
+
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
+        {
+            visit(_op, [](const auto &params) { runRows(params); });
+        }
+
+        KernelStep compile(const Operator &_op,
+                           const RuntimeObj *context) const override
+        {
+            KernelStep step;
+            visit(_op, [&](const auto &params)
+                  {
+                using Params = std::decay_t<decltype(params)>;
+                step = KernelStep::make<Params, runRows<Params>>(params); });
+            return step;
         }
     };
 
-    REGISTER_KERNEL(Device::CPU, OpType::Relu, NativeUnary, "reluNaive_CPU");
-    REGISTER_KERNEL(Device::CPU, OpType::Clip, Clip, "Clip_CPU");
+    REGISTER_KERNEL_FOR_TYPES(Device::CPU, OpType::Relu, CpuArithmeticTypes,
+                              NativeUnary, "reluNaive_CPU");
+    REGISTER_KERNEL_FOR_TYPES(Device::CPU, OpType::Clip, CpuArithmeticTypes,
+                              Clip, "Clip_CPU");
+    REGISTER_KERNEL_FOR_TYPES_WITH_PRIORITY(Device::CPU, OpType::Relu,
+                                            CpuFloatTypes, SimdUnary,
+                                            "reluSimd_CPU", 1);
+    REGISTER_KERNEL_FOR_TYPES_WITH_PRIORITY(Device::CPU, OpType::Clip,
+                                            CpuFloatTypes, SimdClip,
+                                            "ClipSimd_CPU", 1);
+    // the types CastType converts from
+    REGISTER_KERNEL(Device::CPU, OpType::Cast, DataType::Float32, NaiveCast,
+                    "Cast_CPU");
+    REGISTER_KERNEL(Device::CPU, OpType::Cast, DataType::Float16, NaiveCast,
+                    "Cast_CPU");
+    REGISTER_KERNEL(Device::CPU, OpType::Cast, DataType::BFloat16, NaiveCast,
+                    "Cast_CPU");
+    REGISTER_KERNEL(Device::CPU, OpType::Cast, DataType::Int64, NaiveCast,
+                    "Cast_CPU");
+    REGISTER_KERNEL(Device::CPU, OpType::Cast, DataType::Int32, NaiveCast,
+                    "Cast_CPU");
+    REGISTER_KERNEL(Device::CPU, OpType::Cast, DataType::Int16, NaiveCast,
+                    "Cast_CPU");
+    REGISTER_KERNEL(Device::CPU, OpType::Cast, DataType::Int8, NaiveCast,
+                    "Cast_CPU");
+    REGISTER_KERNEL(Device::CPU, OpType::Cast, DataType::UInt8, NaiveCast,
+                    "Cast_CPU");
+    REGISTER_KERNEL(Device::CPU, OpType::Cast, DataType::UInt32, NaiveCast,
+                    "Cast_CPU");
 
 }; // namespace infini
@@ -0,0 +1,100 @@
+#include "operators/fused_element_wise.h"
+#include "utils/operator_utils.h"
+
+namespace infini
+{
+    FusedElementwiseObj::FusedElementwiseObj(GraphObj *graph, TensorVec inputs,
+                                             Tensor output,
+                                             vector<ElementwiseStep> program)
+        : OperatorObj(OpType::FusedElementwise, inputs, {output}),
+          program(std::move(program))
+    {
+        IT_ASSERT(!this->program.empty());
+        int nRegs = inputs.size();
+        for (auto &step : this->program)
+        {
+            IT_ASSERT(step.a >= 0 && step.a < nRegs);
+            IT_ASSERT(step.b < nRegs);
+            ++nRegs;
+        }
+        IT_ASSERT(checkValid(graph));
+    }
+
+    optional<vector<Shape>>
+    FusedElementwiseObj::inferShape(const TensorVec &inputs)
+    {
+        Shape res = inputs[0]->getDims();
+        for (size_t i = 1; i < inputs.size(); ++i)
+            res = infer_broadcast(res, inputs[i]->getDims());
+        return {{res}};
+    }
+
+    vector<DataType>
+    FusedElementwiseObj::inferDataType(const TensorVec &inputs) const
+    {
+        return {program.back().dtype};
+    }
+
+    vector<int> FusedElementwiseObj::getOpAttrVector() const
+    {
+        vector<int> ret;
+        for (auto &step : program)
+        {
+            ret.emplace_back(step.type.underlying());
+            ret.emplace_back(step.a);
+            ret.emplace_back(step.b);
+            ret.emplace_back(step.dtype.getIndex());
+        }
+        return ret;
+    }
+
+    std::string FusedElementwiseObj::toString() const
+    {
+        std::ostringstream os;
+        os << type.toString() << "[" << getGuid() << "]";
+        os << "(";
+        for (size_t i = 0; i < inputs.size(); ++i)
+            os << "r" << i << "=" << inputs[i]->getGuid() << ",";
+        for (size_t i = 0; i < program.size(); ++i)
+        {
+            const auto &step = program[i];
+            os << "r" << inputs.size() + i << "=" << step.type.toString()
+               << "(r" << step.a;
+            if (step.b >= 0)
+                os << ",r" << step.b;
+            if (step.type == OpType::Cast)
+                os << "," << step.dtype.toString();
+            os << "),";
+        }
+        os << "output=" << outputs[0]->getGuid() << ")";
+        return os.str();
+    }
+
+    bool FusedElementwiseObj::canFuse(const Operator &op)
+    {
+        switch (op->getOpType().underlying())
+        {
+        case OpType::Add:
+        case OpType::Sub:
+        case OpType::Mul:
+        case OpType::Div:
+        case OpType::Relu:
+        case OpType::Clip:
+        case OpType::Cast:
+            break;
+        default:
+            return false;
+        }
+        auto isFloat = [](const Tensor &t)
+        {
+            auto dtype = t->getDType();
+            return dtype == DataType::Float32 || dtype == DataType::Float16 ||
+                   dtype == DataType::BFloat16;
+        };
+        for (auto &input : op->getInputs())
+            if (!isFloat(input))
+                return false;
+        return isFloat(op->getOutput());
+    }
+
+}; // namespace infini
@@ -1,14 +1,22 @@
 #include "operators/matmul.h"
+#include "utils/operator_utils.h"
 #include <utility>
 
 namespace infini
 {
 
     MatmulObj::MatmulObj(GraphObj *graph, Tensor A, Tensor B, Tensor C, bool transA,
-                         bool transB)
-        : OperatorObj(OpType::MatMul, TensorVec{A, B}, {C}),
-          transA(transA), transB(transB)
+                         bool transB, Tensor bias, ActType act,
+                         std::optional<float> actMin, std::optional<float> actMax)
+        : OperatorObj(OpType::MatMul,
+                      bias ? TensorVec{A, B, bias} : TensorVec{A, B}, {C}),
+          transA(transA), transB(transB), act(act), actMin(actMin),
+          actMax(actMax)
     {
+        if (act == ActType::None)
+            this->actMin = this->actMax = std::nullopt;
+        else if (act == ActType::Relu)
+            this->actMin = 0.0f, this->actMax = std::nullopt;
         IT_ASSERT(checkValid(graph));
     }
 
@@ -18,7 +26,15 @@ namespace infini
         os << "Matmul([" << (transA ? "A^T" : "A") << "," << (transB ? "B^T" : "B]")
            << ",A=" << inputs[0]->getGuid()
            << ",B=" << inputs[1]->getGuid() << ",C=" << outputs[0]->getGuid()
-           << ",mnk=[" << m << "," << n << "," << k << "])";
+           << ",mnk=[" << m << "," << n << "," << k << "]";
+        if (auto bias = getBias())
+            os << ",bias=" << bias->getGuid();
+        if (act == ActType::Relu)
+            os << ",act=Relu";
+        else if (act == ActType::Clip)
+            os << ",act=Clip[" << (actMin ? std::to_string(*actMin) : "-inf")
+               << "," << (actMax ? std::to_string(*actMax) : "inf") << "]";
+        os << ")";
         return os.str();
     }
 
@@ -28,37 +44,38 @@ namespace infini
         // TODO：返回经过 matmul 操作后的 shape
         // REF: https://github.com/onnx/onnx/blob/main/docs/Operators.md#gemm
         // =================================== 作业 ===================================
-		// 最后两个维度矩阵乘 前面的应该是广播即可
-		const auto A = inputs[0];
-		const auto B = inputs[1];
-		auto A_dim = A->getDims();
-		auto B_dim = B->getDims();
+        // The last two dims are multiplied, the leading ones are broadcast.
+        const auto A = inputs[0], B = inputs[1];
+        const auto &shapeA = A->getDims(), &shapeB = B->getDims();
+        int rankA = A->getRank(), rankB = B->getRank();
+        if (rankA < 2 || rankB < 2)
+            return std::nullopt;
 
-		auto A_rank = A->getRank();
-		auto B_rank = B->getRank();
+        ShapeElem kA = transA ? shapeA[rankA - 2] : shapeA[rankA - 1];
+        ShapeElem kB = transB ? shapeB[rankB - 1] : shapeB[rankB - 2];
+        if (kA != kB)
+            return std::nullopt;
+        m = transA ? shapeA[rankA - 1] : shapeA[rankA - 2];
+        n = transB ? shapeB[rankB - 2] : shapeB[rankB - 1];
+        k = kA;
 
-		if(transA){
-			std::swap(A_dim[A_rank-1],A_dim[A_rank-2]);
-		}
-		if(transB){
-			std::swap(B_dim[B_rank-1],B_dim[B_rank-2]);
-		}
-
-		// if(A_dim[A_rank-1] != B_dim[B_rank-2]){
-		// 	return std::nullopt;
-		// }
-
-		size_t max_size = std::max(A_rank, B_rank);
-		Shape output_dim(max_size);
-
-		output_dim[max_size-1] = B_dim[B_rank-1];
-		output_dim[max_size-2] = A_dim[B_rank-2];
-
-		for(size_t i = 0; i < max_size-2; i++){
-			output_dim[i] = std::max(A_dim[i], B_dim[i]);
-		}
-
-        return vector<Shape>{output_dim};
+        Shape output = infer_broadcast(Shape(shapeA.begin(), shapeA.end() - 2),
+                                       Shape(shapeB.begin(), shapeB.end() - 2));
+        output.emplace_back(m);
+        output.emplace_back(n);
+        // the bias is a row of C
+        if (inputs.size() > 2)
+        {
+            const auto &shapeBias = inputs[2]->getDims();
+            if (shapeBias.empty() || shapeBias.size() > output.size() ||
+                shapeBias.back() != n ||
+                inputs[2]->getDType() != A->getDType())
+                return std::nullopt;
+            for (size_t i = 0; i + 1 < shapeBias.size(); ++i)
+                if (shapeBias[i] != 1)
+                    return std::nullopt;
+        }
+        return vector<Shape>{output};
     }
 
-} // namespace infini
\ No newline at end of file
+} // namespace infini
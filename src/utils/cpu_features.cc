@@ -0,0 +1,46 @@
+#include "utils/cpu_features.h"
+#include <atomic>
+
+namespace infini {
+
+static CpuIsa detect_cpu_isa() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return CpuIsa::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+        __builtin_cpu_supports("f16c"))
+        return CpuIsa::AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return CpuIsa::SSE;
+#endif
+    return CpuIsa::Scalar;
+}
+
+static std::atomic<CpuIsa> maxCpuIsa{CpuIsa::AVX512};
+
+CpuIsa get_cpu_isa() {
+    static const CpuIsa detected = detect_cpu_isa();
+    auto limit = maxCpuIsa.load(std::memory_order_relaxed);
+    return limit < detected ? limit : detected;
+}
+
+void set_max_cpu_isa(CpuIsa isa) {
+    maxCpuIsa.store(isa, std::memory_order_relaxed);
+}
+
+std::string cpu_isa_to_str(CpuIsa isa) {
+    switch (isa) {
+    case CpuIsa::Scalar:
+        return "Scalar";
+    case CpuIsa::SSE:
+        return "SSE";
+    case CpuIsa::AVX2:
+        return "AVX2";
+    case CpuIsa::AVX512:
+        return "AVX512";
+    }
+    return "Unknown";
+}
+
+} // namespace infini
@@ -17,8 +17,8 @@ Shape infer_broadcast(const Shape &A, const Shape &B) {
 	Shape result(max_size);
 	// 广播需要从后向前比较
 	for (size_t i = 0; i < max_size; i++) {
-		int dim_A = (i < size_A) ? A[size_A - 1 - i] : 1;
-		int dim_B = (i < size_B) ? B[size_B - 1 - i] : 1;
+		ShapeElem dim_A = (i < size_A) ? A[size_A - 1 - i] : 1;
+		ShapeElem dim_B = (i < size_B) ? B[size_B - 1 - i] : 1;
 
 		if(dim_A != dim_B && dim_A != 1 && dim_B != 1){
 			std::cout << "cannot broardcasting\n";
@@ -79,7 +79,8 @@ std::string device_to_str(Device device) {
 std::string get_kernel_attrs_str(const KernelAttrs &kernelAttrs) {
     std::string deviceStr = device_to_str(std::get<0>(kernelAttrs));
     std::string opStr = OpType(std::get<1>(kernelAttrs)).toString();
-    return deviceStr + ", " + opStr;
+    std::string dtypeStr = std::get<2>(kernelAttrs).toString();
+    return deviceStr + ", " + opStr + ", " + dtypeStr;
 }
 
 } // namespace infini
@@ -0,0 +1,30 @@
+#include "utils/parallel.h"
+#include <atomic>
+#include <thread>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace infini {
+
+static int default_num_threads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+#endif
+}
+
+static std::atomic<int> numThreads{0};
+
+int get_num_threads() {
+    int n = numThreads.load(std::memory_order_relaxed);
+    return n > 0 ? n : default_num_threads();
+}
+
+void set_num_threads(int nThreads) {
+    numThreads.store(nThreads > 0 ? nThreads : 0, std::memory_order_relaxed);
+}
+
+} // namespace infini
@@ -0,0 +1,128 @@
+#include "utils/thread_pool.h"
+
+namespace infini {
+
+// Index of the queue of the current thread, 0 outside of the pool
+static thread_local int currentQueue = 0;
+
+ThreadPool &ThreadPool::getInstance() {
+    static ThreadPool instance;
+    return instance;
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void ThreadPool::reserve(int nThreads) {
+    if (nThreads - 1 <= nWorkers.load(std::memory_order_acquire))
+        return;
+    std::lock_guard<std::mutex> lock(mutex);
+    while (int(workers.size()) < std::min(nThreads - 1, maxWorkers)) {
+        int self = workers.size() + 1;
+        workers.emplace_back([this, self] { work(self); });
+    }
+    nWorkers.store(workers.size(), std::memory_order_release);
+}
+
+void ThreadPool::submit(Task task) {
+    auto &queue = queues[currentQueue];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.emplace_back(std::move(task));
+    }
+    nPending.fetch_add(1);
+    // taking the lock orders the notification after a worker's check of
+    // nPending, so that no wake-up is lost
+    { std::lock_guard<std::mutex> lock(mutex); }
+    wake.notify_one();
+}
+
+bool ThreadPool::pop(Queue &queue, bool back, Task &task) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+    if (back) {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+    } else {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+    }
+    nPending.fetch_sub(1);
+    return true;
+}
+
+bool ThreadPool::take(int self, Task &task) {
+    if (nPending.load() == 0)
+        return false;
+    // the newest own task first for locality, then the oldest of the others
+    if (pop(queues[self], true, task))
+        return true;
+    int n = nWorkers.load(std::memory_order_acquire) + 1;
+    for (int i = 1; i <= n; ++i)
+        if (pop(queues[(self + i) % n], false, task))
+            return true;
+    return false;
+}
+
+bool ThreadPool::runPendingTask() {
+    Task task;
+    if (!take(currentQueue, task))
+        return false;
+    task();
+    return true;
+}
+
+void ThreadPool::work(int self) {
+    currentQueue = self;
+    while (true) {
+        Task task;
+        if (take(self, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stop || nPending.load() > 0; });
+        if (stop)
+            return;
+    }
+}
+
+void TaskGroup::run(ThreadPool::Task task) {
+    nRunning.fetch_add(1);
+    ThreadPool::getInstance().submit([this, task = std::move(task)] {
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+                error = std::current_exception();
+        }
+        nRunning.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+void TaskGroup::join() {
+    auto &pool = ThreadPool::getInstance();
+    while (nRunning.load(std::memory_order_acquire) > 0)
+        if (!pool.runPendingTask())
+            std::this_thread::yield();
+}
+
+void TaskGroup::wait() {
+    join();
+    if (error) {
+        auto e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+} // namespace infini
@@ -72,4 +72,39 @@ namespace infini
         EXPECT_EQ(ptr1, ptr2);
     }
 
+    TEST(Allocator, testBestFit)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Allocator allocator = Allocator(runtime);
+        // a(64) b(8) c(32) d(8) e(8), then free a and c
+        size_t offsetA = allocator.alloc(64);
+        allocator.alloc(8);
+        size_t offsetC = allocator.alloc(32);
+        allocator.alloc(8);
+        allocator.alloc(8);
+        allocator.free(offsetA, 64);
+        allocator.free(offsetC, 32);
+        // the 32 bytes hole fits exactly, first fit would have split a
+        EXPECT_EQ(allocator.alloc(32), offsetC);
+        EXPECT_EQ(allocator.alloc(64), offsetA);
+        EXPECT_EQ(allocator.getPeak(), (size_t)120);
+    }
+
+    TEST(Allocator, testFreeMergeNeighbours)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Allocator allocator = Allocator(runtime);
+        size_t offsetA = allocator.alloc(16);
+        size_t offsetB = allocator.alloc(16);
+        size_t offsetC = allocator.alloc(16);
+        allocator.alloc(16);
+        // free a and c first, b then merges with both of them
+        allocator.free(offsetA, 16);
+        allocator.free(offsetC, 16);
+        allocator.free(offsetB, 16);
+        EXPECT_EQ(allocator.getUsed(), (size_t)16);
+        EXPECT_EQ(allocator.alloc(48), offsetA);
+        EXPECT_EQ(allocator.getPeak(), (size_t)64);
+    }
+
 } // namespace infini
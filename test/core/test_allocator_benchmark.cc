@@ -0,0 +1,61 @@
+#include "core/allocator.h"
+#include "core/runtime.h"
+
+#include "test.h"
+#include <chrono>
+#include <random>
+
+namespace infini
+{
+    // Plans a long chain of tensors with random sizes and lifetimes, the way
+    // GraphObj::dataMalloc does for a large imported model, and reports the
+    // planning time and how much the arena exceeds the live bytes.
+    static void benchmarkPlanning(size_t nTensors, size_t maxLive)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Allocator allocator = Allocator(runtime);
+        std::mt19937 gen(0);
+        std::uniform_int_distribution<size_t> sizeDist(1, 1 << 20);
+        std::uniform_int_distribution<size_t> lifeDist(1, maxLive);
+
+        // (last use, offset, size) of the live tensors
+        std::multimap<size_t, std::pair<size_t, size_t>> live;
+        size_t maxUsed = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < nTensors; ++i)
+        {
+            size_t size = sizeDist(gen);
+            live.emplace(i + lifeDist(gen),
+                         std::make_pair(allocator.alloc(size), size));
+            maxUsed = std::max(maxUsed, allocator.getUsed());
+            while (!live.empty() && live.begin()->first <= i)
+            {
+                auto [addr, size] = live.begin()->second;
+                allocator.free(addr, size);
+                live.erase(live.begin());
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        double ms =
+            std::chrono::duration<double, std::milli>(end - begin).count();
+        double fragmentation = double(allocator.getPeak()) / maxUsed;
+        printf("%zu tensors, up to %zu live: %.2f ms, peak/max live %.3f\n",
+               nTensors, maxLive, ms, fragmentation);
+        EXPECT_GE(allocator.getPeak(), maxUsed);
+    }
+
+    TEST(AllocatorBenchmark, planning)
+    {
+        benchmarkPlanning(1000, 16);
+        benchmarkPlanning(5000, 256);
+    }
+
+    // The size of a large model, run with --gtest_also_run_disabled_tests
+    TEST(AllocatorBenchmark, DISABLED_largePlanning)
+    {
+        benchmarkPlanning(20000, 16);
+        benchmarkPlanning(20000, 1024);
+        benchmarkPlanning(100000, 4096);
+    }
+
+} // namespace infini
@@ -1,10 +1,19 @@
+#include "core/flat_graph.h"
 #include "core/graph.h"
+#include "core/graph_rewriter.h"
 #include "core/kernel.h"
+#include "core/memory_schedule.h"
 #include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/fused_element_wise.h"
 #include "operators/matmul.h"
 #include "operators/transpose.h"
+#include "operators/unary.h"
 
 #include "test.h"
+#include <chrono>
+#include <unistd.h>
 
 namespace infini
 {
@@ -18,9 +27,9 @@ namespace infini
         Tensor t2 = g->addTensor({2, 3, 4, 5}, DataType::UInt32);
         Tensor t3 = g->addTensor({2, 3, 5, 4}, DataType::UInt32);
         Tensor o = g->addTensor({2, 3, 4, 4}, DataType::UInt32);
-        g->addOpWithOutputs<TransposeObj>(i1, t1, Shape{0, 1, 3, 2});
-        g->addOpWithOutputs<TransposeObj>(t1, t2, Shape{0, 1, 3, 2});
-        g->addOpWithOutputs<TransposeObj>(i2, t3, Shape{0, 1, 3, 2});
+        g->addOpWithOutputs<TransposeObj>(i1, t1, vector<int>{0, 1, 3, 2});
+        g->addOpWithOutputs<TransposeObj>(t1, t2, vector<int>{0, 1, 3, 2});
+        g->addOpWithOutputs<TransposeObj>(i2, t3, vector<int>{0, 1, 3, 2});
         g->addOpWithOutputs<MatmulObj>(t2, t3, o);
         // 优化前
         g->print();
@@ -49,4 +58,633 @@ namespace infini
         EXPECT_EQ(op->getTransA(), false);
         EXPECT_EQ(op->getTransB(), true);
     }
-}
\ No newline at end of file
+
+    // Both operands of the MatMul are the same transposed tensor, and both
+    // fold into it, unless it is the bias too
+    TEST(Graph, FoldSharedTransposeIntoMatmul)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto x = g->addTensor({3, 3}, DataType::Float32);
+        auto t = g->addOp<TransposeObj>(x, nullptr, vector<int>{1, 0})
+                     ->getOutput();
+        auto o = g->addOp<MatmulObj>(t, t, nullptr)->getOutput();
+        g->optimize();
+
+        ASSERT_EQ(g->getOperators().size(), 1u);
+        auto mm = as<MatmulObj>(g->getOperators()[0]);
+        EXPECT_EQ(mm->getInputs(0), x);
+        EXPECT_EQ(mm->getInputs(1), x);
+        EXPECT_TRUE(mm->getTransA());
+        EXPECT_TRUE(mm->getTransB());
+
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        runtime->run(g);
+        // xT * xT, not xT * x
+        EXPECT_TRUE(o->equalData(
+            vector<float>{15, 42, 69, 18, 54, 90, 21, 66, 111}));
+
+        // a bias read through the same Transpose keeps it
+        auto build = [&](Graph g)
+        {
+            auto x = g->addTensor({3, 1}, DataType::Float32);
+            auto w = g->addTensor({3, 3}, DataType::Float32);
+            auto t = g->addOp<TransposeObj>(x, nullptr, vector<int>{1, 0})
+                         ->getOutput();
+            return g->addOp<MatmulObj>(t, w, nullptr, false, false, t)
+                ->getOutput();
+        };
+        Graph ref = make_ref<GraphObj>(runtime);
+        g = make_ref<GraphObj>(runtime);
+        auto refOutput = build(ref), output = build(g);
+        g->optimize();
+        EXPECT_TRUE(g->checkValid());
+        mm = as<MatmulObj>(output->getSource());
+        EXPECT_EQ(mm->getBias()->getDims(), (Shape{1, 3}));
+        for (auto graph : {ref, g})
+        {
+            graph->dataMalloc();
+            for (auto &t : graph->getInputs())
+                t->setData(IncrementalGenerator());
+            runtime->run(graph);
+        }
+        EXPECT_TRUE(output->equalData(refOutput));
+    }
+
+    TEST(Graph, DataMallocReuse)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({1, 2, 2, 3}, DataType::Float32);
+        Tensor t1 = g->addOp<ReluObj>(i, nullptr)->getOutput();
+        Tensor t2 = g->addOp<ReluObj>(t1, nullptr)->getOutput();
+        Tensor t3 = g->addOp<ReluObj>(t2, nullptr)->getOutput();
+        Tensor o = g->addOp<ReluObj>(t3, nullptr)->getOutput();
+        g->dataMalloc();
+        // t1 is dead once t2 is computed, so t3 reuses its block, and o
+        // reuses the block of t2
+        EXPECT_EQ(t1->getRawDataPtr<void *>(), t3->getRawDataPtr<void *>());
+        EXPECT_EQ(t2->getRawDataPtr<void *>(), o->getRawDataPtr<void *>());
+        EXPECT_NE(t1->getRawDataPtr<void *>(), t2->getRawDataPtr<void *>());
+        // the graph input is never overwritten
+        EXPECT_NE(i->getRawDataPtr<void *>(), t1->getRawDataPtr<void *>());
+        EXPECT_NE(i->getRawDataPtr<void *>(), t2->getRawDataPtr<void *>());
+
+        i->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(o->equalData(
+            vector<float>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}));
+    }
+
+    // MatMul -> Add(bias) -> Relu and Add(bias, MatMul) -> Clip each become a
+    // single MatMul computing the same outputs
+    TEST(Graph, FuseMatmulEpilogue)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        auto build = [&](Graph g) {
+            auto a = g->addTensor({2, 70, 300}, DataType::Float32);
+            auto b = g->addTensor({300, 50}, DataType::Float32);
+            auto bias0 = g->addTensor({50}, DataType::Float32);
+            auto bias1 = g->addTensor({1, 1, 50}, DataType::Float32);
+            auto mm0 = g->addOp<MatmulObj>(a, b, nullptr)->getOutput();
+            auto add0 = g->addOp<AddObj>(mm0, bias0, nullptr)->getOutput();
+            auto mm1 = g->addOp<MatmulObj>(a, b, nullptr)->getOutput();
+            auto add1 = g->addOp<AddObj>(bias1, mm1, nullptr)->getOutput();
+            return TensorVec{
+                a, b, bias0, bias1,
+                g->addOp<ReluObj>(add0, nullptr)->getOutput(),
+                g->addOp<ClipObj>(add1, nullptr, -1e5f, 1e5f)->getOutput()};
+        };
+        Graph ref = make_ref<GraphObj>(runtime), g = make_ref<GraphObj>(runtime);
+        auto refTensors = build(ref), tensors = build(g);
+        g->optimize();
+
+        ASSERT_EQ(g->getOperators().size(), 2u);
+        EXPECT_EQ(g->getTensors().size(), 6u);
+        EXPECT_TRUE(g->checkValid());
+        for (auto &op : g->getOperators())
+        {
+            auto mm = as<MatmulObj>(op);
+            EXPECT_EQ(mm->numInputs(), 3);
+            EXPECT_EQ(mm->getOutput()->getSource(), op);
+            EXPECT_TRUE(mm->getPredecessors().empty());
+        }
+        auto mm0 = as<MatmulObj>(tensors[4]->getSource());
+        EXPECT_EQ(mm0->getBias(), tensors[2]);
+        EXPECT_EQ(mm0->getAct(), ActType::Relu);
+        auto mm1 = as<MatmulObj>(tensors[5]->getSource());
+        EXPECT_EQ(mm1->getBias(), tensors[3]);
+        EXPECT_EQ(mm1->getAct(), ActType::Clip);
+        EXPECT_EQ(mm1->getActMax(), 1e5f);
+
+        for (auto graph : {ref, g})
+            graph->dataMalloc();
+        for (size_t i = 0; i < 4; ++i)
+        {
+            refTensors[i]->setData(IncrementalGenerator());
+            tensors[i]->setData(IncrementalGenerator());
+        }
+        // negative and positive sums
+        for (auto &t : {refTensors[2], tensors[2]})
+            t->setData([](void *ptr, size_t n, DataType)
+                       {
+                           for (size_t i = 0; i < n; ++i)
+                               static_cast<float *>(ptr)[i] =
+                                   i % 2 ? -1e8f : 0.0f;
+                       });
+        runtime->run(ref);
+        runtime->run(g);
+        for (size_t i = 4; i < 6; ++i)
+            EXPECT_TRUE(tensors[i]->equalData(refTensors[i]));
+    }
+
+    // A chain of element-wise ops through a Float16 Cast becomes one
+    // FusedElementwise op, except for the Add whose output is also read by an
+    // op outside of the chain
+    TEST(Graph, FuseElementwise)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        auto build = [&](Graph g) {
+            auto x = g->addTensor({2, 3, 64}, DataType::Float32);
+            auto y = g->addTensor({64}, DataType::Float32);
+            auto z = g->addTensor({2, 3, 64}, DataType::Float16);
+            auto a = g->addOp<AddObj>(x, y, nullptr)->getOutput();
+            auto b = g->addOp<ReluObj>(a, nullptr)->getOutput();
+            auto c = g->addOp<MulObj>(b, x, nullptr)->getOutput();
+            auto d = g->addOp<CastObj>(c, nullptr, CastType::Float2Float16)
+                         ->getOutput();
+            auto e = g->addOp<SubObj>(d, z, nullptr)->getOutput();
+            return TensorVec{
+                x, y, z,
+                g->addOp<ClipObj>(e, nullptr, -1.0f, 2.0f)->getOutput(),
+                g->addOp<DivObj>(a, y, nullptr)->getOutput()};
+        };
+        Graph ref = make_ref<GraphObj>(runtime), g = make_ref<GraphObj>(runtime);
+        auto refTensors = build(ref), tensors = build(g);
+        g->optimize();
+
+        EXPECT_EQ(g->getOperators().size(), 3u);
+        EXPECT_EQ(g->getTensors().size(), 6u);
+        EXPECT_TRUE(g->checkValid());
+        auto fused = as<FusedElementwiseObj>(tensors[3]->getSource());
+        ASSERT_EQ(fused->getOpType(), OpType::FusedElementwise);
+        EXPECT_EQ(fused->getProgram().size(), 5u);
+        EXPECT_EQ(fused->numInputs(), 3);
+        EXPECT_EQ(tensors[4]->getSource()->getOpType(), OpType::Div);
+
+        for (auto graph : {ref, g})
+        {
+            graph->dataMalloc();
+            for (auto &t : graph->getInputs())
+                t->setData([](void *ptr, size_t n, DataType dtype)
+                           {
+                               for (size_t i = 0; i < n; ++i)
+                               {
+                                   float v = (float(i % 13) - 6) * 0.25f;
+                                   if (dtype == DataType::Float16)
+                                       static_cast<float16_t *>(ptr)[i] = v;
+                                   else
+                                       static_cast<float *>(ptr)[i] = v + 0.1f;
+                               }
+                           });
+            runtime->run(graph);
+        }
+        for (size_t i = 3; i < 5; ++i)
+            EXPECT_TRUE(tensors[i]->equalData(refTensors[i]));
+    }
+
+    // Every block of the chain is x -> Transpose -> Transpose -> MatMul(., w^T),
+    // the two Transposes composing into the identity. Dropping it makes the
+    // MatMul read the previous one directly, and the Transpose of w is folded
+    // into transB.
+    TEST(Graph, PassManager)
+    {
+        const int blocks = 2000;
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto x = g->addTensor({2, 8, 8}, DataType::Float32);
+        for (int i = 0; i < blocks; ++i)
+        {
+            auto t = g->addOp<TransposeObj>(x, nullptr, vector<int>{0, 2, 1});
+            auto u = g->addOp<TransposeObj>(t->getOutput(), nullptr,
+                                            vector<int>{0, 2, 1});
+            auto w = g->addTensor({2, 8, 8}, DataType::Float32);
+            auto wt = g->addOp<TransposeObj>(w, nullptr, vector<int>{0, 2, 1});
+            x = g->addOp<MatmulObj>(u->getOutput(), wt->getOutput(), nullptr)
+                    ->getOutput();
+        }
+
+        PassManager pm;
+        add_default_passes(pm);
+        auto stats = pm.run(*g);
+        auto rewrites = [&](const string &name)
+        {
+            for (auto &s : stats)
+                if (s.name == name)
+                    return s.rewrites;
+            ADD_FAILURE() << "no statistics for " << name;
+            return size_t(0);
+        };
+        EXPECT_EQ(rewrites("ComposeTransposes"), size_t(blocks));
+        EXPECT_EQ(rewrites("EraseIdentityTranspose"), size_t(blocks));
+        EXPECT_EQ(rewrites("FoldTransposeIntoMatmul"), size_t(blocks));
+        EXPECT_EQ(rewrites("FuseMatmulEpilogue"), 0u);
+        EXPECT_EQ(rewrites("FuseElementwise"), 0u);
+
+        // the input, and the weight and the output of every MatMul
+        EXPECT_EQ(g->getOperators().size(), size_t(blocks));
+        EXPECT_EQ(g->getTensors().size(), size_t(2 * blocks + 1));
+        EXPECT_TRUE(g->checkValid());
+        for (auto &op : g->getOperators())
+        {
+            ASSERT_EQ(op->getOpType(), OpType::MatMul);
+            auto mm = as<MatmulObj>(op);
+            EXPECT_FALSE(mm->getTransA());
+            EXPECT_TRUE(mm->getTransB());
+            EXPECT_FALSE(mm->getInputs(1)->getSource());
+        }
+        EXPECT_EQ(g->getOutputs(), TensorVec{x});
+    }
+
+    // Transposes sink through Add, Relu and Concat into a MatMul, compose into
+    // the identity, or compose and sink to the output of the graph
+    TEST(Graph, SinkTransposes)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        auto build = [&](Graph g)
+        {
+            auto x = g->addTensor({2, 3, 4}, DataType::Float32);
+            auto y = g->addTensor({2, 3, 4}, DataType::Float32);
+            auto z = g->addTensor({2, 3, 4}, DataType::Float32);
+            auto w = g->addTensor({2, 3, 5}, DataType::Float32);
+            auto t = [&](Tensor in, vector<int> permute)
+            {
+                return g->addOp<TransposeObj>(in, nullptr, permute)
+                    ->getOutput();
+            };
+            auto c = g->addOp<AddObj>(t(x, {0, 2, 1}), t(y, {0, 2, 1}), nullptr)
+                         ->getOutput();
+            auto d = g->addOp<ReluObj>(c, nullptr)->getOutput();
+            auto e = g->addOp<ConcatObj>(TensorVec{d, t(z, {0, 2, 1})},
+                                         nullptr, 1)
+                         ->getOutput();
+            auto o1 = g->addOp<MatmulObj>(e, w, nullptr)->getOutput();
+            auto o2 = g->addOp<MulObj>(t(t(x, {1, 2, 0}), {2, 0, 1}), y,
+                                       nullptr)
+                          ->getOutput();
+            auto o3 = g->addOp<ReluObj>(t(t(y, {1, 0, 2}), {0, 2, 1}), nullptr)
+                          ->getOutput();
+            return TensorVec{o1, o2, o3};
+        };
+        Graph ref = make_ref<GraphObj>(runtime), g = make_ref<GraphObj>(runtime);
+        auto refOutputs = build(ref), outputs = build(g);
+        g->optimize();
+
+        EXPECT_TRUE(g->checkValid());
+        // FusedElementwise(Add, Relu), Concat, MatMul, Mul, Relu, Transpose
+        EXPECT_EQ(g->getOperators().size(), 6u);
+        auto mm = as<MatmulObj>(outputs[0]->getSource());
+        EXPECT_TRUE(mm->getTransA());
+        EXPECT_EQ(mm->getInputs(0)->getSource()->getOpType(), OpType::Concat);
+        EXPECT_EQ(as<ConcatObj>(mm->getInputs(0)->getSource())->getDim(), 2);
+        EXPECT_FALSE(outputs[1]->getSource()->getInputs(0)->getSource());
+        auto transpose = as<TransposeObj>(outputs[2]->getSource());
+        ASSERT_EQ(transpose->getOpType(), OpType::Transpose);
+        EXPECT_EQ(transpose->getPermute(), (vector<int>{1, 2, 0}));
+        EXPECT_EQ(transpose->getInputs(0)->getSource()->getOpType(),
+                  OpType::Relu);
+
+        for (auto graph : {ref, g})
+        {
+            graph->dataMalloc();
+            for (auto &t : graph->getInputs())
+                t->setData(IncrementalGenerator());
+            runtime->run(graph);
+        }
+        for (size_t i = 0; i < outputs.size(); ++i)
+            EXPECT_TRUE(outputs[i]->equalData(refOutputs[i]));
+    }
+
+    // A Transpose read by element-wise ops becomes a view of its input, and
+    // stays a copy for a Concat, which needs contiguous inputs
+    TEST(Graph, MakeViews)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        auto build = [&](Graph g)
+        {
+            auto x = g->addTensor({2, 3, 4}, DataType::Float32);
+            auto y = g->addTensor({2, 4, 3}, DataType::Float32);
+            auto z = g->addTensor({2, 4, 3}, DataType::Float32);
+            auto t = g->addOp<TransposeObj>(x, nullptr, vector<int>{0, 2, 1})
+                         ->getOutput();
+            auto a = g->addOp<AddObj>(t, y, nullptr)->getOutput();
+            auto o1 = g->addOp<ReluObj>(a, nullptr)->getOutput();
+            auto o2 = g->addOp<ConcatObj>(TensorVec{t, z}, nullptr, 1)
+                          ->getOutput();
+            auto u = g->addOp<TransposeObj>(y, nullptr, vector<int>{2, 1, 0})
+                         ->getOutput();
+            auto w = g->addTensor({3, 4, 2}, DataType::Float32);
+            auto o3 = g->addOp<MulObj>(u, w, nullptr)->getOutput();
+            return TensorVec{o1, o2, o3};
+        };
+        Graph ref = make_ref<GraphObj>(runtime), g = make_ref<GraphObj>(runtime);
+        auto refOutputs = build(ref), outputs = build(g);
+        g->optimize();
+
+        EXPECT_TRUE(g->checkValid());
+        // Transpose (copy), Transpose (view), FusedElementwise(Add, Relu),
+        // Concat, Transpose (view), Mul
+        EXPECT_EQ(g->getOperators().size(), 6u);
+        auto fused = outputs[0]->getSource();
+        ASSERT_EQ(fused->getOpType(), OpType::FusedElementwise);
+        auto view = fused->getInputs(0);
+        EXPECT_TRUE(view->isView());
+        EXPECT_EQ(view->getStrides(), (vector<size_t>{12, 1, 4}));
+        auto concatInput = outputs[1]->getSource()->getInputs(0);
+        EXPECT_FALSE(concatInput->isView());
+        EXPECT_EQ(concatInput->getSource()->getOpType(), OpType::Transpose);
+        EXPECT_EQ(view->getViewBase(),
+                  concatInput->getSource()->getInputs(0));
+        auto u = outputs[2]->getSource()->getInputs(0);
+        EXPECT_TRUE(u->isView());
+        EXPECT_EQ(u->getStrides(), (vector<size_t>{1, 3, 12}));
+
+        for (auto graph : {ref, g})
+        {
+            graph->dataMalloc();
+            for (auto &t : graph->getInputs())
+                t->setData(IncrementalGenerator());
+            runtime->run(graph);
+        }
+        EXPECT_EQ(u->getRawDataPtr<void *>(),
+                  u->getViewBase()->getRawDataPtr<void *>());
+        for (size_t i = 0; i < outputs.size(); ++i)
+            EXPECT_TRUE(outputs[i]->equalData(refOutputs[i]));
+    }
+
+    // The constant subgraphs computing the weight and the bias of a MatMul are
+    // evaluated by optimize(), and the constants end up in a page-aligned
+    // arena apart from the activations
+    TEST(Graph, FoldConstants)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        auto build = [&](Graph g, bool constant)
+        {
+            auto param = [&](Shape dims)
+            {
+                return constant ? g->addConstant(dims) : g->addTensor(dims);
+            };
+            auto x = g->addTensor({2, 4});
+            auto w = param({4, 8}), s = param({1}), b1 = param({8}),
+                 b2 = param({8});
+            auto scaled = g->addOp<MulObj>(w, s, nullptr)->getOutput();
+            auto bias = g->addOp<AddObj>(b1, b2, nullptr)->getOutput();
+            auto y = g->addOp<MatmulObj>(x, scaled, nullptr)->getOutput();
+            auto o = g->addOp<AddObj>(y, bias, nullptr)->getOutput();
+            return TensorVec{x, w, s, b1, b2, o};
+        };
+        auto fill = [](const TensorVec &tensors)
+        {
+            for (int k = 1; k < 5; ++k)
+                tensors[k]->setData([k](void *ptr, size_t n, DataType)
+                                    {
+                                        for (size_t i = 0; i < n; ++i)
+                                            static_cast<float *>(ptr)[i] =
+                                                float((i * 7 + k) % 11) * 0.25f - 1;
+                                    });
+        };
+        Graph ref = make_ref<GraphObj>(runtime), g = make_ref<GraphObj>(runtime);
+        auto refTensors = build(ref, false), tensors = build(g, true);
+        fill(tensors);
+        g->optimize();
+
+        ASSERT_EQ(g->getOperators().size(), 1u);
+        auto mm = as<MatmulObj>(g->getOperators()[0]);
+        ASSERT_EQ(mm->getOpType(), OpType::MatMul);
+        EXPECT_TRUE(mm->getInputs(1)->isConstant());
+        ASSERT_TRUE(mm->getBias());
+        EXPECT_TRUE(mm->getBias()->isConstant());
+        // x, the folded weight and bias, and o
+        EXPECT_EQ(g->getTensors().size(), 4u);
+        EXPECT_EQ(g->getInputs(), TensorVec{tensors[0]});
+        EXPECT_TRUE(g->checkValid());
+
+        g->dataMalloc();
+        auto weight = mm->getInputs(1)->getRawDataPtr<char *>(),
+             bias = mm->getBias()->getRawDataPtr<char *>();
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(std::min(weight, bias)) %
+                      sysconf(_SC_PAGESIZE),
+                  0u);
+        EXPECT_NE(weight, tensors[0]->getRawDataPtr<char *>());
+
+        ref->dataMalloc();
+        fill(refTensors);
+        for (auto graph : {ref, g})
+        {
+            graph->getInputs()[0]->setData(IncrementalGenerator());
+            runtime->run(graph);
+        }
+        EXPECT_TRUE(tensors[5]->equalData(refTensors[5]));
+    }
+
+    // An imported model of 200k ops is built, optimized and validated in about
+    // a second; a step quadratic in the size of the graph would take minutes
+    TEST(Graph, LargeGraph)
+    {
+        const int blocks = 50000;
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        auto begin = std::chrono::steady_clock::now();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto x = g->addTensor({1, 4}, DataType::Float32);
+        for (int i = 0; i < blocks; ++i)
+        {
+            auto w = g->addTensor({4, 4}, DataType::Float32);
+            auto b = g->addTensor({4}, DataType::Float32);
+            auto wt = g->addOp<TransposeObj>(w, nullptr, vector<int>{1, 0});
+            auto y = g->addOp<MatmulObj>(x, wt->getOutput(), nullptr);
+            auto z = g->addOp<AddObj>(y->getOutput(), b, nullptr);
+            x = g->addOp<ReluObj>(z->getOutput(), nullptr)->getOutput();
+        }
+        EXPECT_EQ(g->getOperators().size(), size_t(4 * blocks));
+        g->optimize();
+        EXPECT_TRUE(g->checkValid());
+        g->shape_infer();
+        EXPECT_TRUE(g->topo_sort());
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - begin)
+                             .count();
+
+        EXPECT_EQ(g->getOperators().size(), size_t(blocks));
+        // the input, the weights and biases, and the output of every MatMul
+        EXPECT_EQ(g->getTensors().size(), size_t(3 * blocks + 1));
+        for (auto &t : g->getTensors())
+            EXPECT_EQ(g->getTensor(t->getFuid()), t);
+        EXPECT_EQ(g->getOutputs(), TensorVec{x});
+        // a loose bound, for unoptimized and instrumented builds
+        EXPECT_LT(seconds, 10.0);
+    }
+
+    TEST(Graph, FlatGraph)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({4, 4}, DataType::Float32);
+        Tensor a = g->addTensor({4, 4}, DataType::Float32);
+        Tensor b = g->addTensor({4, 4}, DataType::Float32);
+        Tensor y = g->addTensor({4, 4}, DataType::Float32);
+        auto relu = g->addOpWithOutputs<ReluObj>(x, a);
+        auto add = g->addOpWithOutputs<AddObj>(a, a, b);
+        auto mul = g->addOpWithOutputs<MulObj>(a, b, y);
+
+        FlatGraph flat(*g);
+        ASSERT_EQ(flat.numOps(), 3u);
+        ASSERT_EQ(flat.numTensors(), 4u);
+        auto id = [&](const auto &ref) { return flat.getId(ref.get()); };
+        auto ids = [](FlatGraph::IdRange range) {
+            return vector<FlatGraph::Id>(range.begin(), range.end());
+        };
+        using Ids = vector<FlatGraph::Id>;
+        EXPECT_EQ(flat.getOp(id(add)), add.get());
+        EXPECT_EQ(flat.getTensor(id(b)), b.get());
+
+        EXPECT_EQ(ids(flat.getInputs(id(add))), (Ids{id(a), id(a)}));
+        EXPECT_EQ(ids(flat.getOutputs(id(mul))), Ids{id(y)});
+        EXPECT_EQ(flat.getSource(id(x)), FlatGraph::none);
+        EXPECT_EQ(flat.getSource(id(b)), id(add));
+        // once per occurrence
+        EXPECT_EQ(ids(flat.getTargets(id(a))),
+                  (Ids{id(add), id(add), id(mul)}));
+        EXPECT_TRUE(flat.getTargets(id(y)).empty());
+        // once per op
+        EXPECT_EQ(ids(flat.getPredecessors(id(mul))), (Ids{id(relu), id(add)}));
+        EXPECT_EQ(ids(flat.getSuccessors(id(relu))), (Ids{id(add), id(mul)}));
+        EXPECT_TRUE(flat.getPredecessors(id(relu)).empty());
+        EXPECT_TRUE(flat.getSuccessors(id(mul)).empty());
+    }
+
+    // Branches of a large and a small MatMul, concatenated. Built breadth
+    // first, every large activation is live at once; depth first, only one is
+    TEST(Graph, ScheduleForMemory)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        auto build = [&](Graph g, int branches)
+        {
+            auto x = g->addTensor({8, 64}, DataType::Float32);
+            TensorVec hidden, heads;
+            for (int i = 0; i < branches; ++i)
+            {
+                auto w = g->addTensor({64, 256}, DataType::Float32);
+                hidden.emplace_back(
+                    g->addOp<MatmulObj>(x, w, nullptr)->getOutput());
+            }
+            for (auto &h : hidden)
+            {
+                auto w = g->addTensor({256, 4}, DataType::Float32);
+                heads.emplace_back(
+                    g->addOp<MatmulObj>(h, w, nullptr)->getOutput());
+            }
+            return g->addOp<ConcatObj>(heads, nullptr, 1)->getOutput();
+        };
+        auto check = [&](int branches, size_t exactLimit)
+        {
+            Graph ref = make_ref<GraphObj>(runtime),
+                  g = make_ref<GraphObj>(runtime);
+            auto refOutput = build(ref, branches), output = build(g, branches);
+            auto schedule = schedule_for_memory(*g, exactLimit);
+            EXPECT_TRUE(g->checkValid());
+            EXPECT_TRUE(g->topo_sort());
+            EXPECT_EQ(g->getOutputs(), TensorVec{output});
+
+            for (auto graph : {ref, g})
+            {
+                graph->dataMalloc();
+                for (auto &t : graph->getInputs())
+                    t->setData(IncrementalGenerator());
+                runtime->run(graph);
+            }
+            EXPECT_TRUE(output->equalData(refOutput));
+            return schedule;
+        };
+
+        // 9 ops, in reach of the exact schedule
+        auto exact = check(4, 16), greedy = check(4, 0);
+        EXPECT_TRUE(exact.exact);
+        EXPECT_FALSE(greedy.exact);
+        EXPECT_EQ(exact.peakBefore, greedy.peakBefore);
+        EXPECT_LT(exact.peakAfter, exact.peakBefore);
+        EXPECT_LE(exact.peakAfter, greedy.peakAfter);
+
+        // a hidden activation and the heads are live instead of every hidden
+        // one, next to the inputs
+        auto large = check(32, 16);
+        EXPECT_FALSE(large.exact);
+        EXPECT_GE(large.peakBefore - large.peakAfter,
+                  30 * 8 * 256 * sizeof(float));
+
+        // an order that is already optimal is kept
+        Graph g = make_ref<GraphObj>(runtime);
+        build(g, 1);
+        auto ops = g->getOperators();
+        auto kept = schedule_for_memory(*g);
+        EXPECT_EQ(kept.peakAfter, kept.peakBefore);
+        EXPECT_EQ(g->getOperators(), ops);
+
+        // optimize() reports the peaks of its schedule
+        g = make_ref<GraphObj>(runtime);
+        build(g, 32);
+        auto stats = g->optimize();
+        ASSERT_EQ(stats.back().name, "ScheduleForMemory");
+        EXPECT_EQ(stats.back().rewrites, 1u);
+        EXPECT_EQ(stats.back().peakBefore - stats.back().peakAfter,
+                  large.peakBefore - large.peakAfter);
+    }
+
+    // h is released by its last reader, Mul, which then goes before the Matmul
+    // allocating d although it allocates more: the topological order runs the
+    // Matmul first, while h is still live
+    TEST(Graph, ScheduleForMemoryReleases)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        auto build = [&](Graph g)
+        {
+            auto x = g->addTensor({64, 256}, DataType::Float32);
+            auto wc = g->addTensor({256, 1}, DataType::Float32);
+            auto wd = g->addTensor({1, 8}, DataType::Float32);
+            auto h = g->addOp<ReluObj>(x, nullptr)->getOutput();
+            auto c = g->addOp<MatmulObj>(h, wc, nullptr)->getOutput();
+            auto d = g->addOp<MatmulObj>(c, wd, nullptr)->getOutput();
+            auto a = g->addOp<MulObj>(h, c, nullptr)->getOutput();
+            return TensorVec{d, a};
+        };
+        Graph ref = make_ref<GraphObj>(runtime),
+              exact = make_ref<GraphObj>(runtime),
+              g = make_ref<GraphObj>(runtime);
+        auto refOutputs = build(ref);
+        build(exact);
+        auto outputs = build(g);
+        auto best = schedule_for_memory(*exact);
+        auto greedy = schedule_for_memory(*g, 0);
+        EXPECT_FALSE(greedy.exact);
+        // d, 2 KiB, is allocated after h, 64 KiB, is released
+        EXPECT_EQ(greedy.peakBefore - greedy.peakAfter, 64 * 8 * sizeof(float));
+        EXPECT_EQ(greedy.peakAfter, best.peakAfter);
+        auto &ops = g->getOperators();
+        auto position = [&](const Tensor &t)
+        {
+            return std::find(ops.begin(), ops.end(), t->getSource()) -
+                   ops.begin();
+        };
+        EXPECT_LT(position(outputs[1]), position(outputs[0]));
+
+        for (auto graph : {ref, g})
+        {
+            graph->dataMalloc();
+            for (auto &t : graph->getInputs())
+                t->setData(IncrementalGenerator());
+            runtime->run(graph);
+        }
+        for (size_t i = 0; i < outputs.size(); ++i)
+            EXPECT_TRUE(outputs[i]->equalData(refOutputs[i]));
+    }
+}
@@ -0,0 +1,240 @@
+#include "core/graph.h"
+#include "core/plan.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+#include "utils/cpu_features.h"
+#include "utils/parallel.h"
+
+#include "test.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+// Every allocation of the process, to check that the kernels run without any
+static std::atomic<size_t> allocations{0};
+
+// GCC pairs the replaced operator new with free() once they are inlined
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void *operator new(size_t size)
+{
+    ++allocations;
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+namespace infini
+{
+    // A small graph touching every CPU kernel, and its output
+    static Tensor buildGraph(Graph g)
+    {
+        auto a = g->addTensor({2, 3, 8}, DataType::Float32);
+        auto b = g->addTensor({8, 5}, DataType::Float32);
+        auto bias = g->addTensor({5}, DataType::Float32);
+        auto mm = g->addOp<MatmulObj>(a, b, nullptr)->getOutput();
+        auto add = g->addOp<AddObj>(mm, bias, nullptr)->getOutput();
+        auto relu = g->addOp<ReluObj>(add, nullptr)->getOutput();
+        auto t = g->addOp<TransposeObj>(relu, nullptr, vector<int>{0, 2, 1})
+                     ->getOutput();
+        auto cat = g->addOp<ConcatObj>(TensorVec{t, t}, nullptr, 1)
+                       ->getOutput();
+        auto clip =
+            g->addOp<ClipObj>(cat, nullptr, -1.0f, 20.0f)->getOutput();
+        auto half =
+            g->addOp<CastObj>(clip, nullptr, CastType::Float2Float16)
+                ->getOutput();
+        return g->addOp<CastObj>(half, nullptr, CastType::Float162Float)
+            ->getOutput();
+    }
+
+    TEST(Plan, MatchesRun)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto output = buildGraph(g);
+        g->dataMalloc();
+        for (auto &tensor : g->getTensors())
+            if (!tensor->getSource())
+                tensor->setData(IncrementalGenerator());
+
+        runtime->run(g);
+        auto size = output->size();
+        auto ptr = output->getRawDataPtr<float *>();
+        vector<float> ans(ptr, ptr + size);
+        std::fill(ptr, ptr + size, 0.0f);
+
+        Plan plan = runtime->compile(g);
+        EXPECT_EQ(plan->size(), g->getOperators().size());
+        plan->run();
+        EXPECT_TRUE(output->equalData(ans));
+    }
+
+    // Independent heads reading the same input, concatenated. dataMalloc
+    // reuses the memory of the heads across branches, so the plan has to
+    // order those steps as well.
+    TEST(Plan, ConcurrentBranches)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto x = g->addTensor({4, 32}, DataType::Float32);
+        TensorVec heads;
+        for (int i = 0; i < 6; ++i)
+        {
+            auto w = g->addTensor({32, 16}, DataType::Float32);
+            auto b = g->addTensor({16}, DataType::Float32);
+            auto h = g->addOp<MatmulObj>(x, w, nullptr)->getOutput();
+            h = g->addOp<ReluObj>(h, nullptr)->getOutput();
+            h = g->addOp<SubObj>(h, b, nullptr)->getOutput();
+            heads.emplace_back(
+                g->addOp<ClipObj>(h, nullptr, 0.0f, 1e6f)->getOutput());
+        }
+        auto output = g->addOp<ConcatObj>(heads, nullptr, 0)->getOutput();
+        g->dataMalloc();
+        for (auto &tensor : g->getTensors())
+            if (!tensor->getSource())
+                tensor->setData(IncrementalGenerator());
+
+        Plan plan = runtime->compile(g);
+        set_num_threads(1);
+        plan->run();
+        auto ptr = output->getRawDataPtr<float *>();
+        vector<float> ans(ptr, ptr + output->size());
+        set_num_threads(4);
+        for (int i = 0; i < 50; ++i)
+        {
+            std::fill(ptr, ptr + output->size(), 0.0f);
+            plan->run();
+            EXPECT_TRUE(output->equalData(ans));
+            // through the plan run() keeps as well
+            std::fill(ptr, ptr + output->size(), 0.0f);
+            runtime->run(g);
+            EXPECT_TRUE(output->equalData(ans));
+        }
+        set_num_threads(0);
+    }
+
+    // run() compiles the graph again once it changed, here the order of its
+    // ops
+    TEST(Plan, RunRecompiles)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto x = g->addTensor({2, 3}, DataType::Float32);
+        g->addOp<ReluObj>(x, nullptr);
+        g->addOp<ClipObj>(x, nullptr, 0.0f, 1.0f);
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+
+        auto &profiler = runtime->getProfiler();
+        auto order = [&]
+        {
+            profiler.clear();
+            runtime->run(g, true);
+            vector<OpType> types;
+            for (auto &record : profiler.getRecords())
+                types.emplace_back(record.opType);
+            return types;
+        };
+        EXPECT_EQ(order(), (vector<OpType>{OpType::Relu, OpType::Clip}));
+        g->reorder({1, 0});
+        EXPECT_EQ(order(), (vector<OpType>{OpType::Clip, OpType::Relu}));
+        profiler.clear();
+
+        // and once the kernels it would pick changed
+        Plan plan = runtime->compile(g);
+        EXPECT_FALSE(plan->isStale());
+        auto &registry = KernelRegistry::getInstance();
+        registry.setTuning(registry.isTuning());
+        EXPECT_TRUE(plan->isStale());
+        plan = runtime->compile(g);
+        auto isa = get_cpu_isa();
+        set_max_cpu_isa(isa == CpuIsa::Scalar ? CpuIsa::SSE : CpuIsa::Scalar);
+        EXPECT_EQ(plan->isStale(), get_cpu_isa() != isa);
+        set_max_cpu_isa(CpuIsa::AVX512);
+    }
+
+    // Per-op dispatch cost of a small graph, through RuntimeObj::run and its
+    // cached plan, and through a plan compiled apart
+    TEST(Plan, DispatchBenchmark)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        buildGraph(g);
+        g->dataMalloc();
+        Plan plan = runtime->compile(g);
+
+        const int iterations = 2000;
+        auto time = [&](auto &&f)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i)
+                f();
+            std::chrono::duration<double, std::micro> d =
+                std::chrono::steady_clock::now() - begin;
+            return d.count() / iterations / plan->size();
+        };
+        auto count = [&](auto &&f)
+        {
+            size_t before = allocations;
+            f();
+            return double(allocations - before) / plan->size();
+        };
+        double byRun = time([&]
+                            { runtime->run(g); });
+        double byPlan = time([&]
+                             { plan->run(); });
+        printf("us per op: run %.3f, plan %.3f\n", byRun, byPlan);
+        printf("allocations per op: run %.2f, plan %.2f\n",
+               count([&]
+                     { runtime->run(g); }),
+               count([&]
+                     { plan->run(); }));
+    }
+
+    // Once compiled, the kernels run without touching the heap
+    TEST(Plan, NoAllocations)
+    {
+        set_num_threads(1);
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        buildGraph(g);
+        g->dataMalloc();
+        Plan plan = runtime->compile(g);
+        plan->run();
+
+        size_t before = allocations;
+        plan->run();
+        EXPECT_EQ(allocations - before, 0u);
+        // and so does run(), once it has compiled the plan it keeps
+        runtime->run(g);
+        before = allocations;
+        runtime->run(g);
+        EXPECT_EQ(allocations - before, 0u);
+
+        // and so does a fused element-wise program
+        Graph fused = make_ref<GraphObj>(runtime);
+        auto x = fused->addTensor({4, 300}, DataType::Float32);
+        auto y = fused->addTensor({300}, DataType::Float32);
+        auto add = fused->addOp<AddObj>(x, y, nullptr)->getOutput();
+        fused->addOp<ReluObj>(add, nullptr);
+        fused->optimize();
+        ASSERT_EQ(fused->getOperators()[0]->getOpType(),
+                  OpType::FusedElementwise);
+        fused->dataMalloc();
+        plan = runtime->compile(fused);
+        plan->run();
+        before = allocations;
+        plan->run();
+        EXPECT_EQ(allocations - before, 0u);
+        set_num_threads(0);
+    }
+
+} // namespace infini
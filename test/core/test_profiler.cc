@@ -0,0 +1,79 @@
+#include "core/graph.h"
+#include "core/plan.h"
+#include "core/runtime.h"
+#include "operators/element_wise.h"
+#include "operators/fused_element_wise.h"
+#include "operators/matmul.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini
+{
+    TEST(Profiler, OpCost)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({2, 3, 4}, DataType::Float32);
+        auto b = g->addTensor({4, 5}, DataType::Float32);
+        auto mm = g->addOp<MatmulObj>(a, b, nullptr);
+        auto relu = g->addOp<ReluObj>(mm->getOutput(), nullptr);
+        auto cost = get_op_cost(mm);
+        EXPECT_EQ(cost.flops, 2.0 * 2 * 3 * 5 * 4);
+        EXPECT_EQ(cost.bytes, 4.0 * (24 + 20 + 30));
+        EXPECT_EQ(get_op_cost(relu).flops, 30);
+
+        // a fused epilogue costs one more per stage
+        auto bias = g->addTensor({5}, DataType::Float32);
+        auto fusedMm = g->addOp<MatmulObj>(a, b, nullptr, false, false, bias,
+                                           ActType::Relu);
+        EXPECT_EQ(get_op_cost(fusedMm).flops, 2.0 * 2 * 3 * 5 * 4 + 2 * 30);
+
+        // and a fused element-wise op one per step
+        Graph fused = make_ref<GraphObj>(runtime);
+        auto x = fused->addTensor({4, 8}, DataType::Float32);
+        auto y = fused->addTensor({8}, DataType::Float32);
+        auto add = fused->addOp<AddObj>(x, y, nullptr)->getOutput();
+        fused->addOp<ReluObj>(add, nullptr);
+        fused->optimize();
+        auto op = fused->getOperators()[0];
+        ASSERT_EQ(op->getOpType(), OpType::FusedElementwise);
+        EXPECT_EQ(get_op_cost(op).flops, 2 * 32);
+    }
+
+    TEST(Profiler, Report)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({64, 64}, DataType::Float32);
+        auto b = g->addTensor({64, 64}, DataType::Float32);
+        auto mm = g->addOp<MatmulObj>(a, b, nullptr)->getOutput();
+        auto add = g->addOp<AddObj>(mm, b, nullptr)->getOutput();
+        g->addOp<ReluObj>(add, nullptr);
+        g->dataMalloc();
+
+        auto &profiler = runtime->getProfiler();
+        profiler.clear();
+        profiler.setRoofline({100.0, 10.0});
+        runtime->run(g);
+        EXPECT_TRUE(profiler.getRecords().empty());
+
+        runtime->run(g, true);
+        runtime->compile(g)->run(true);
+        auto records = profiler.getRecords();
+        ASSERT_EQ(records.size(), 6u);
+        EXPECT_EQ(records[0].opType, OpType::MatMul);
+        EXPECT_EQ(records[0].kernel, "MatmulBlocked_CPU");
+        EXPECT_EQ(records[4].kernel, "addSimd_CPU");
+        for (auto &record : records)
+            EXPECT_GE(record.seconds, 0.0);
+
+        auto report = profiler.report();
+        EXPECT_NE(report.find("Roofline: 100.00 GFLOP/s, 10.00 GB/s"),
+                  string::npos);
+        EXPECT_NE(report.find("reluSimd_CPU"), string::npos);
+        std::cout << report;
+        profiler.clear();
+    }
+
+} // namespace infini
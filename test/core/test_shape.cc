@@ -0,0 +1,45 @@
+#include "core/tensor.h"
+#include "utils/operator_utils.h"
+
+#include "test.h"
+
+namespace infini
+{
+    TEST(Shape, InlineAndHeap)
+    {
+        Shape s{2, 3, 4};
+        EXPECT_EQ(s.size(), 3u);
+        EXPECT_EQ(s.capacity(), 8u);
+        for (int i = 0; i < 7; ++i)
+            s.emplace_back(i + 5);
+        // the tenth dim moves the shape to the heap
+        EXPECT_EQ(s.size(), 10u);
+        EXPECT_GT(s.capacity(), 8u);
+        EXPECT_EQ(s.back(), 11);
+
+        Shape copy = s, moved = std::move(s);
+        EXPECT_EQ(copy, moved);
+        EXPECT_TRUE(s.empty());
+        moved.erase(moved.begin() + 1, moved.end() - 1);
+        EXPECT_EQ(moved, (Shape{2, 11}));
+        moved.insert(moved.begin() + 1, 2, 1);
+        EXPECT_EQ(moved, (Shape{2, 1, 1, 11}));
+        moved.insert(moved.end(), copy.begin(), copy.begin() + 2);
+        EXPECT_EQ(moved, (Shape{2, 1, 1, 11, 2, 3}));
+        EXPECT_EQ(vecToString(moved), "[2,1,1,11,2,3]");
+    }
+
+    TEST(Shape, LargeExtents)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        // never allocated, only the shape is computed
+        auto t = make_ref<TensorObj>(Shape{1 << 16, 1 << 16, 2},
+                                     DataType::Float32, runtime);
+        EXPECT_EQ(t->size(), size_t(1) << 33);
+        EXPECT_EQ(t->getDims()[0] * t->getDims()[1], ShapeElem(1) << 32);
+        EXPECT_EQ(infer_broadcast({ShapeElem(1) << 32, 1}, {3}),
+                  (Shape{ShapeElem(1) << 32, 3}));
+        EXPECT_EQ(locate_index((size_t(1) << 32) + 5, {ShapeElem(1) << 33, 4}),
+                  (Shape{(ShapeElem(1) << 30) + 1, 1}));
+    }
+} // namespace infini
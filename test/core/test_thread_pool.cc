@@ -0,0 +1,43 @@
+#include "utils/parallel.h"
+#include "utils/thread_pool.h"
+
+#include "test.h"
+#include <numeric>
+
+namespace infini
+{
+    TEST(ThreadPool, NestedParallelFor)
+    {
+        set_num_threads(4);
+        // every outer chunk runs its own parallel loop on the same pool
+        vector<std::atomic<size_t>> sums(64);
+        parallel_for(sums.size(), 1, [&](size_t begin, size_t end)
+                     {
+            for (size_t i = begin; i < end; ++i)
+                parallel_for(1000, 10, [&](size_t b, size_t e)
+                             {
+                    size_t s = 0;
+                    for (size_t j = b; j < e; ++j)
+                        s += j * i;
+                    sums[i] += s; }); });
+        for (size_t i = 0; i < sums.size(); ++i)
+            EXPECT_EQ(sums[i].load(), i * 999 * 1000 / 2);
+        set_num_threads(0);
+    }
+
+    TEST(ThreadPool, TaskGroupException)
+    {
+        ThreadPool::getInstance().reserve(4);
+        TaskGroup group;
+        std::atomic<int> done{0};
+        for (int i = 0; i < 16; ++i)
+            group.run([&, i]
+                      {
+                if (i == 7)
+                    IT_TODO_HALT();
+                ++done; });
+        EXPECT_THROW(group.wait(), Exception);
+        EXPECT_EQ(done.load(), 15);
+    }
+
+} // namespace infini
@@ -0,0 +1,76 @@
+#include "core/graph.h"
+#include "core/plan.h"
+#include "core/runtime.h"
+#include "core/tracer.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/unary.h"
+#include "utils/parallel.h"
+
+#include "test.h"
+#include <cstdio>
+#include <fstream>
+
+namespace infini
+{
+    static size_t countOf(const string &s, const string &pattern)
+    {
+        size_t n = 0;
+        for (auto pos = s.find(pattern); pos != string::npos;
+             pos = s.find(pattern, pos + 1))
+            ++n;
+        return n;
+    }
+
+    TEST(Tracer, Timeline)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto x = g->addTensor({4, 32}, DataType::Float32);
+        TensorVec heads;
+        for (int i = 0; i < 4; ++i)
+        {
+            auto w = g->addTensor({32, 16}, DataType::Float32);
+            auto h = g->addOp<MatmulObj>(x, w, nullptr)->getOutput();
+            heads.emplace_back(g->addOp<ReluObj>(h, nullptr)->getOutput());
+        }
+        auto concat = g->addOp<ConcatObj>(heads, nullptr, 0);
+
+        auto &tracer = Tracer::getInstance();
+        tracer.start();
+        g->dataMalloc();
+        runtime->run(g);
+        Plan plan = runtime->compile(g);
+        set_num_threads(4);
+        plan->run();
+        set_num_threads(0);
+        tracer.stop();
+        // nothing is recorded once stopped
+        runtime->run(g);
+
+        auto json = tracer.toJson();
+        EXPECT_EQ(json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["),
+                  0u);
+        // both runs of the 9 ops
+        EXPECT_EQ(countOf(json, "\"ph\":\"X\""), 18u);
+        EXPECT_EQ(countOf(json, "\"kernel\":\"MatmulBlocked_CPU\""), 8u);
+        EXPECT_EQ(countOf(json, "\"kernel\":\"reluSimd_CPU\""), 8u);
+        EXPECT_EQ(countOf(json, "\"guid\":" +
+                                    std::to_string(concat->getGuid())),
+                  2u);
+        EXPECT_NE(json.find("\"inputs\":[[4,32],[32,16]],\"outputs\":[[4,16]]"),
+                  string::npos);
+        // an allocation per tensor and the frees of the dead ones
+        EXPECT_GE(countOf(json, "\"name\":\"allocator\""),
+                  g->getTensors().size());
+        EXPECT_NE(json.find("\"ph\":\"C\""), string::npos);
+        auto path = tempTestPath(".json");
+        tracer.save(path);
+        std::ifstream file(path);
+        EXPECT_EQ(string(std::istreambuf_iterator<char>(file), {}), json);
+        file.close();
+        std::remove(path.c_str());
+    }
+
+} // namespace infini
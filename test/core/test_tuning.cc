@@ -0,0 +1,113 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/runtime.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+
+#include "test.h"
+#include <cstdio>
+#include <fstream>
+
+namespace infini
+{
+    TEST(Tuning, WorkloadVector)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({4, 8}, DataType::Float32);
+        auto b = g->addTensor({8, 8}, DataType::Float32);
+        auto mm0 = g->addOp<MatmulObj>(a, b, nullptr);
+        auto mm1 = g->addOp<MatmulObj>(a, b, nullptr);
+        auto mm2 = g->addOp<MatmulObj>(a, b, nullptr, false, true);
+        auto t = g->addOp<TransposeObj>(a, nullptr, vector<int>{1, 0});
+        EXPECT_EQ(mm0->getWorkloadVector(), mm1->getWorkloadVector());
+        EXPECT_NE(mm0->getWorkloadVector(), mm2->getWorkloadVector());
+        EXPECT_EQ(t->getWorkloadVector(),
+                  (vector<int64_t>{OpType::Transpose, 2, 1, 0, 1, 2, 4, 8}));
+    }
+
+    // Every candidate of MatMul and Transpose computes the same result
+    TEST(Tuning, Candidates)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({3, 70, 300}, DataType::Float32);
+        auto b = g->addTensor({300, 50}, DataType::Float32);
+        auto mm = g->addOp<MatmulObj>(a, b, nullptr);
+        auto t = g->addOp<TransposeObj>(a, nullptr, vector<int>{0, 2, 1});
+        g->dataMalloc();
+        a->setData(IncrementalGenerator());
+        b->setData(IncrementalGenerator());
+
+        const auto &registry = KernelRegistry::getInstance();
+        for (auto &op : {Operator(mm), Operator(t)})
+        {
+            auto candidates = registry.getKernelCandidates(
+                KernelAttrs{Device::CPU, op->getOpType().underlying(),
+                            DataType::Float32});
+            ASSERT_EQ(candidates.size(), 3u);
+            auto output = op->getOutput();
+            auto ptr = output->getRawDataPtr<float *>();
+            std::get<0>(*candidates[0])->compute(op, runtime.get());
+            vector<float> ans(ptr, ptr + output->size());
+            for (auto candidate : candidates)
+            {
+                std::fill(ptr, ptr + output->size(), 0.0f);
+                std::get<0>(*candidate)->compile(op, runtime.get())();
+                EXPECT_TRUE(output->equalData(ans)) << std::get<1>(*candidate);
+            }
+        }
+    }
+
+    TEST(Tuning, Cache)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto a = g->addTensor({64, 256}, DataType::Float32);
+        auto b = g->addTensor({256, 64}, DataType::Float32);
+        auto c = g->addTensor({64, 128}, DataType::Float32);
+        auto mm = g->addOp<MatmulObj>(a, b, nullptr);
+        g->addOp<MatmulObj>(a, b, nullptr);
+        auto other = g->addOp<MatmulObj>(b, c, nullptr);
+        g->dataMalloc();
+
+        auto &registry = KernelRegistry::getInstance();
+        const string path = tempTestPath(".txt");
+        registry.clearTuning();
+        registry.setTuningCache(path);
+        runtime->run(g);
+        runtime->compile(g);
+        registry.setTuning(false);
+
+        // one line per distinct workload, the second run found them tuned
+        std::ifstream file(path);
+        vector<string> keys, names;
+        string key, name;
+        while (file >> key >> name)
+        {
+            keys.emplace_back(key);
+            names.emplace_back(name);
+        }
+        ASSERT_EQ(keys.size(), 2u);
+        EXPECT_EQ(keys[0], "CPU:" + vecToString(mm->getWorkloadVector()));
+        EXPECT_EQ(keys[1], "CPU:" + vecToString(other->getWorkloadVector()));
+        for (auto &n : names)
+            EXPECT_EQ(n.rfind("MatmulBlocked", 0), 0u);
+
+        // a later process reads the winners back instead of tuning
+        {
+            std::ofstream out(path, std::ios::app);
+            out << keys[0] << " MatmulBlockedK128_CPU\n";
+        }
+        registry.clearTuning();
+        registry.setTuningCache(path);
+        EXPECT_EQ(std::get<1>(registry.selectKernel(mm, runtime.get())),
+                  "MatmulBlockedK128_CPU");
+        registry.setTuning(false);
+        EXPECT_EQ(std::get<1>(registry.selectKernel(mm, runtime.get())),
+                  "MatmulBlocked_CPU");
+        registry.clearTuning();
+        std::remove(path.c_str());
+    }
+
+} // namespace infini
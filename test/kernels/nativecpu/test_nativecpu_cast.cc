@@ -0,0 +1,129 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/unary.h"
+#include "utils/cpu_features.h"
+#include "utils/data_convert.h"
+#include "utils/parallel.h"
+
+#include "test.h"
+
+namespace infini {
+
+// Runs a cast of `input` for every instruction set and thread count and
+// checks the result against `ans`
+template <typename From, typename To>
+static void testCast(CastType type, DataType dtype, const vector<From> &input,
+                     const vector<To> &ans) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto i = g->addTensor({int(input.size())}, dtype);
+    auto op = g->addOp<CastObj>(i, nullptr, type);
+    g->dataMalloc();
+    std::copy(input.begin(), input.end(), i->getRawDataPtr<From *>());
+    for (auto isa :
+         {CpuIsa::Scalar, CpuIsa::SSE, CpuIsa::AVX2, CpuIsa::AVX512})
+        for (int nThreads : {1, 3}) {
+            set_max_cpu_isa(isa);
+            set_num_threads(nThreads);
+            runtime->run(g);
+            auto out = op->getOutput()->getRawDataPtr<To *>();
+            EXPECT_TRUE(std::memcmp(out, ans.data(), ans.size() * sizeof(To)) ==
+                        0)
+                << cpu_isa_to_str(isa);
+        }
+    set_max_cpu_isa(CpuIsa::AVX512);
+    set_num_threads(0);
+}
+
+static float bitsToFloat(uint32_t u) {
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+TEST(Cast, DataConvert) {
+    // exact values, ties to even, overflow, subnormals and specials
+    EXPECT_EQ(float_to_fp16(1.0f), 0x3c00);
+    EXPECT_EQ(float_to_fp16(-2.0f), 0xc000);
+    EXPECT_EQ(float_to_fp16(65504.0f), 0x7bff);
+    EXPECT_EQ(float_to_fp16(65519.0f), 0x7bff);
+    EXPECT_EQ(float_to_fp16(65520.0f), 0x7c00);
+    EXPECT_EQ(float_to_fp16(1.0f + 0x1p-11f), 0x3c00);
+    EXPECT_EQ(float_to_fp16(1.0f + 0x3p-11f), 0x3c02);
+    EXPECT_EQ(float_to_fp16(0x1p-24f), 0x0001);
+    EXPECT_EQ(float_to_fp16(0x1p-25f), 0x0000);
+    EXPECT_EQ(float_to_fp16(0x3p-25f), 0x0002);
+    EXPECT_EQ(float_to_fp16(-0.0f), 0x8000);
+    EXPECT_EQ(float_to_fp16(INFINITY), 0x7c00);
+    EXPECT_EQ(float_to_fp16(NAN) & 0x7e00, 0x7e00);
+    EXPECT_EQ(float_to_bf16(1.0f + 0x1p-8f), 0x3f80);
+    EXPECT_EQ(float_to_bf16(1.0f + 0x3p-8f), 0x3f82);
+    EXPECT_EQ(float_to_bf16(bitsToFloat(0x7f800001)), 0x7fc0);
+    // every half but the NaNs survives a round trip
+    for (uint32_t h = 0; h < 0x10000; ++h) {
+        if ((h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0)
+            continue;
+        EXPECT_EQ(float_to_fp16(fp16_to_float(h)), h);
+    }
+}
+
+TEST(Cast, NativeCpuHalf) {
+    // floats spread over the whole range, with random low bits
+    vector<float> input;
+    std::mt19937 gen(0);
+    for (uint32_t e = 0; e < 0x200; ++e)
+        for (int j = 0; j < 37; ++j)
+            input.emplace_back(bitsToFloat((e << 23) | (gen() & 0x7fffff)));
+    vector<uint16_t> halves(input.size()), bf16s(input.size());
+    vector<float> fromHalves(input.size()), fromBf16s(input.size());
+    for (size_t i = 0; i < input.size(); ++i) {
+        halves[i] = float_to_fp16(input[i]);
+        bf16s[i] = float_to_bf16(input[i]);
+        fromHalves[i] = fp16_to_float(halves[i]);
+        fromBf16s[i] = bf16_to_float(bf16s[i]);
+    }
+    testCast(CastType::Float2Float16, DataType::Float32, input, halves);
+    testCast(CastType::Float2BFloat16, DataType::Float32, input, bf16s);
+    testCast(CastType::Float162Float, DataType::Float16, halves, fromHalves);
+    testCast(CastType::BFloat162Float, DataType::BFloat16, bf16s, fromBf16s);
+}
+
+TEST(Cast, NativeCpuIntegers) {
+    testCast(CastType::Float2Int32, DataType::Float32,
+             vector<float>{-2.5f, -1.0f, 0.0f, 0.75f, 3.5f, 1e6f},
+             vector<int32_t>{-2, -1, 0, 0, 3, 1000000});
+    testCast(CastType::Float2Int8, DataType::Float32,
+             vector<float>{-128.0f, -1.5f, 127.9f},
+             vector<int8_t>{-128, -1, 127});
+    // out of range values saturate, NaN becomes 0
+    testCast(CastType::Float2Int8, DataType::Float32,
+             vector<float>{-1e10f, -129.0f, 128.0f, 300.5f, INFINITY, NAN},
+             vector<int8_t>{-128, -128, 127, 127, 127, 0});
+    testCast(CastType::Float2Int32, DataType::Float32,
+             vector<float>{-0x1p31f, -0x1p40f, 0x1p31f, 2147483520.0f,
+                           -INFINITY, NAN},
+             vector<int32_t>{std::numeric_limits<int32_t>::min(),
+                             std::numeric_limits<int32_t>::min(),
+                             std::numeric_limits<int32_t>::max(), 2147483520,
+                             std::numeric_limits<int32_t>::min(), 0});
+    testCast(CastType::Float2Int64, DataType::Float32,
+             vector<float>{0x1p63f, -0x1p70f, 0x1p62f, NAN},
+             vector<int64_t>{std::numeric_limits<int64_t>::max(),
+                             std::numeric_limits<int64_t>::min(),
+                             int64_t(1) << 62, 0});
+    testCast(CastType::Int642Uint32, DataType::Int64,
+             vector<int64_t>{-1, 0, 1ll << 33 | 5},
+             vector<uint32_t>{0xffffffffu, 0, 5});
+    testCast(CastType::Int322Int8, DataType::Int32, vector<int32_t>{-1, 255, 7},
+             vector<int8_t>{-1, -1, 7});
+    testCast(CastType::Uint82Float, DataType::UInt8, vector<uint8_t>{0, 200},
+             vector<float>{0.0f, 200.0f});
+    testCast(CastType::Int82Int16, DataType::Int8, vector<int8_t>{-3, 4},
+             vector<int16_t>{-3, 4});
+    testCast(CastType::Uint322Int64, DataType::UInt32,
+             vector<uint32_t>{0xffffffffu}, vector<int64_t>{0xffffffffll});
+    testCast(CastType::Int642Float, DataType::Int64,
+             vector<int64_t>{-(1ll << 40)}, vector<float>{-0x1p40f});
+}
+
+} // namespace infini
@@ -1,6 +1,7 @@
 #include "core/graph.h"
 #include "core/runtime.h"
 #include "operators/concat.h"
+#include "utils/parallel.h"
 
 #include "test.h"
 
@@ -34,4 +35,47 @@ TEST(Concat, NativeCpu) {
                       6, 7, 8, 1, 1, 1, 9, 10, 11, 1, 1, 1}));
 }
 
+// out[o][j][k] of a concatenation along dim 1 of inputs filled with
+// IncrementalGenerator, with the input index in the top bits
+static vector<uint32_t> concatReference(size_t outer,
+                                        const vector<size_t> &extents,
+                                        size_t inner) {
+    vector<uint32_t> ans;
+    for (size_t o = 0; o < outer; ++o)
+        for (size_t i = 0; i < extents.size(); ++i)
+            for (size_t j = 0; j < extents[i] * inner; ++j)
+                ans.emplace_back((i << 28) + o * extents[i] * inner + j);
+    return ans;
+}
+
+TEST(Concat, NativeCpuBlocks) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    // small rows, rows split into several pieces, and an output large
+    // enough for the non-temporal stores
+    vector<pair<size_t, size_t>> outerInner = {
+        {1000, 1}, {3, 20000}, {4, 300000}};
+    vector<size_t> extents = {1, 2, 3};
+    for (auto [outer, inner] : outerInner) {
+        Graph g = make_ref<GraphObj>(runtime);
+        TensorVec inputs;
+        for (auto e : extents)
+            inputs.emplace_back(g->addTensor(
+                {int(outer), int(e), int(inner)}, DataType::UInt32));
+        auto op = g->addOp<ConcatObj>(inputs, nullptr, 1);
+        g->dataMalloc();
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            auto ptr = inputs[i]->getRawDataPtr<uint32_t *>();
+            for (size_t j = 0; j < inputs[i]->size(); ++j)
+                ptr[j] = (i << 28) + j;
+        }
+        auto ans = concatReference(outer, extents, inner);
+        for (int nThreads : {1, 3}) {
+            set_num_threads(nThreads);
+            runtime->run(g);
+            EXPECT_TRUE(op->getOutput()->equalData(ans));
+        }
+    }
+    set_num_threads(0);
+}
+
 } // namespace infini
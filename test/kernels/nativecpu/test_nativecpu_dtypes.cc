@@ -0,0 +1,104 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini {
+
+// Small integers, exact in every data type, and their products fit in Int8
+template <typename T> static void fillSmall(const Tensor &t, int offset) {
+    t->setData([offset](void *ptr, size_t n, DataType) {
+        auto data = static_cast<T *>(ptr);
+        for (size_t i = 0; i < n; ++i)
+            data[i] = T(float(int(i % 7) - 3 + offset));
+    });
+}
+
+// The outputs of one op of every kind on inputs of type T
+template <typename T> static TensorVec buildGraph(Graph g, DataType dtype) {
+    auto a = g->addTensor({2, 3, 4}, dtype);
+    auto b = g->addTensor({4}, dtype);
+    auto d = g->addTensor({4}, dtype);
+    auto w = g->addTensor({4, 5}, dtype);
+    auto bias = g->addTensor({5}, dtype);
+    TensorVec outputs{
+        g->addOp<AddObj>(a, b, nullptr)->getOutput(),
+        g->addOp<SubObj>(a, b, nullptr)->getOutput(),
+        g->addOp<MulObj>(a, b, nullptr)->getOutput(),
+        g->addOp<DivObj>(a, d, nullptr)->getOutput(),
+        g->addOp<ReluObj>(a, nullptr)->getOutput(),
+        g->addOp<ClipObj>(a, nullptr, -1.0f, 2.0f)->getOutput(),
+        g->addOp<TransposeObj>(a, nullptr, vector<int>{2, 0, 1})->getOutput(),
+        g->addOp<MatmulObj>(a, w, nullptr)->getOutput()};
+    outputs.emplace_back(
+        g->addOp<ConcatObj>(TensorVec{outputs[0], outputs[1]}, nullptr, 1)
+            ->getOutput());
+    outputs.emplace_back(g->addOp<MatmulObj>(a, w, nullptr, false, false, bias,
+                                             ActType::Clip, -5.0f, 10.0f)
+                             ->getOutput());
+    g->dataMalloc();
+    fillSmall<T>(a, 0);
+    fillSmall<T>(b, 1);
+    fillSmall<T>(w, -1);
+    fillSmall<T>(bias, 2);
+    // a divisor without zeros
+    d->setData([](void *ptr, size_t n, DataType) {
+        for (size_t i = 0; i < n; ++i)
+            static_cast<T *>(ptr)[i] = T(float(i % 2 ? -2 : 3));
+    });
+    return outputs;
+}
+
+// Runs the graph in T and in Float32, whose results rounded to T must match
+template <typename T> static void testDtype(DataType dtype) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    TensorVec outputs = buildGraph<T>(g, dtype);
+    Graph ref = make_ref<GraphObj>(runtime);
+    auto refOutputs = buildGraph<float>(ref, DataType::Float32);
+    runtime->run(g);
+    runtime->run(ref);
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        ASSERT_EQ(outputs[i]->getDType(), dtype);
+        auto out = outputs[i]->getRawDataPtr<T *>();
+        auto ans = refOutputs[i]->getRawDataPtr<float *>();
+        for (size_t j = 0; j < outputs[i]->size(); ++j)
+            // Double divides more precisely than the Float32 reference
+            EXPECT_NEAR(double(out[j]), double(T(ans[j])),
+                        1e-6 * std::abs(ans[j]))
+                << dtype.toString() << " output " << i << " at " << j;
+    }
+}
+
+TEST(DataTypes, NativeCpuKernels) {
+    testDtype<float16_t>(DataType::Float16);
+    testDtype<bfloat16_t>(DataType::BFloat16);
+    testDtype<int8_t>(DataType::Int8);
+    testDtype<int32_t>(DataType::Int32);
+    testDtype<int64_t>(DataType::Int64);
+    testDtype<double>(DataType::Double);
+}
+
+TEST(DataTypes, KernelKeys) {
+    const auto &registry = KernelRegistry::getInstance();
+    auto preferred = [&](OpType type, DataType dtype) {
+        return std::get<1>(registry.getKernelItem(
+            KernelAttrs{Device::CPU, type.underlying(), dtype}));
+    };
+    EXPECT_EQ(preferred(OpType::Add, DataType::Float16), "addSimd_CPU");
+    EXPECT_EQ(preferred(OpType::Add, DataType::Int8), "addNaive_CPU");
+    EXPECT_EQ(preferred(OpType::MatMul, DataType::Int64),
+              "MatmulBlocked_CPU");
+    EXPECT_TRUE(registry
+                    .getKernelCandidates(KernelAttrs{
+                        Device::CPU, OpType::MatMul, DataType::UInt8})
+                    .empty());
+}
+
+} // namespace infini
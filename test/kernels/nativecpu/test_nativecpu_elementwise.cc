@@ -1,6 +1,12 @@
 #include "core/graph.h"
+#include "core/graph_rewriter.h"
 #include "core/runtime.h"
+#include "kernels/cpu/broadcast.h"
 #include "operators/element_wise.h"
+#include "operators/transpose.h"
+#include "utils/cpu_features.h"
+#include "utils/operator_utils.h"
+#include "utils/parallel.h"
 
 #include "test.h"
 
@@ -41,4 +47,123 @@ TEST(ElementWise, NativeCpu) {
         Shape{2, 1, 1}, ExpectOutput{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11});
 }
 
+// Compares Sub, which is not commutative, with an element by element
+// evaluation of the broadcast
+static void testBroadcastSub(const Shape &shape1, const Shape &shape2) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto t1 = g->addTensor(shape1, DataType::Float32);
+    auto t2 = g->addTensor(shape2, DataType::Float32);
+    auto op = g->addOp<SubObj>(t1, t2, nullptr);
+    g->dataMalloc();
+    t1->setData(IncrementalGenerator());
+    t2->setData(IncrementalGenerator());
+    runtime->run(g);
+
+    auto out = op->getOutput()->getDims();
+    size_t rank = out.size();
+    Shape a(rank, 1), b(rank, 1);
+    std::copy(shape1.begin(), shape1.end(), a.end() - shape1.size());
+    std::copy(shape2.begin(), shape2.end(), b.end() - shape2.size());
+    auto getStride = [&](const Shape &shape) {
+        Shape stride(rank);
+        for (int i = rank - 1, p = 1; i >= 0; p *= shape[i--])
+            stride[i] = p;
+        return stride;
+    };
+    ExpectOutput ans(op->getOutput()->size());
+    for (size_t i = 0; i < ans.size(); ++i) {
+        auto index = locate_index(i, out);
+        ans[i] = float(delocate_index(index, a, getStride(a))) -
+                 float(delocate_index(index, b, getStride(b)));
+    }
+    EXPECT_TRUE(op->getOutput()->equalData(ans));
+}
+
+TEST(ElementWise, NativeCpuBroadcast) {
+    for (auto isa : {CpuIsa::Scalar, CpuIsa::SSE, CpuIsa::AVX2,
+                     CpuIsa::AVX512}) {
+        set_max_cpu_isa(isa);
+        set_num_threads(3);
+        testBroadcastSub(Shape{3, 257, 129}, Shape{3, 257, 129});
+        testBroadcastSub(Shape{3, 257, 129}, Shape{1});
+        testBroadcastSub(Shape{3, 257, 129}, Shape{129});
+        testBroadcastSub(Shape{3, 1, 129}, Shape{257, 1});
+        set_num_threads(0);
+    }
+    set_max_cpu_isa(CpuIsa::AVX512);
+    testBroadcastSub(Shape{2, 3, 4, 5}, Shape{2, 3, 4, 5});
+    testBroadcastSub(Shape{2, 3, 4, 5}, Shape{});
+    testBroadcastSub(Shape{1}, Shape{2, 3, 4, 5});
+    testBroadcastSub(Shape{2, 3, 4, 5}, Shape{4, 5});
+    testBroadcastSub(Shape{5}, Shape{2, 3, 4, 5});
+    testBroadcastSub(Shape{2, 3, 4, 5}, Shape{3, 1, 1});
+    testBroadcastSub(Shape{2, 1, 4, 1}, Shape{3, 1, 5});
+    testBroadcastSub(Shape{1, 4, 5}, Shape{2, 3, 1, 1});
+}
+
+// Sub reading the transpose of `x` as a view, against a copy of it. The rows
+// are longer than a chunk of the SIMD kernels.
+static void testStridedSub(DataType dtype) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    auto build = [&](Graph g, bool view) {
+        auto x = g->addTensor({300, 5}, dtype);
+        auto y = g->addTensor({5, 300}, dtype);
+        auto t = g->addOp<TransposeObj>(x, nullptr, vector<int>{1, 0})
+                     ->getOutput();
+        if (view)
+            GraphRewriter(*g).makeView(t, x, {1, 5});
+        return g->addOp<SubObj>(y, t, nullptr)->getOutput();
+    };
+    Graph ref = make_ref<GraphObj>(runtime), g = make_ref<GraphObj>(runtime);
+    auto refOutput = build(ref, false), output = build(g, true);
+    for (auto graph : {ref, g}) {
+        graph->dataMalloc();
+        graph->getInputs()[0]->setData(IncrementalGenerator());
+        graph->getInputs()[1]->setData(OneGenerator());
+        runtime->run(graph);
+    }
+    auto view = output->getSource()->getInputs(1);
+    EXPECT_FALSE(view->isContiguous());
+    EXPECT_EQ(view->getRawDataPtr<void *>(),
+              view->getViewBase()->getRawDataPtr<void *>());
+    EXPECT_TRUE(output->equalData(refOutput));
+}
+
+TEST(ElementWise, NativeCpuStridedInput) {
+    testStridedSub(DataType::Float32);
+    testStridedSub(DataType::Float16);
+    testStridedSub(DataType::Int32);
+}
+
+TEST(BroadcastIterator, Coalesce) {
+    using Kind = BroadcastIterator::Kind;
+    BroadcastIterator same({1, 2, 3, 4}, {{2, 3, 4}, {1, 2, 3, 4}});
+    EXPECT_EQ(same.kind(), Kind::SameShape);
+    EXPECT_EQ(same.getDims(), (vector<size_t>{24}));
+
+    BroadcastIterator scalar({2, 3, 4}, {{2, 3, 4}, {1}});
+    EXPECT_EQ(scalar.kind(), Kind::ScalarBroadcast);
+    EXPECT_EQ(scalar.innerStride(1), 0u);
+
+    BroadcastIterator row({2, 3, 4, 5}, {{2, 3, 4, 5}, {4, 5}});
+    EXPECT_EQ(row.kind(), Kind::RowBroadcast);
+    EXPECT_EQ(row.getDims(), (vector<size_t>{6, 20}));
+
+    BroadcastIterator general({2, 3, 4}, {{2, 3, 4}, {3, 1}});
+    EXPECT_EQ(general.kind(), Kind::General);
+    EXPECT_EQ(general.getDims(), (vector<size_t>{2, 3, 4}));
+    EXPECT_EQ(general.innerStride(1), 0u);
+    vector<size_t> offsets;
+    general.forEachRow(
+        [&](size_t, const size_t *in) { offsets.emplace_back(in[1]); });
+    EXPECT_EQ(offsets, (vector<size_t>{0, 1, 2, 0, 1, 2}));
+
+    // a transposed input walks its own strides
+    BroadcastIterator strided({4, 3}, {{4, 3}, {4, 3}}, {{3, 1}, {1, 4}});
+    EXPECT_EQ(strided.kind(), Kind::General);
+    EXPECT_EQ(strided.innerStride(0), 1u);
+    EXPECT_EQ(strided.innerStride(1), 4u);
+}
+
 } // namespace infini
@@ -0,0 +1,112 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/matmul.h"
+#include "kernels/cpu/gemm.h"
+#include "utils/cpu_features.h"
+#include "utils/parallel.h"
+
+#include "test.h"
+
+namespace infini {
+
+// Small integers keep every partial sum exact in float
+static void fillSmallInts(void *data, size_t size, DataType dtype) {
+    IT_ASSERT(dtype == DataType::Float32);
+    auto ptr = reinterpret_cast<float *>(data);
+    for (size_t i = 0; i < size; ++i)
+        ptr[i] = float(int(i * 7 % 11) - 5);
+}
+
+static vector<float> referenceMatmul(const Tensor &A, const Tensor &B,
+                                     const Shape &outDims, bool transA,
+                                     bool transB) {
+    auto dimsA = A->getDims(), dimsB = B->getDims();
+    int rank = outDims.size();
+    int m = outDims[rank - 2], n = outDims[rank - 1];
+    int k = transA ? dimsA[dimsA.size() - 2] : dimsA.back();
+    // align the batch dims of A and B to the output
+    dimsA.insert(dimsA.begin(), rank - dimsA.size(), 1);
+    dimsB.insert(dimsB.begin(), rank - dimsB.size(), 1);
+    auto a = A->getRawDataPtr<float *>(), b = B->getRawDataPtr<float *>();
+
+    size_t batch = 1;
+    for (int i = 0; i < rank - 2; ++i)
+        batch *= outDims[i];
+    vector<float> ans(batch * m * n);
+    for (size_t bt = 0; bt < batch; ++bt) {
+        size_t offA = 0, offB = 0, rest = bt, strideA = m * k,
+               strideB = k * n;
+        for (int i = rank - 3; i >= 0; --i) {
+            size_t idx = rest % outDims[i];
+            rest /= outDims[i];
+            offA += (dimsA[i] == 1 ? 0 : idx) * strideA;
+            offB += (dimsB[i] == 1 ? 0 : idx) * strideB;
+            strideA *= dimsA[i];
+            strideB *= dimsB[i];
+        }
+        for (int i = 0; i < m; ++i)
+            for (int j = 0; j < n; ++j) {
+                float sum = 0;
+                for (int p = 0; p < k; ++p)
+                    sum += a[offA + (transA ? p * m + i : i * k + p)] *
+                           b[offB + (transB ? j * k + p : p * n + j)];
+                ans[bt * m * n + i * n + j] = sum;
+            }
+    }
+    return ans;
+}
+
+static void testMatmulNativeCpu(const Shape &shapeA, const Shape &shapeB,
+                                bool transA, bool transB) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto A = g->addTensor(shapeA, DataType::Float32);
+    auto B = g->addTensor(shapeB, DataType::Float32);
+    auto op = g->addOp<MatmulObj>(A, B, nullptr, transA, transB);
+    g->dataMalloc();
+    A->setData(fillSmallInts);
+    B->setData(fillSmallInts);
+
+    auto ans = referenceMatmul(A, B, op->getOutput()->getDims(), transA,
+                               transB);
+    for (auto isa : {CpuIsa::Scalar, CpuIsa::AVX2, CpuIsa::AVX512})
+        for (int nThreads : {1, 3, 8}) {
+            set_max_cpu_isa(isa);
+            set_num_threads(nThreads);
+            runtime->run(g);
+            EXPECT_TRUE(op->getOutput()->equalData(ans))
+                << cpu_isa_to_str(isa) << ", " << nThreads << " threads";
+        }
+    set_max_cpu_isa(CpuIsa::AVX512);
+    set_num_threads(0);
+}
+
+TEST(Matmul, NativeCpu) {
+    testMatmulNativeCpu(Shape{1, 3, 5}, Shape{1, 5, 2}, false, false);
+    testMatmulNativeCpu(Shape{2, 3, 4, 5}, Shape{1, 3, 6, 5}, false, true);
+    testMatmulNativeCpu(Shape{3, 5, 4}, Shape{5, 2}, true, false);
+    testMatmulNativeCpu(Shape{2, 1, 7, 9}, Shape{3, 8, 7}, true, true);
+    // crosses the MC, KC and NR blocks and leaves partial tiles
+    testMatmulNativeCpu(Shape{130, 300}, Shape{300, 70}, false, false);
+    testMatmulNativeCpu(Shape{300, 130}, Shape{70, 300}, true, true);
+    testMatmulNativeCpu(Shape{37, 40, 24}, Shape{24, 40}, false, false);
+}
+
+TEST(Matmul, Partition) {
+    // many small matrices: one batch range per thread
+    auto part = partitionGemm<float>(64, 32, 32, 32, 8);
+    EXPECT_EQ(part.batch, 8);
+    EXPECT_EQ(part.threads(), 8);
+    // tall-skinny: split M only
+    part = partitionGemm<float>(1, 8192, 64, 64, 8);
+    EXPECT_EQ(part.m, 8);
+    EXPECT_EQ(part.threads(), 8);
+    // short-wide: split N only
+    part = partitionGemm<float>(1, 8, 65536, 64, 4);
+    EXPECT_EQ(part.n, 4);
+    EXPECT_EQ(part.threads(), 4);
+    // too little work to share
+    EXPECT_EQ(partitionGemm<float>(1, 4, 4, 4, 8).threads(), 1);
+}
+
+} // namespace infini
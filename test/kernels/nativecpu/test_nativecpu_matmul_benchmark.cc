@@ -0,0 +1,65 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "kernels/cpu/gemm.h"
+#include "operators/matmul.h"
+#include "utils/parallel.h"
+
+#include "test.h"
+#include <chrono>
+#include <thread>
+
+namespace infini {
+
+// Runs a matmul with 1 to N threads and prints the GFLOP/s and the speedup
+// over one thread, N being the number of cores of this machine.
+static void benchmarkMatmulScaling(const Shape &shapeA, const Shape &shapeB) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto A = g->addTensor(shapeA, DataType::Float32);
+    auto B = g->addTensor(shapeB, DataType::Float32);
+    auto op = g->addOp<MatmulObj>(A, B, nullptr);
+    g->dataMalloc();
+    A->setData(OneGenerator());
+    B->setData(OneGenerator());
+
+    double flops = 2.0 * op->getOutput()->size() * op->getK();
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    vector<int> threadCounts;
+    for (int nThreads = 1; nThreads < maxThreads; nThreads *= 2)
+        threadCounts.emplace_back(nThreads);
+    threadCounts.emplace_back(maxThreads);
+
+    double base = 0;
+    for (int nThreads : threadCounts) {
+        set_num_threads(nThreads);
+        runtime->run(g); // warm up
+        int reps = 5;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < reps; ++i)
+            runtime->run(g);
+        auto end = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(end - begin).count() / reps;
+        if (nThreads == 1)
+            base = s;
+        auto part =
+            partitionGemm<float>(op->getOutput()->size() /
+                                     (op->getM() * op->getN()),
+                                 op->getM(), op->getN(), op->getK(), nThreads);
+        printf("%s x %s, %d threads (batch %d, m %d, n %d): %.1f GFLOP/s, "
+               "speedup %.2f\n",
+               vecToString(shapeA).c_str(), vecToString(shapeB).c_str(),
+               nThreads, part.batch, part.m, part.n, flops / s / 1e9,
+               base / s);
+    }
+    set_num_threads(0);
+    EXPECT_TRUE(op->getOutput()->equalData(
+        vector<float>(op->getOutput()->size(), float(op->getK()))));
+}
+
+TEST(Matmul, ScalingBenchmark) {
+    benchmarkMatmulScaling(Shape{512, 512}, Shape{512, 512});
+    benchmarkMatmulScaling(Shape{4096, 64}, Shape{64, 64});
+    benchmarkMatmulScaling(Shape{256, 32, 32}, Shape{256, 32, 32});
+}
+
+} // namespace infini
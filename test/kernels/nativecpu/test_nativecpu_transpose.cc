@@ -2,6 +2,8 @@
 #include "core/kernel.h"
 #include "core/runtime.h"
 #include "operators/transpose.h"
+#include "utils/cpu_features.h"
+#include "utils/parallel.h"
 
 #include "test.h"
 
@@ -11,7 +13,7 @@ TEST(Transpose, NativeCpu) {
     Runtime runtime = NativeCpuRuntimeObj::getInstance();
     Graph g = make_ref<GraphObj>(runtime);
 
-    Shape permute = {0, 2, 1, 3};
+    vector<int> permute = {0, 2, 1, 3};
     auto input = g->addTensor({1, 2, 3, 4}, DataType::Float32);
     auto op = g->addOp<TransposeObj>(input, nullptr, permute);
     g->dataMalloc();
@@ -24,4 +26,50 @@ TEST(Transpose, NativeCpu) {
                                                           8, 9, 10, 11, 20, 21, 22, 23}));
 }
 
+TEST(Transpose, NativeCpuPermutations) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    // identity, kept last dim, 2D with borders, batched and general cases
+    vector<pair<Shape, vector<int>>> cases = {
+        {{2, 3, 4}, {0, 1, 2}},         {{2, 1, 3, 4}, {1, 0, 2, 3}},
+        {{5, 6, 7}, {1, 0, 2}},         {{37, 45}, {1, 0}},
+        {{3, 40, 33}, {0, 2, 1}},       {{4, 9, 10, 11}, {2, 3, 0, 1}},
+        {{3, 5, 17, 1, 9}, {4, 2, 0, 3, 1}},
+        {{2, 3, 4, 5}, {3, 1, 2, 0}},
+    };
+    for (auto &[dims, permute] : cases) {
+        Graph g = make_ref<GraphObj>(runtime);
+        auto input = g->addTensor(dims, DataType::Float32);
+        auto op = g->addOp<TransposeObj>(input, nullptr, permute);
+        g->dataMalloc();
+        input->setData(IncrementalGenerator());
+
+        // out[pos] = in[pos permuted back], walking the output in order
+        size_t rank = dims.size(), size = input->size();
+        Shape outDims = op->getOutput()->getDims();
+        vector<float> ans(size);
+        for (size_t o = 0; o < size; ++o) {
+            Shape pos(rank);
+            for (size_t k = rank, rest = o; k-- > 0; rest /= outDims[k])
+                pos[k] = rest % outDims[k];
+            Shape inPos(rank);
+            for (size_t k = 0; k < rank; ++k)
+                inPos[permute[k]] = pos[k];
+            size_t in = 0;
+            for (size_t d = 0; d < rank; ++d)
+                in = in * dims[d] + inPos[d];
+            ans[o] = float(in);
+        }
+        for (auto isa :
+             {CpuIsa::Scalar, CpuIsa::SSE, CpuIsa::AVX2, CpuIsa::AVX512})
+            for (int nThreads : {1, 3}) {
+                set_max_cpu_isa(isa);
+                set_num_threads(nThreads);
+                runtime->run(g);
+                EXPECT_TRUE(op->getOutput()->equalData(ans));
+            }
+    }
+    set_max_cpu_isa(CpuIsa::AVX512);
+    set_num_threads(0);
+}
+
 } // namespace infini
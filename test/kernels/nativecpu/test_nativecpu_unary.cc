@@ -0,0 +1,51 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/unary.h"
+#include "utils/cpu_features.h"
+#include "utils/parallel.h"
+
+#include "test.h"
+
+namespace infini {
+
+// Values in [-n/2, n/2) in steps of 0.5
+static void fillCentered(void *data, size_t size, DataType dtype) {
+    IT_ASSERT(dtype == DataType::Float32);
+    auto ptr = reinterpret_cast<float *>(data);
+    for (size_t i = 0; i < size; ++i)
+        ptr[i] = 0.5f * (float(i) - float(size) / 2);
+}
+
+TEST(Unary, NativeCpu) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto i = g->addTensor({3, 1000, 67}, DataType::Float32);
+    auto relu = g->addOp<ReluObj>(i, nullptr);
+    auto clip = g->addOp<ClipObj>(i, nullptr, -3.0f, 1000.5f);
+    auto clipMax = g->addOp<ClipObj>(i, nullptr, std::nullopt, 7.0f);
+    g->dataMalloc();
+    i->setData(fillCentered);
+
+    size_t n = i->size();
+    vector<float> ansRelu(n), ansClip(n), ansClipMax(n);
+    auto x = i->getRawDataPtr<float *>();
+    for (size_t j = 0; j < n; ++j) {
+        ansRelu[j] = std::max(0.0f, x[j]);
+        ansClip[j] = std::min(std::max(x[j], -3.0f), 1000.5f);
+        ansClipMax[j] = std::min(x[j], 7.0f);
+    }
+    for (auto isa :
+         {CpuIsa::Scalar, CpuIsa::SSE, CpuIsa::AVX2, CpuIsa::AVX512})
+        for (int nThreads : {1, 4}) {
+            set_max_cpu_isa(isa);
+            set_num_threads(nThreads);
+            runtime->run(g);
+            EXPECT_TRUE(relu->getOutput()->equalData(ansRelu));
+            EXPECT_TRUE(clip->getOutput()->equalData(ansClip));
+            EXPECT_TRUE(clipMax->getOutput()->equalData(ansClipMax));
+        }
+    set_max_cpu_isa(CpuIsa::AVX512);
+    set_num_threads(0);
+}
+
+} // namespace infini
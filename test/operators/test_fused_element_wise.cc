@@ -0,0 +1,50 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/runtime.h"
+#include "operators/fused_element_wise.h"
+
+#include "test.h"
+
+namespace infini
+{
+    // bf16(min(x * relu(s) + r, 3)) for a BFloat16 x, a scalar s and a row r
+    TEST(FusedElementwise, BroadcastAndCast)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        auto x = g->addTensor({4, 1000}, DataType::BFloat16);
+        auto s = g->addTensor({1}, DataType::Float32);
+        auto r = g->addTensor({1000}, DataType::Float32);
+        vector<ElementwiseStep> program{
+            {OpType::Relu, 1, -1, std::nullopt, std::nullopt, DataType::Float32},
+            {OpType::Mul, 0, 3, std::nullopt, std::nullopt, DataType::Float32},
+            {OpType::Add, 4, 2, std::nullopt, std::nullopt, DataType::Float32},
+            {OpType::Clip, 5, -1, std::nullopt, 3.0f, DataType::Float32},
+            {OpType::Cast, 6, -1, std::nullopt, std::nullopt, DataType::BFloat16}};
+        auto op = g->addOp<FusedElementwiseObj>(TensorVec{x, s, r}, nullptr,
+                                                program);
+        auto y = op->getOutput();
+        EXPECT_EQ(y->getDims(), (Shape{4, 1000}));
+        EXPECT_EQ(y->getDType(), DataType::BFloat16);
+
+        g->dataMalloc();
+        auto px = x->getRawDataPtr<bfloat16_t *>();
+        auto pr = r->getRawDataPtr<float *>();
+        for (size_t i = 0; i < x->size(); ++i)
+            px[i] = float(int(i % 17) - 8) * 0.5f;
+        for (size_t i = 0; i < r->size(); ++i)
+            pr[i] = float(i) * 0.01f;
+        *s->getRawDataPtr<float *>() = 0.75f;
+        runtime->run(g);
+
+        auto py = y->getRawDataPtr<bfloat16_t *>();
+        for (size_t i = 0; i < y->size(); ++i)
+        {
+            float v = float(px[i]) * 0.75f;
+            v = v + pr[i % 1000];
+            EXPECT_EQ(float(py[i]), float(bfloat16_t(std::min(v, 3.0f))))
+                << "at " << i;
+        }
+    }
+
+} // namespace infini